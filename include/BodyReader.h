@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <deque>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+
+namespace rweb
+{
+
+//request body of a streaming route. Parts are pushed by the server as they arrive from the socket
+//and pulled by the route callback. At most 'capacity' bytes are buffered: the server stops reading
+//the socket until the callback takes some, so any body size is handled with constant memory
+class BodyReader
+{
+public:
+  //'onSpace' is called (from the reading thread) when the buffer stops being full
+  BodyReader(size_t capacity, std::function<void()> onSpace);
+
+  BodyReader(const BodyReader&) = delete;
+  BodyReader& operator=(const BodyReader&) = delete;
+
+  //waits for the next received part and moves it into 'chunk' (previous content is replaced).
+  //returns false when the whole body was read or the connection was lost
+  bool readChunk(std::string& chunk);
+  //waits for body bytes and copies up to 'size' of them to 'buffer'.
+  //returns count of copied bytes, 0 when the whole body was read or the connection was lost
+  size_t read(char* buffer, size_t size);
+
+  //whole body was received and read
+  bool isComplete() const;
+  //connection was lost or the body framing is broken. Body is incomplete
+  bool hasFailed() const;
+  //count of body bytes read so far
+  size_t getBytesRead() const;
+
+  //---used by the server---
+  //returns false if the reader does not accept data anymore
+  bool push(std::string&& data);
+  //no more data will be pushed
+  void finish();
+  void fail();
+  bool isFull() const;
+
+private:
+  //accounts 'count' bytes taken by the callback. Lock must be held. Returns true if the buffer stopped being full
+  bool consume(size_t count);
+
+  const size_t m_capacity;
+  const std::function<void()> m_onSpace;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::deque<std::string> m_chunks;
+  size_t m_chunkOffset; //bytes of the front chunk which are already read
+  size_t m_buffered;
+  size_t m_bytesRead;
+  bool m_finished;
+  bool m_failed;
+};
+
+}
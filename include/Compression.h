@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace rweb
+{
+
+enum class ContentCoding
+{
+  GZIP,
+  DEFLATE, // zlib format ("deflate" of HTTP)
+};
+
+//compresses 'data' into 'out' with zlib. 'level' is 1 (fastest) - 9 (smallest). Returns false on an error
+bool compress(std::string_view data, ContentCoding coding, int level, std::string& out);
+//returns true for text types (html, css, json, javascript, xml, svg...). Images, archives and fonts are compressed already
+bool isCompressible(std::string_view contentType);
+
+}
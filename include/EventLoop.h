@@ -0,0 +1,187 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+#include <deque>
+#include <cstdint>
+
+#include "Socket.h"
+#include "ThreadPool.h"
+#include "HTTPParser.h"
+#include "BodyReader.h"
+#include "ResponceWriter.h"
+#include "Output.h"
+
+namespace rweb
+{
+
+//processes one request and appends the responce to 'responce'. 'head' describes the head of 'request'.
+//'body' is set for streaming routes: 'request' holds only the head then and the body is read from 'body'.
+//'stream' sends the beginning of the responce while the handler is still running (see ResponceWriter).
+//returns false if the connection must be closed after the responce is sent.
+typedef bool (*RequestHandler)(const std::shared_ptr<const std::string>& request, const RequestParser& head,
+  const std::shared_ptr<BodyReader>& body, ResponceStream& stream, std::vector<OutputSegment>& responce);
+
+//state of a single client connection. Owned and used only by one reactor thread
+struct Connection
+{
+  SOCKFD socket;
+  uint64_t id; //unique per reactor. Protects against fd reuse
+  std::string input; //received bytes which are not processed yet
+  RequestParser parser{SERVER_BUFLEN}; //state of the request head in 'input'
+  BodyDecoder body; //state of the request body in 'input'
+  bool bodyStarted = false; //head is parsed, 'body' is reading the body
+  std::shared_ptr<BodyReader> stream; //body of a streaming route which is being received
+  std::deque<OutputSegment> output; //responce parts which are not sent yet. Bytes are merged into one part
+  std::shared_ptr<ResponceWriter> writer; //responce which is being written by a worker. Taken when 'output' is sent
+  size_t outputOffset = 0; //sent bytes of the first part
+  bool keepAlive = true;
+  bool readClosed = false; //peer shut down its side of the connection
+  bool closing = false; //last responce closes the connection, requests after it are not processed
+  bool busy = false; //request is being processed by a worker
+  uint32_t events = 0; //epoll events registered for the socket
+  std::chrono::steady_clock::time_point lastActivity;
+};
+
+//epoll instance with its own thread. Multiplexes all connections given to it
+class Reactor
+{
+public:
+  Reactor(const RequestHandler handler, ThreadPool& workers, const int timeoutSeconds);
+  ~Reactor();
+
+  Reactor(const Reactor&) = delete;
+  Reactor& operator=(const Reactor&) = delete;
+
+  //returns false on an error
+  bool start();
+  void stop();
+
+  //thread-safe. Reactor becomes the owner of the socket
+  void addClient(SOCKFD socket);
+  //makes reactor accept clients from 'listener' itself (SO_REUSEPORT mode). Call before start
+  void setListener(std::shared_ptr<Socket> listener);
+
+private:
+  //responce produced by a worker for a connection of this reactor
+  struct Completion
+  {
+    int fd;
+    uint64_t id;
+    std::vector<OutputSegment> responce;
+    bool keepAlive;
+    std::shared_ptr<ResponceWriter> writer; //opened by the handler. Its rest goes before 'responce'
+  };
+
+  //writer opened by a worker or a notification about its data ('writer' is not set then)
+  struct Written
+  {
+    int fd;
+    uint64_t id;
+    std::shared_ptr<ResponceWriter> writer;
+  };
+
+  //opens the writer of one request for its handler
+  class Stream;
+
+  //thread-safe. Called by workers
+  void complete(Completion&& completion);
+  void finishCompleted();
+  //hands the next buffered request to the workers.
+  //returns false if the connection must be closed
+  bool processInput(Connection& c);
+  //hands the request to a streaming route right after the head.
+  //returns false if the connection must be closed
+  bool startStream(Connection& c);
+  //moves received body bytes to the streaming route until its reader is full.
+  //returns false if the connection must be closed
+  bool pumpStream(Connection& c);
+  //thread-safe. Called when the reader of a streaming route has space again
+  void resume(int fd, uint64_t id);
+  void finishResumed();
+  //thread-safe. Called by workers
+  std::shared_ptr<ResponceWriter> openWriter(int fd, uint64_t id);
+  void written(Written&& written);
+  void finishWritten();
+  //sends parts of the writer of the connection while the socket takes them.
+  //returns false if the connection must be closed
+  bool pumpWriter(Connection& c);
+  //answers with an empty 'statusResponce' and closes the connection.
+  //returns false if the connection must be closed right away
+  bool refuse(Connection& c, const std::string& statusResponce);
+
+  void run();
+  void wake();
+  void addPendingClients();
+  void registerClient(SOCKFD socket);
+  void acceptClients();
+  //returns false if the connection must be closed
+  bool onReadable(Connection& c);
+  //returns false if the connection must be closed
+  bool flush(Connection& c);
+  //registers epoll events matching the connection state
+  void updateEvents(Connection& c);
+  void closeConnection(int fd);
+  void closeIdleConnections();
+
+  const RequestHandler m_handler;
+  ThreadPool& m_workers;
+  const int m_timeout; // connection timeout in seconds
+  int m_epoll;
+  int m_wakeFd;
+  std::atomic<bool> m_running;
+  std::thread m_thread;
+  std::shared_ptr<Socket> m_listener;
+
+  std::mutex m_pendingMutex;
+  std::vector<SOCKFD> m_pending; //accepted sockets waiting to be registered
+
+  std::mutex m_completedMutex;
+  std::vector<Completion> m_completed;
+
+  std::mutex m_resumedMutex;
+  std::vector<std::pair<int, uint64_t>> m_resumed; //fd, id
+
+  std::mutex m_writtenMutex;
+  std::vector<Written> m_written;
+  bool m_exited; //set under 'm_writtenMutex' when run() returns
+
+  std::unordered_map<int, std::unique_ptr<Connection>> m_connections;
+  std::chrono::steady_clock::time_point m_lastSweep;
+  uint64_t m_nextId;
+};
+
+//set of reactors (one per core by default). Accepted connections are spread round-robin.
+//requests are handled by 'workers', reactors only do I/O
+class EventLoop
+{
+public:
+  EventLoop(const RequestHandler handler, ThreadPool& workers, const int timeoutSeconds, unsigned int reactorCount=0);
+  ~EventLoop();
+
+  //returns false on an error
+  bool start();
+  void stop();
+
+  //hands accepted socket to the next reactor
+  void dispatch(SOCKFD socket);
+  //gives every reactor its own listening socket. Call before start
+  void setListeners(const std::vector<std::shared_ptr<Socket>>& listeners);
+  size_t getReactorCount() const;
+
+private:
+  std::vector<std::unique_ptr<Reactor>> m_reactors;
+  size_t m_next;
+};
+
+}
+
+#endif
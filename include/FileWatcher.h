@@ -0,0 +1,46 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <string>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <unordered_map>
+
+namespace rweb
+{
+
+//watches a directory tree with inotify on its own thread. Directories created inside the tree are watched too
+class FileWatcher
+{
+public:
+  //'onChange' is called from the watcher thread with the path of a changed, removed or moved file.
+  //'isDirectory' is true for directories which appeared or disappeared and when events were lost (path is the root then)
+  explicit FileWatcher(std::function<void(const std::string& path, bool isDirectory)> onChange);
+  ~FileWatcher();
+
+  FileWatcher(const FileWatcher&) = delete;
+  FileWatcher& operator=(const FileWatcher&) = delete;
+
+  //returns false on an error
+  bool start(const std::string& root);
+  void stop();
+
+private:
+  void run();
+  //watches 'dir' and all directories inside it
+  void addTree(const std::string& dir);
+
+  const std::function<void(const std::string&, bool)> m_onChange;
+  std::string m_root;
+  int m_inotify;
+  int m_wakeFd;
+  std::atomic<bool> m_running;
+  std::thread m_thread;
+  std::unordered_map<int, std::string> m_dirs; //watch descriptor -> directory path. Used only by the watcher thread after start
+};
+
+}
+
+#endif
@@ -4,12 +4,19 @@
 #include <map>
 #include <optional>
 #include <stack>
+#include <memory>
+#include <functional>
 
 #include "nlohmann/json.hpp"
 
 namespace rweb
 { 
 
+struct CompiledTemplate; //parsed template file (see HTMLTemplate.cpp)
+
+//drops all compiled template files. Next createTemplate reads and compiles them again
+void clearTemplateCache();
+
 class HTMLTemplate
 {
 public:
@@ -35,8 +42,21 @@ public:
   //returns headers for setting cookies
   const std::string getAllCookieHeaders() const;
 
+  //receives rendered parts of a streamed template. Returns false to stop rendering
+  typedef std::function<bool(const std::string& part)> TemplateWriter;
+
   //Renderes a template with specified json
   void renderJSON(const nlohmann::json& json);
+  //renders the template while the responce is sent instead of rendering it here: the page goes to the client
+  //in parts of about 'chunkSize' bytes with chunked transfer coding and is never kept whole. Text of a loop
+  //iteration is sent when the iteration ends. Errors after the first part close the connection.
+  //Responces which can't be streamed (HEAD, errors, windows server) are rendered like with renderJSON
+  void streamJSON(nlohmann::json json, const size_t chunkSize=16 * 1024);
+  //streamJSON was called and the template is not rendered yet
+  bool isStreamed() const;
+  //renders the template given to streamJSON, passing the parts to 'write'. Without 'write' the page is kept
+  //like with renderJSON. Returns false on an error or if 'write' fails
+  bool renderStream(const TemplateWriter& write=nullptr);
 
   //flashes message to the request
   void flash(const std::string& message, const std::string& category);
@@ -46,6 +66,7 @@ public:
   std::string encoding;
   std::string responce;
   bool ignoreHandlers = false;
+  bool compress = true; //false - body is never compressed on the fly (see setCompression)
 
 private:
 
@@ -55,7 +76,16 @@ private:
     bool httpOnly;
   };
 
-  std::string m_html;
+  //reads and compiles the template file (relative to the resource directory). 'cached' - the compiled file
+  //is shared by all templates of the path until clearTemplateCache. False if the file is empty or can't be read
+  bool loadFile(const std::string& path, const bool cached);
+  //renders the template into 'm_html' or passes it to 'write' in parts of 'chunkSize' bytes. False on an error
+  bool render(const nlohmann::json& json, const TemplateWriter* write, const size_t chunkSize);
+
+  std::string m_html; //empty while 'm_compiled' is set and not rendered
+  std::shared_ptr<const CompiledTemplate> m_compiled;
+  std::shared_ptr<const nlohmann::json> m_streamJson; //json given to streamJSON
+  size_t m_streamChunkSize = 0;
   std::string m_templateFileName;
   std::string m_location; //for redirects
   std::map<std::string, Cookie> m_cookies;
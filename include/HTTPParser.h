@@ -0,0 +1,146 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace rweb
+{
+
+//part of the parsed buffer. Offsets stay valid when the buffer grows or is moved
+struct Slice
+{
+  uint32_t offset = 0;
+  uint32_t size = 0;
+
+  std::string_view in(std::string_view buffer) const
+  {
+    return buffer.substr(offset, size);
+  }
+};
+
+//resumable HTTP/1.x request head (request line + headers) parser.
+//can be fed partial reads: every call continues from the byte where the previous one stopped.
+//does not copy anything, only remembers where the parts are in the buffer
+class RequestParser
+{
+public:
+  enum Result
+  {
+    INCOMPLETE, // need more bytes
+    COMPLETE, // head is parsed, getHeadSize() bytes are used
+    INVALID, // malformed request
+    TOO_LARGE // head is longer than the limit
+  };
+
+  explicit RequestParser(size_t maxHeadSize=65536);
+
+  //'buffer' must start with the same bytes as in the previous calls
+  Result parse(std::string_view buffer);
+  //prepares the parser for the next request. Head bytes must be removed from the buffer by the caller
+  void reset();
+
+  Result getResult() const;
+  //size of the request line and headers including the empty line
+  size_t getHeadSize() const;
+
+  Slice method;
+  Slice target;
+  Slice protocol;
+  std::vector<std::pair<Slice, Slice>> headers; //name, value (value is trimmed)
+
+  //returns value of the first header with 'name' (case-insensitive). Empty if not found
+  std::string_view getHeader(std::string_view buffer, std::string_view name) const;
+
+private:
+  enum State
+  {
+    LEADING_NEWLINES,
+    METHOD,
+    TARGET,
+    PROTOCOL,
+    REQUEST_LINE_LF,
+    HEADER_START,
+    HEADER_NAME,
+    HEADER_VALUE_START,
+    HEADER_VALUE,
+    HEADER_LF,
+    HEAD_END_LF,
+    DONE
+  };
+
+  const size_t m_maxHeadSize;
+  State m_state;
+  Result m_result;
+  size_t m_pos; //next byte to parse
+  size_t m_tokenStart;
+  Slice m_headerName;
+};
+
+//reads request body framed by Content-Length or by chunked transfer coding.
+//chunked body is decoded in place: when COMPLETE is returned, buffer[0, getDecodedEnd()) is the head
+//followed by the whole body and bytes from getConsumedEnd() belong to the next request
+class BodyDecoder
+{
+public:
+  enum Result
+  {
+    INCOMPLETE, // need more bytes
+    COMPLETE, // whole body is received
+    INVALID, // malformed framing (HTTP_400)
+    TOO_LARGE, // body is longer than the limit (HTTP_413)
+    LENGTH_REQUIRED, // request must have a body but its length is unknown (HTTP_411)
+    NOT_IMPLEMENTED // transfer coding other than chunked (HTTP_501)
+  };
+
+  BodyDecoder();
+
+  //chooses framing from the parsed head. 'maxBodySize' = 0 disables the limit
+  Result start(std::string_view buffer, const RequestParser& head, size_t maxBodySize);
+  //decodes body bytes received so far. Call every time new bytes are appended to 'buffer'
+  Result decode(std::string& buffer);
+  //moves decoded body bytes out of 'buffer' and erases everything consumed so far (head included).
+  //lets a body be read part by part: next decode continues at the start of 'buffer'
+  std::string takeBody(std::string& buffer);
+  void reset();
+
+  bool isChunked() const;
+  //decoded body size so far
+  size_t getBodySize() const;
+  //full body size. Known only for Content-Length framing
+  size_t getContentLength() const;
+  size_t getDecodedEnd() const;
+  size_t getConsumedEnd() const;
+
+private:
+  enum State
+  {
+    CHUNK_SIZE,
+    CHUNK_EXTENSION,
+    CHUNK_SIZE_LF,
+    CHUNK_DATA,
+    CHUNK_DATA_CR,
+    CHUNK_DATA_LF,
+    TRAILER_START,
+    TRAILER,
+    END_LF,
+    DONE
+  };
+
+  Result onChunkSize();
+
+  bool m_chunked;
+  State m_state;
+  size_t m_maxBodySize;
+  size_t m_bodyStart;
+  size_t m_contentLength;
+  size_t m_bodySize;
+  size_t m_chunkLeft;
+  size_t m_chunkDigits;
+  size_t m_framingSize; //ignored bytes of the current chunk extension or of the trailer
+  size_t m_read; //next encoded byte
+  size_t m_write; //end of the decoded body
+};
+
+}
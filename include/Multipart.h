@@ -0,0 +1,127 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdio>
+#include <functional>
+
+namespace rweb
+{
+
+class BodyReader;
+
+//file in the temp directory. Removed when the last owner is gone unless keep() was called
+class TempFile
+{
+public:
+  TempFile();
+  ~TempFile();
+
+  TempFile(const TempFile&) = delete;
+  TempFile& operator=(const TempFile&) = delete;
+
+  //false if the file could not be created
+  bool isOpen() const;
+  //returns false on an error
+  bool write(std::string_view data);
+  //finishes writing, the file can be opened by its path after that. Returns false on an error
+  bool close();
+  //closes the file and moves it to 'path'. It is not removed after that. Returns false on an error
+  bool keep(const std::string& path);
+  const std::string& getPath() const;
+
+private:
+  std::string m_path;
+  std::FILE* m_file;
+  bool m_kept;
+};
+
+//one part of a multipart/form-data body
+struct FormPart
+{
+  std::string_view name;
+  std::string_view filename; //empty for regular fields
+  std::string_view contentType;
+  std::vector<std::pair<std::string_view, std::string_view>> headers;
+  std::string_view data; //content of the part. Empty if it was spilled to 'file'
+  size_t size = 0; //content size
+  std::shared_ptr<TempFile> file; //holds the content of large uploaded files (see readMultipart)
+  std::shared_ptr<const std::string> storage; //keeps the views valid when they do not point into Request::raw
+
+  //returns value of the part header (name is case-insensitive). Empty if there is no such header
+  std::string_view getHeader(std::string_view name) const;
+};
+
+//streaming multipart/form-data parser. Can be fed the body in any pieces.
+//does not copy the body: data is reported as views into the fed bytes, only a boundary-long tail
+//of every piece and headers split between pieces are kept
+class MultipartParser
+{
+public:
+  enum Result
+  {
+    INCOMPLETE, // need more bytes
+    COMPLETE, // closing boundary is found
+    INVALID // malformed body or a handler failed
+  };
+
+  //receives the parts. Views are valid only during the call. Return false to stop parsing
+  class Handler
+  {
+  public:
+    virtual ~Handler() = default;
+    //raw header block of the next part (without the empty line)
+    virtual bool onPartBegin(std::string_view headers) = 0;
+    //may be called several times per part
+    virtual bool onPartData(std::string_view data) = 0;
+    virtual bool onPartEnd() = 0;
+  };
+
+  explicit MultipartParser(std::string_view boundary, size_t maxHeaderSize=8192);
+
+  MultipartParser(const MultipartParser&) = delete;
+  MultipartParser& operator=(const MultipartParser&) = delete;
+
+  Result feed(std::string_view input, Handler& handler);
+
+private:
+  enum State
+  {
+    PREAMBLE,
+    DELIMITER_END,
+    DELIMITER_DASH,
+    DELIMITER_LF,
+    HEADERS,
+    DATA,
+    DONE
+  };
+
+  //finds the delimiter in 'input' from 'pos', reports the bytes before it.
+  //returns false when the input is used up
+  bool findDelimiter(std::string_view input, size_t& pos, Handler& handler, bool& failed);
+  bool emit(std::string_view data, Handler& handler);
+
+  const std::string m_delimiter; // CRLF "--" boundary
+  const std::boyer_moore_horspool_searcher<std::string::const_iterator> m_searcher;
+  const size_t m_maxHeaderSize;
+  State m_state;
+  std::string m_carry; //tail of the previous input which may be the start of a delimiter
+  std::string m_headers; //header block split between inputs
+};
+
+//returns the boundary parameter of a multipart Content-Type value. Empty if there is none
+std::string_view getBoundary(std::string_view contentType);
+//returns parameter 'name' of a header value like 'form-data; name="a"'. Empty if there is none
+std::string_view getHeaderParam(std::string_view value, std::string_view name);
+//parses raw part header block. Returns false if it is malformed
+bool parsePartHeaders(std::string_view block, std::vector<std::pair<std::string_view, std::string_view>>& headers);
+
+//parses the whole multipart body. Parts are views into 'body'
+bool parseMultipart(std::string_view body, std::string_view boundary, std::vector<FormPart>& parts);
+//reads multipart body of a streaming route. Content of file parts larger than 'spillSize' bytes
+//is written to temp files instead of memory. Returns false on a malformed body or a lost connection
+bool readMultipart(BodyReader& body, std::string_view boundary, std::vector<FormPart>& parts, size_t spillSize=1048576);
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+namespace rweb
+{
+
+//read-only file. Closed when the last owner is gone
+class OpenFile
+{
+public:
+  //returns nullptr if the file can't be opened
+  static std::shared_ptr<const OpenFile> open(const std::string& path);
+  ~OpenFile();
+
+  OpenFile(const OpenFile&) = delete;
+  OpenFile& operator=(const OpenFile&) = delete;
+
+  int getFd() const;
+  //size when the file was opened
+  size_t getSize() const;
+  //unix time of the last modification when the file was opened
+  int64_t getModifiedTime() const;
+  //nanoseconds of the modification time (0 where the system does not keep them)
+  long getModifiedNanoseconds() const;
+  //reads the whole file into 'data'. Returns false on an error
+  bool read(std::string& data) const;
+
+private:
+  OpenFile(int fd, size_t size, int64_t modified, long modifiedNanoseconds);
+
+  const int m_fd;
+  const size_t m_size;
+  const int64_t m_modified;
+  const long m_modifiedNanoseconds;
+};
+
+//part of a responce: bytes or a range of a file. File ranges are sent by the kernel (sendfile)
+//without copying the file to the memory of the server
+struct OutputSegment
+{
+  std::string data; //used if 'file' is not set
+  std::shared_ptr<const OpenFile> file;
+  size_t offset = 0; //range of 'file'
+  size_t length = 0;
+};
+
+}
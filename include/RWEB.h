@@ -1,7 +1,12 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <map>
+#include <memory>
+#include <optional>
+#include <functional>
 
 #ifdef __linux__
 #include <netinet/in.h>
@@ -16,6 +21,9 @@
 #endif
 
 #include "Socket.h"
+#include "BodyReader.h"
+#include "Multipart.h"
+#include "Router.h"
 #include "HTMLTemplate.h"
 #include "Utility.h"
 
@@ -24,18 +32,37 @@ namespace rweb {
 struct Request 
 {
   std::string method;
-  std::string path;
+  std::string path; //without the query
+  std::string_view query; //raw query string without '?' (view into 'raw'). Empty if there is none
   std::string protocol;
-  std::map<std::string, std::string> headers;
+  std::vector<std::pair<std::string_view, std::string_view>> headers; //views into 'raw'
   std::string contentType;
   std::map<std::string, std::string> body;
+  std::vector<FormPart> parts; //multipart/form-data parts (views into 'raw'). Fields without a filename are in 'body' too
   std::map<std::string, std::string> cookies;
   std::vector<std::string> args;
+  std::array<ArgValue, Router::MAX_ARGS> argValues; //values of typed args ("<int:id>"), same indices as 'args'
   bool isValid = false;
   bool keepAlive = false;
+  std::shared_ptr<const std::string> raw; //received request. Shared between copies, keeps the views valid
+
+  //returns value of the header (name is case-insensitive). Empty if there is no such header
+  std::string_view getHeader(std::string_view name) const;
+  //returns owned copies of all headers
+  std::map<std::string, std::string> getHeaders() const;
+  //returns percent-decoded value of the query parameter. Only the requested parameter is decoded
+  std::optional<std::string> getQueryParam(std::string_view key) const;
+  //returns all decoded query parameters
+  std::map<std::string, std::string> getQueryParams() const;
+  //return values of typed args converted while routing. 0 (all zero bytes) if the arg at 'index' has another type
+  int64_t getIntArg(size_t index) const;
+  uint64_t getUintArg(size_t index) const;
+  std::array<uint8_t, 16> getUUIDArg(size_t index) const;
 }; 
 
 typedef HTMLTemplate (*HTTPCallback)(const Request r);
+//callback of a streaming route. Gets the request right after its head, the body is pulled from 'body' while it arrives
+typedef HTMLTemplate (*HTTPStreamCallback)(const Request r, BodyReader& body);
 typedef std::map<std::string, std::string> Session;
 
 //---FRAMEWORK---
@@ -48,12 +75,65 @@ void setShouldClose(const bool _shouldClose);
 bool getDebugState();
 void setProfilingMode(const bool enabled);
 bool getProfilingMode();
+//sets count of threads executing route callbacks (0 - one per core). Applied on startServer
+void setWorkerThreads(const unsigned int count);
+unsigned int getWorkerThreads();
+//sets max count of requests waiting for a worker. Requests over the limit get HTTP_503
+void setQueueDepth(const size_t depth);
+size_t getQueueDepth();
+//binds one SO_REUSEPORT socket per reactor thread, so every reactor accepts its own clients (linux only). Applied on startServer
+void setReusePort(const bool enabled);
+bool getReusePort();
+//sets max size of a request body in bytes (0 - unlimited). Larger requests get HTTP_413. 16 MiB by default
+void setMaxBodySize(const size_t bytes);
+size_t getMaxBodySize();
+//sets max size in bytes of resource files kept in memory (0 - disabled). Least recently used files are evicted
+//first, files larger than a quarter of the size are always read from the disk. 32 MiB by default
+void setResourceCacheSize(const size_t bytes);
+size_t getResourceCacheSize();
+//compresses text bodies of route responces with gzip or deflate if the client accepts it. Set HTMLTemplate::compress
+//to false to opt out a route. Disabled by default
+void setCompression(const bool enabled);
+bool getCompression();
+//zlib level: 1 (fastest) - 9 (smallest). 6 by default
+void setCompressionLevel(const int level);
+int getCompressionLevel();
+//bodies smaller than 'bytes' are not compressed. 1 KiB by default
+void setCompressionThreshold(const size_t bytes);
+size_t getCompressionThreshold();
+//serves "file.br" or "file.gz" next to a resource file instead of it if the client accepts the encoding. Enabled by default
+void setPrecompressed(const bool enabled);
+bool getPrecompressed();
+//watches the resource directory with inotify (linux only). Cached files are dropped as soon as they change,
+//so deploys don't need a restart. Enabled by default. Applied on startServer
+void setFileWatching(const bool enabled);
+bool getFileWatching();
+//keeps template files compiled between requests, createTemplate doesn't read them again. They are compiled again
+//when a file in the resource directory changes (see setFileWatching). Disable during development if files are
+//not watched. Enabled by default
+void setTemplateCache(const bool enabled);
+bool getTemplateCache();
 void setResourcePath(const std::string resPath);
 void setPort(const int port);
 void addRoute(const std::string& path, const HTTPCallback callback);
+//adds streaming route. Its body size is not limited by setMaxBodySize, unread rest of the body closes the connection
+void addRoute(const std::string& path, const HTTPStreamCallback callback);
+//adds route for one method (GET, HEAD, POST, PUT, DELETE, PATCH or OPTIONS). Routes added without a method
+//handle any method. Other methods of the path get HTTP_405, HEAD uses GET callback without sending the body
+void addRoute(const std::string& method, const std::string& path, const HTTPCallback callback);
+void addRoute(const std::string& method, const std::string& path, const HTTPStreamCallback callback);
+//applies changes made by 'update' (addRoute, addResource, setErrorHandler...) as one routing snapshot.
+//routes can be changed while the server is running: new requests see the new snapshot, running ones keep the old.
+//every change outside of updateRoutes publishes its own snapshot. Snapshots are freed when the server stops
+void updateRoutes(const std::function<void()>& update);
 void addResource(const std::string& URLpath, const std::string& resourcePath, const std::string& contentType);
 void addDynamicResource(const std::string& URLPrefix, const std::string& resourceFolderPrefix, const std::string& contentType);
 std::optional<HTTPCallback> getRoute(const std::string& path);
+//reads multipart/form-data body of a streaming route into 'parts'. Files larger than 'spillSize' bytes
+//are written to temp files (FormPart::file). Returns false on a malformed body or a lost connection
+bool readMultipart(const Request& r, BodyReader& body, std::vector<FormPart>& parts, const size_t spillSize=1048576);
+//returns true if 'method' requests to 'path' (without query) are handled by a streaming route. Valid after startServer
+bool isStreamRoute(std::string_view method, std::string_view path);
 HTMLTemplate redirect(const std::string& location, const std::string& statusResponce=HTTP_303);
 HTMLTemplate createTemplate(const std::string& templatePath, const std::string& statusResponce=HTTP_200);
 HTMLTemplate abort(const std::string& statusResponce, const bool ignoreHandlers=false);
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+#include "Output.h"
+
+namespace rweb
+{
+
+//file loaded by ResourceCache
+struct CachedResource
+{
+  std::string headers; //pre-serialized "Content-Type", "Content-Encoding", "Content-Length" and 'validators' lines (each ends with CRLF)
+  std::string validators; //pre-serialized "ETag", "Last-Modified" and "Vary" lines. Sent with 304 too
+  std::string contentType;
+  std::string encoding; //"gzip" or "br" for precompressed siblings, empty otherwise
+  std::string etag; //hash of the content. Files which are not kept get size and modification time instead
+  int64_t modified = 0; //unix time
+  std::string data;
+  std::shared_ptr<const OpenFile> file; //set instead of 'data' for files which are not kept (see get)
+  size_t size = 0;
+  std::shared_ptr<const CachedResource> gzip; //precompressed siblings ("file.gz", "file.br"). Loaded with the file
+  std::shared_ptr<const CachedResource> brotli;
+};
+
+//files of resources kept in memory. Least recently used files are evicted when the size of all
+//cached files exceeds the capacity. Files larger than a quarter of the capacity are not kept.
+//Precompressed siblings are part of the entry of their file
+class ResourceCache
+{
+public:
+  //'capacity' - max size of all cached files in bytes (0 - disabled)
+  explicit ResourceCache(size_t capacity);
+
+  ResourceCache(const ResourceCache&) = delete;
+  ResourceCache& operator=(const ResourceCache&) = delete;
+
+  //returns the file at 'path', reads it on a cache miss. nullptr if the file can't be read.
+  //'keepOpen' - files which are too large for the cache are returned open instead of being read
+  std::shared_ptr<const CachedResource> get(const std::string& path, const std::string& contentType, bool keepOpen=false);
+  //removes the file from the cache. Next get() reads it again. Changes of a sibling ("file.gz") remove its file
+  void invalidate(const std::string& path);
+  void clear();
+
+  //evicts files if the new capacity is smaller
+  void setCapacity(size_t capacity);
+  size_t getCapacity() const;
+  //size of all cached files
+  size_t getSize() const;
+  //loads "file.gz" and "file.br" with the file if they exist. Clears the cache
+  void setPrecompressed(bool enabled);
+  bool getPrecompressed() const;
+
+private:
+  struct Entry
+  {
+    std::shared_ptr<const CachedResource> resource;
+    std::list<std::string>::iterator use; // position in m_uses
+  };
+
+  //removes the entry of 'path' if it is cached. Call it with the lock held
+  void erase(const std::string& path);
+  //removes least recently used files until the size fits the capacity
+  void evict();
+
+  mutable std::mutex m_mutex;
+  std::unordered_map<std::string, Entry> m_entries;
+  std::list<std::string> m_uses; // paths, most recently used first
+  size_t m_capacity;
+  size_t m_size;
+  bool m_precompressed;
+  uint64_t m_generation; //incremented by invalidate and clear. Files read before that are not kept
+};
+
+}
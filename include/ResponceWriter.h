@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+
+namespace rweb
+{
+
+//body of a responce which is sent while it is produced. Parts are written by the worker and taken by the server
+//when the previous ones are sent. At most 'capacity' bytes wait in the writer: write() blocks until the server
+//takes them, so a responce of any size is sent with constant memory
+class ResponceWriter
+{
+public:
+  //'onData' is called (from the writing thread) when written bytes are waiting to be taken
+  ResponceWriter(size_t capacity, std::function<void()> onData);
+
+  ResponceWriter(const ResponceWriter&) = delete;
+  ResponceWriter& operator=(const ResponceWriter&) = delete;
+
+  //queues 'data' for sending, waits while the writer is full.
+  //returns false if the connection was lost, nothing is sent anymore then
+  bool write(std::string_view data);
+  //connection was lost
+  bool isClosed() const;
+  //count of bytes written so far
+  size_t getBytesWritten() const;
+
+  //---used by the server---
+  //moves all waiting bytes to 'data' (previous content is replaced). Returns false if there are none
+  bool take(std::string& data);
+  //wakes the writer. Later writes fail
+  void close();
+
+private:
+  const size_t m_capacity;
+  const std::function<void()> m_onData;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::string m_buffer;
+  size_t m_bytesWritten;
+  bool m_closed;
+};
+
+//opens the writer of the responce of a request on demand (see HTMLTemplate::streamJSON)
+class ResponceStream
+{
+public:
+  virtual ~ResponceStream() = default;
+
+  //bytes written to the returned writer are sent before the responce returned by the request handler.
+  //later calls return the same writer
+  virtual std::shared_ptr<ResponceWriter> open() = 0;
+};
+
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+#include "RWEB.h"
+
+namespace rweb
+{
+
+//methods accepted by addRoute and route tables
+constexpr const char* ROUTE_METHODS[] = {"GET", "HEAD", "POST", "PUT", "DELETE", "PATCH", "OPTIONS"};
+constexpr int ROUTE_METHOD_COUNT = sizeof(ROUTE_METHODS) / sizeof(ROUTE_METHODS[0]);
+
+//returns index of 'method' in ROUTE_METHODS (case-sensitive). -1 if it is not supported
+constexpr int getRouteMethodIndex(std::string_view method)
+{
+  for (int i=0;i<ROUTE_METHOD_COUNT;++i)
+  {
+    if (method == ROUTE_METHODS[i])
+      return i;
+  }
+  return -1;
+}
+
+//FNV-1a. Used to build route tables at compile time and to look paths up in them
+constexpr uint64_t routeHash(std::string_view s)
+{
+  uint64_t hash = 14695981039346656037ull;
+  for (const char c : s)
+  {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+//one entry of a route table. Routes without a method handle any method
+struct StaticRoute
+{
+  std::string_view method;
+  std::string_view path;
+  HTTPCallback callback;
+  int methodIndex; // index in ROUTE_METHODS, -1 - any method
+
+  constexpr StaticRoute() : method(), path(), callback(nullptr), methodIndex(-1) {}
+  constexpr StaticRoute(std::string_view path, HTTPCallback callback)
+    : method(), path(path), callback(callback), methodIndex(-1) {}
+  constexpr StaticRoute(std::string_view method, std::string_view path, HTTPCallback callback)
+    : method(method), path(path), callback(callback), methodIndex(getRouteMethodIndex(method))
+  {
+    if (methodIndex < 0)
+      throw "StaticRoute: unsupported method"; // compile error in constant expressions
+  }
+};
+
+//slot of the open addressing table. Routes of one path are next to each other
+struct RouteSlot
+{
+  uint64_t hash = 0;
+  uint16_t first = 0; // index of the first route of the path
+  uint16_t count = 0; // 0 - empty slot
+};
+
+//type independent view of RouteTable. Does not own anything
+struct RouteTableView
+{
+  const StaticRoute* routes = nullptr;
+  const RouteSlot* slots = nullptr;
+  size_t mask = 0; // slot count - 1
+
+  //finds routes of 'path'. Returns false if the table has no such path
+  bool find(std::string_view path, const StaticRoute*& first, size_t& count) const
+  {
+    if (!slots)
+      return false;
+
+    const uint64_t hash = routeHash(path);
+    for (size_t i = hash & mask;; i = (i + 1) & mask)
+    {
+      const RouteSlot& slot = slots[i];
+      if (slot.count == 0)
+        return false;
+      if (slot.hash == hash && routes[slot.first].path == path)
+      {
+        first = routes + slot.first;
+        count = slot.count;
+        return true;
+      }
+    }
+  }
+};
+
+//route table built at compile time: routes are grouped by path and put into a hash table with
+//at most half of the slots used, so lookups take one hash of the path and no allocations.
+//errors in the table (unsupported method, duplicate route, path without '/') fail the compilation
+//when the table is constexpr
+template <size_t N>
+class RouteTable
+{
+public:
+  static_assert(N > 0 && N < UINT16_MAX, "route table must have 1-65534 routes");
+
+  constexpr explicit RouteTable(const StaticRoute (&routes)[N]) : m_routes(), m_slots()
+  {
+    //insertion sort by path keeps routes of one path together
+    for (size_t i=0;i<N;++i)
+    {
+      if (routes[i].path.empty() || routes[i].path[0] != '/')
+        throw "RouteTable: path must start with '/'";
+      if (!routes[i].callback)
+        throw "RouteTable: route has no callback";
+
+      size_t j = i;
+      while (j > 0 && routes[i].path < m_routes[j-1].path)
+      {
+        m_routes[j] = m_routes[j-1];
+        j--;
+      }
+      m_routes[j] = routes[i];
+    }
+
+    for (size_t i=0;i<N;)
+    {
+      size_t end = i + 1;
+      while (end < N && m_routes[end].path == m_routes[i].path)
+        end++;
+
+      for (size_t a=i;a<end;++a)
+      {
+        for (size_t b=a+1;b<end;++b)
+        {
+          if (m_routes[a].methodIndex == m_routes[b].methodIndex)
+            throw "RouteTable: duplicate route";
+        }
+      }
+
+      const uint64_t hash = routeHash(m_routes[i].path);
+      size_t slot = hash & (SLOT_COUNT - 1);
+      while (m_slots[slot].count != 0)
+        slot = (slot + 1) & (SLOT_COUNT - 1);
+      m_slots[slot].hash = hash;
+      m_slots[slot].first = i;
+      m_slots[slot].count = end - i;
+      i = end;
+    }
+  }
+
+  //the table must outlive the view (declare it as a static constexpr variable)
+  constexpr RouteTableView view() const
+  {
+    RouteTableView res;
+    res.routes = m_routes;
+    res.slots = m_slots;
+    res.mask = SLOT_COUNT - 1;
+    return res;
+  }
+
+private:
+  //power of two, at least twice the route count
+  static constexpr size_t getSlotCount()
+  {
+    size_t res = 1;
+    while (res < N * 2)
+      res *= 2;
+    return res;
+  }
+  static constexpr size_t SLOT_COUNT = getSlotCount();
+
+  StaticRoute m_routes[N];
+  RouteSlot m_slots[SLOT_COUNT];
+};
+
+//static constexpr auto table = rweb::makeRouteTable({{"GET", "/", home}, {"/api", api}});
+template <size_t N>
+constexpr RouteTable<N> makeRouteTable(const StaticRoute (&routes)[N])
+{
+  return RouteTable<N>(routes);
+}
+
+//sets compile-time routes. They are looked up before the routes added by addRoute and handle
+//the same way (405 for other methods, HEAD and OPTIONS). Must be called before startServer
+void setRouteTable(const RouteTableView& table);
+
+template <size_t N>
+void setRouteTable(const RouteTable<N>& table)
+{
+  setRouteTable(table.view());
+}
+
+}
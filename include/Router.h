@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <cstdint>
+
+namespace rweb
+{
+
+//type of "<type:name>" route args. Typed args are checked before the untyped ones
+enum class ArgType : uint8_t
+{
+  INT, // int64_t with an optional '-'
+  UINT, // uint64_t
+  UUID, // 8-4-4-4-12 hex digits
+  STRING // "<name>" or "<string:name>", any non-empty segment
+};
+
+//route arg converted while routing
+struct ArgValue
+{
+  ArgType type = ArgType::STRING;
+  union
+  {
+    int64_t i;
+    uint64_t u;
+    std::array<uint8_t, 16> uuid;
+  };
+
+  ArgValue() : u(0) {}
+};
+
+//tree of URL paths split by '/'. Every node is one path segment, "<name>" segments match any
+//non-empty segment, typed args match only segments of their type. Built once, lookups take O(path length) and do not allocate.
+//empty segments are skipped ("/a//b" is "/a/b"), trailing '/' is an empty last segment ("/a/" is not "/a")
+class Router
+{
+public:
+  static constexpr size_t MAX_ARGS = 16;
+
+  struct Match
+  {
+    size_t value = 0; // value given to add()
+    std::array<std::string_view, MAX_ARGS> args; // views into the looked up path
+    std::array<ArgValue, MAX_ARGS> values; // converted args
+    size_t argCount = 0;
+  };
+
+  //returns false if 'segment' is not an arg or has unknown type
+  static bool getArgType(std::string_view segment, ArgType& type);
+  //returns false if 'segment' is not a valid value of 'type'
+  static bool parseArg(std::string_view segment, ArgType type, ArgValue& value);
+
+  Router();
+
+  //'withArgs' - treat "<name>" segments as args. Returns false if the path already has a value
+  bool add(std::string_view path, size_t value, bool withArgs=true);
+  //adds prefix matching 'prefix' followed by exactly one more segment. Returns false if it already has a value
+  bool addPrefix(std::string_view prefix, size_t value);
+  void clear();
+
+  //exact segments are preferred over args
+  bool find(std::string_view path, Match& match) const;
+  //finds prefix added by addPrefix. 'rest' is the last segment of 'path'. Trailing '/' is ignored
+  bool findPrefix(std::string_view path, size_t& value, std::string_view& rest) const;
+
+private:
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  struct Node
+  {
+    std::vector<std::pair<std::string, uint32_t>> children; // sorted by segment
+    std::vector<std::pair<ArgType, uint32_t>> args; // children for arg segments, sorted by type
+    uint32_t value = NONE;
+    uint32_t prefixValue = NONE;
+  };
+
+  //returns index of the node for 'path', creates missing nodes
+  uint32_t insert(std::string_view path, bool withArgs);
+  uint32_t findChild(uint32_t node, std::string_view segment) const;
+  bool match(uint32_t node, std::string_view path, size_t pos, Match& match) const;
+
+  std::vector<Node> m_nodes; // root is the first one
+};
+
+}
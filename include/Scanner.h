@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string_view>
+#include <cstddef>
+
+namespace rweb
+{
+
+//byte classes scanFor can stop at. May be combined with '|'
+enum ScanStop : unsigned
+{
+  SCAN_NONTOKEN = 1, // bytes <= 0x20 (space and controls) and >= 0x7f
+  SCAN_COLON = 2, // ':'
+  SCAN_CONTROL = 4, // bytes < 0x20 except tab (CR and LF included) and 0x7f
+  SCAN_CR = 8 // '\r'
+};
+
+//returns position of the first byte at or after 'from' which belongs to one of 'stops'.
+//returns data.size() if there is no such byte.
+//uses AVX2 or SSE2 when the CPU supports it (selected once at runtime), plain loop otherwise
+size_t scanFor(std::string_view data, size_t from, unsigned stops);
+
+//returns position of the first "\r\n\r\n" at or after 'from'. std::string_view::npos if not found
+size_t findHeaderEnd(std::string_view data, size_t from=0);
+
+//returns name of the selected scanning kernel ("avx2", "sse2" or "scalar")
+const char* getScannerKernel();
+
+}
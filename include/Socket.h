@@ -27,12 +27,17 @@ struct SOCKFD
 class Socket
 {
 public: 
-  Socket(int clientQueue, int timeoutSeconds=20);
+  //'reusePort' binds with SO_REUSEPORT so several sockets can listen on the same port (linux only)
+  Socket(int clientQueue, int timeoutSeconds=20, bool reusePort=false);
   ~Socket();
+  //waits until a client can be accepted. returns false on timeout or an error
+  bool waitForClient(int timeoutMs);
+  //on linux returns non-blocking socket. std::nullopt if there is no client to accept
   std::optional<SOCKFD> acceptClient();
   bool sendMessage(SOCKFD clientSocket, const std::string& message);
   std::string getMessage(SOCKFD clientSocket);
   static void closeSocket(SOCKFD socket);
+  SOCKFD getSocket() const;
 
   const int timeout; // connection timeout in seconds
 
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+namespace rweb
+{
+
+//fixed set of worker threads executing tasks from a bounded queue
+class ThreadPool
+{
+public:
+  //'threads' = 0 uses one worker per core
+  ThreadPool(unsigned int threads, size_t queueDepth);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  //returns false if the queue is full or the pool is stopped. Task is not executed in that case
+  bool trySubmit(std::function<void()> task);
+  //waits for running tasks to finish. Tasks which are still queued are dropped
+  void stop();
+
+  size_t getThreadCount() const;
+
+private:
+  void run();
+
+  const size_t m_queueDepth;
+  bool m_stopping;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::deque<std::function<void()>> m_tasks;
+  std::vector<std::thread> m_threads;
+};
+
+}
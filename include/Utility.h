@@ -1,7 +1,9 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <cstdint>
 
 #ifdef _WIN32
 #ifndef WIN32_LEAN_AND_MEAN
@@ -63,6 +65,7 @@ namespace MIME {
 const std::string octetStream = "application/octet-stream";
 const std::string JSON = "application/json";
 const std::string FORMURLENCODED = "application/x-www-form-urlencoded";
+const std::string MULTIPART = "multipart/form-data";
 
 const std::string PLAINTEXT = "text/plain";
 const std::string HTML = "text/html";
@@ -82,6 +85,8 @@ const std::string WEBP = "image/webp";
 
 //---HTTP RESPONCES---
 const std::string HTTP_200 = "HTTP/1.1 200 OK\r\n";
+const std::string HTTP_204 = "HTTP/1.1 204 No Content\r\n";
+const std::string HTTP_206 = "HTTP/1.1 206 Partial Content\r\n";
 
 const std::string HTTP_300 = "HTTP/1.1 300 Multiple Choice\r\n";
 const std::string HTTP_301 = "HTTP/1.1 301 Moved Permanently\r\n";
@@ -98,10 +103,12 @@ const std::string HTTP_404 = "HTTP/1.1 404 Not Found\r\n";
 const std::string HTTP_405 = "HTTP/1.1 405 Method Not Allowed\r\n";
 const std::string HTTP_411 = "HTTP/1.1 411 Length Required\r\n";
 const std::string HTTP_413 = "HTTP/1.1 413 Payload Too Large\r\n";
+const std::string HTTP_416 = "HTTP/1.1 416 Range Not Satisfiable\r\n";
 const std::string HTTP_429 = "HTTP/1.1 429 Too Many Requests\r\n";
 const std::string HTTP_431 = "HTTP/1.1 431 Request Header Fields Too Large\r\n";
 
 const std::string HTTP_500 = "HTTP/1.1 500 Internal Server Error\r\n"; 
+const std::string HTTP_501 = "HTTP/1.1 501 Not Implemented\r\n";
 const std::string HTTP_503 = "HTTP/1.1 503 Service Unavailable\r\n";
 
 //returns string found in file. "" in case of an error.
@@ -122,13 +129,19 @@ double calculate(const std::string& expression, bool* is_ok=nullptr);
 //colorizes output. Usage: stream << colorize(color) << ... << colorize(NC) << "\n"; /*to clear color*/.
 const char *colorize(int font = NC);
 //decodes given URLEncoded string
-std::string urlDecode(const std::string& str);
+std::string urlDecode(std::string_view str);
 //makes given string URLEncoded
 std::string urlEncode(const std::string &value);
 //converts given string to upper case
 std::string toUpper(const std::string& s);
 //converts given string to lower case
 std::string toLower(const std::string& s);
+//compares two strings ignoring ASCII case
+bool equalsIgnoreCase(std::string_view a, std::string_view b);
+//formats unix time as an HTTP date ("Sun, 06 Nov 1994 08:49:37 GMT")
+std::string formatHTTPDate(const int64_t time);
+//parses an HTTP date in the format of formatHTTPDate. Returns false if it is malformed
+bool parseHTTPDate(std::string_view date, int64_t& time);
 
 void setLogLevel(const LogLevel level);
 LogLevel getLogLevel();
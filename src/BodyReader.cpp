@@ -0,0 +1,133 @@
+#include "../include/BodyReader.h"
+
+#include <cstring>
+#include <algorithm>
+
+namespace rweb
+{
+
+BodyReader::BodyReader(size_t capacity, std::function<void()> onSpace)
+: m_capacity(capacity), m_onSpace(std::move(onSpace)), m_chunkOffset(0), m_buffered(0), m_bytesRead(0), m_finished(false), m_failed(false)
+{
+}
+
+bool BodyReader::readChunk(std::string& chunk)
+{
+  bool resumed;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this](){ return !m_chunks.empty() || m_finished || m_failed; });
+    if (m_chunks.empty())
+      return false;
+
+    chunk = std::move(m_chunks.front());
+    m_chunks.pop_front();
+    if (m_chunkOffset)
+      chunk.erase(0, m_chunkOffset);
+    m_chunkOffset = 0;
+    resumed = consume(chunk.size());
+  }
+
+  if (resumed && m_onSpace)
+    m_onSpace();
+  return true;
+}
+
+size_t BodyReader::read(char* buffer, size_t size)
+{
+  if (size == 0)
+    return 0;
+
+  size_t n;
+  bool resumed;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this](){ return !m_chunks.empty() || m_finished || m_failed; });
+    if (m_chunks.empty())
+      return 0;
+
+    const std::string& front = m_chunks.front();
+    n = std::min(size, front.size() - m_chunkOffset);
+    memcpy(buffer, front.data() + m_chunkOffset, n);
+    m_chunkOffset += n;
+    if (m_chunkOffset == front.size())
+    {
+      m_chunks.pop_front();
+      m_chunkOffset = 0;
+    }
+    resumed = consume(n);
+  }
+
+  if (resumed && m_onSpace)
+    m_onSpace();
+  return n;
+}
+
+bool BodyReader::consume(size_t count)
+{
+  const bool wasFull = m_buffered >= m_capacity;
+  m_buffered -= count;
+  m_bytesRead += count;
+  return wasFull && m_buffered < m_capacity && !m_failed;
+}
+
+bool BodyReader::isComplete() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_finished && m_chunks.empty();
+}
+
+bool BodyReader::hasFailed() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_failed;
+}
+
+size_t BodyReader::getBytesRead() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_bytesRead;
+}
+
+bool BodyReader::push(std::string&& data)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_failed || m_finished)
+      return false;
+    if (data.empty())
+      return true;
+    m_buffered += data.size();
+    m_chunks.push_back(std::move(data));
+  }
+  m_cv.notify_one();
+  return true;
+}
+
+void BodyReader::finish()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_finished = true;
+  }
+  m_cv.notify_all();
+}
+
+void BodyReader::fail()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_finished)
+      return;
+    m_failed = true;
+  }
+  m_cv.notify_all();
+}
+
+bool BodyReader::isFull() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_buffered >= m_capacity;
+}
+
+}
@@ -0,0 +1,49 @@
+#include "../include/Compression.h"
+#include "../include/Utility.h"
+
+#include <cstdint>
+
+#include <zlib.h>
+
+namespace rweb
+{
+
+bool compress(std::string_view data, ContentCoding coding, int level, std::string& out)
+{
+  if (data.size() > UINT32_MAX) // sizes of zlib are 32-bit
+    return false;
+
+  z_stream stream{};
+  const int windowBits = coding == ContentCoding::GZIP ? 15 + 16 : 15; // +16 writes gzip header and trailer
+  if (deflateInit2(&stream, level, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    return false;
+
+  //whole output fits into the bound, one deflate call is enough
+  out.resize(deflateBound(&stream, data.size()));
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = data.size();
+  stream.next_out = reinterpret_cast<Bytef*>(out.data());
+  stream.avail_out = out.size();
+
+  const int result = deflate(&stream, Z_FINISH);
+  out.resize(stream.total_out);
+  deflateEnd(&stream);
+  return result == Z_STREAM_END;
+}
+
+bool isCompressible(std::string_view contentType)
+{
+  contentType = contentType.substr(0, contentType.find(';'));
+  if (contentType.substr(0, 5) == "text/")
+    return true;
+  for (const std::string_view type : {"application/json", "application/javascript", "application/xml", "image/svg+xml"})
+  {
+    if (equalsIgnoreCase(contentType, type))
+      return true;
+  }
+  //structured types like "application/ld+json"
+  const size_t plus = contentType.rfind('+');
+  return plus != std::string_view::npos && (contentType.substr(plus) == "+json" || contentType.substr(plus) == "+xml");
+}
+
+}
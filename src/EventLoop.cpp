@@ -0,0 +1,894 @@
+#include "../include/EventLoop.h"
+
+#ifdef __linux__
+
+#include "../include/Utility.h"
+
+#include <iostream>
+
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+
+#define REACTOR_MAX_EVENTS 64
+#define REACTOR_STREAM_BUFFER (4 * SERVER_BUFLEN) // body bytes buffered for a streaming route
+#define REACTOR_WRITER_BUFFER (4 * SERVER_BUFLEN) // responce bytes written by a worker and not taken yet
+
+namespace rweb
+{
+
+bool getShouldClose();
+size_t getMaxBodySize();
+bool isStreamRoute(std::string_view method, std::string_view path);
+std::string describeError();
+
+//appends bytes to the output of the connection
+static void writeOutput(Connection& c, std::string_view data)
+{
+  if (c.output.empty() || c.output.back().file)
+    c.output.emplace_back();
+  c.output.back().data += data;
+}
+
+class Reactor::Stream : public ResponceStream
+{
+public:
+  Stream(Reactor& reactor, int fd, uint64_t id)
+  : m_reactor(reactor), m_fd(fd), m_id(id)
+  {
+  }
+
+  std::shared_ptr<ResponceWriter> open() override
+  {
+    if (!m_writer)
+      m_writer = m_reactor.openWriter(m_fd, m_id);
+    return m_writer;
+  }
+
+  const std::shared_ptr<ResponceWriter>& getWriter() const
+  {
+    return m_writer;
+  }
+
+private:
+  Reactor& m_reactor;
+  const int m_fd;
+  const uint64_t m_id;
+  std::shared_ptr<ResponceWriter> m_writer;
+};
+
+Reactor::Reactor(const RequestHandler handler, ThreadPool& workers, const int timeoutSeconds)
+: m_handler(handler), m_workers(workers), m_timeout(timeoutSeconds), m_epoll(-1), m_wakeFd(-1), m_running(false), m_exited(false), m_nextId(1)
+{
+}
+
+Reactor::~Reactor()
+{
+  stop();
+
+  //kept open until here: workers may still post to a stopped reactor
+  if (m_wakeFd >= 0)
+  {
+    close(m_wakeFd);
+    m_wakeFd = -1;
+  }
+}
+
+bool Reactor::start()
+{
+  m_epoll = epoll_create1(EPOLL_CLOEXEC);
+  if (m_epoll < 0)
+  {
+    if (getLogLevel() <= ERROR)
+      std::cerr << colorize(RED) << "[ERROR] Failed to create epoll instance: " << describeError() << colorize(NC) << "\n";
+    return false;
+  }
+
+  m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (m_wakeFd < 0)
+  {
+    if (getLogLevel() <= ERROR)
+      std::cerr << colorize(RED) << "[ERROR] Failed to create eventfd: " << describeError() << colorize(NC) << "\n";
+    close(m_epoll);
+    m_epoll = -1;
+    return false;
+  }
+
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.fd = m_wakeFd;
+  if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeFd, &ev) < 0)
+  {
+    if (getLogLevel() <= ERROR)
+      std::cerr << colorize(RED) << "[ERROR] epoll_ctl failed: " << describeError() << colorize(NC) << "\n";
+    close(m_wakeFd);
+    close(m_epoll);
+    m_wakeFd = -1;
+    m_epoll = -1;
+    return false;
+  }
+
+  if (m_listener)
+  {
+    ev.events = EPOLLIN;
+    ev.data.fd = m_listener->getSocket().sockfd;
+    if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, ev.data.fd, &ev) < 0)
+    {
+      if (getLogLevel() <= ERROR)
+        std::cerr << colorize(RED) << "[ERROR] epoll_ctl failed: " << describeError() << colorize(NC) << "\n";
+      close(m_wakeFd);
+      close(m_epoll);
+      m_wakeFd = -1;
+      m_epoll = -1;
+      return false;
+    }
+  }
+
+  m_lastSweep = std::chrono::steady_clock::now();
+  m_running = true;
+  m_thread = std::thread(&Reactor::run, this);
+  return true;
+}
+
+void Reactor::stop()
+{
+  if (m_running.exchange(false))
+  {
+    wake();
+  }
+
+  if (m_thread.joinable())
+    m_thread.join();
+
+  if (m_epoll >= 0)
+  {
+    close(m_epoll);
+    m_epoll = -1;
+  }
+}
+
+void Reactor::addClient(SOCKFD socket)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_pendingMutex);
+    m_pending.push_back(socket);
+  }
+  wake();
+}
+
+void Reactor::setListener(std::shared_ptr<Socket> listener)
+{
+  m_listener = listener;
+}
+
+void Reactor::complete(Completion&& completion)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_completedMutex);
+    m_completed.push_back(std::move(completion));
+  }
+  wake();
+}
+
+void Reactor::wake()
+{
+  const uint64_t one = 1;
+  if (write(m_wakeFd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+  {
+    if (getLogLevel() <= ERROR)
+      std::cerr << colorize(RED) << "[ERROR] Failed to wake reactor: " << describeError() << colorize(NC) << "\n";
+  }
+}
+
+void Reactor::addPendingClients()
+{
+  std::vector<SOCKFD> pending;
+  {
+    std::lock_guard<std::mutex> lock(m_pendingMutex);
+    pending.swap(m_pending);
+  }
+
+  for (auto& s : pending)
+    registerClient(s);
+}
+
+void Reactor::registerClient(SOCKFD s)
+{
+  //sockets are already non-blocking (see Socket::acceptClient)
+  epoll_event ev{};
+  ev.events = EPOLLIN | EPOLLRDHUP;
+  ev.data.fd = s.sockfd;
+  if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, s.sockfd, &ev) < 0)
+  {
+    if (getLogLevel() <= ERROR)
+      std::cerr << colorize(RED) << "[ERROR] epoll_ctl failed: " << describeError() << colorize(NC) << "\n";
+    Socket::closeSocket(s);
+    return;
+  }
+
+  auto c = std::make_unique<Connection>();
+  c->socket = s;
+  c->id = m_nextId++;
+  c->events = ev.events;
+  c->lastActivity = std::chrono::steady_clock::now();
+  m_connections[s.sockfd] = std::move(c);
+}
+
+void Reactor::acceptClients()
+{
+  while (true)
+  {
+    std::optional<SOCKFD> newSockOpt = m_listener->acceptClient();
+    if (!newSockOpt)
+    {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != ECONNABORTED && !getShouldClose())
+      {
+        if (getLogLevel() <= ERROR)
+          std::cerr << colorize(RED) << "[ERROR] accept failed: " << describeError() << colorize(NC) << "\n";
+      }
+      return;
+    }
+
+    registerClient(*newSockOpt);
+  }
+}
+
+void Reactor::run()
+{
+  epoll_event events[REACTOR_MAX_EVENTS];
+
+  while (m_running && !getShouldClose())
+  {
+    int n = epoll_wait(m_epoll, events, REACTOR_MAX_EVENTS, 1000);
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      if (getLogLevel() <= ERROR)
+        std::cerr << colorize(RED) << "[ERROR] epoll_wait failed: " << describeError() << colorize(NC) << "\n";
+      break;
+    }
+
+    for (int i=0;i<n;++i)
+    {
+      const int fd = events[i].data.fd;
+      if (fd == m_wakeFd)
+      {
+        uint64_t value;
+        while (read(m_wakeFd, &value, sizeof(value)) > 0);
+        addPendingClients();
+        finishWritten();
+        finishCompleted();
+        finishResumed();
+        continue;
+      }
+
+      if (m_listener && fd == m_listener->getSocket().sockfd)
+      {
+        acceptClients();
+        continue;
+      }
+
+      auto it = m_connections.find(fd);
+      if (it == m_connections.end())
+        continue;
+      Connection& c = *it->second;
+
+      if (events[i].events & EPOLLERR)
+      {
+        closeConnection(fd);
+        continue;
+      }
+
+      if ((events[i].events & EPOLLOUT) && (!flush(c) || !pumpWriter(c)))
+      {
+        closeConnection(fd);
+        continue;
+      }
+
+      if ((events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) && !onReadable(c))
+      {
+        closeConnection(fd);
+        continue;
+      }
+
+      if (!c.keepAlive && !c.busy && c.output.empty())
+        closeConnection(fd);
+    }
+
+    closeIdleConnections();
+  }
+
+  //cleanup
+  addPendingClients(); // sockets which were never registered
+  for (auto& it : m_connections)
+  {
+    if (it.second->stream)
+      it.second->stream->fail(); // wakes the worker waiting for the body
+    if (it.second->writer)
+      it.second->writer->close(); // wakes the worker waiting for the socket
+    Socket::closeSocket(it.second->socket);
+  }
+  m_connections.clear();
+
+  //writers opened from now on are closed right away by openWriter
+  std::lock_guard<std::mutex> lock(m_writtenMutex);
+  m_exited = true;
+  for (auto& w : m_written)
+  {
+    if (w.writer)
+      w.writer->close();
+  }
+  m_written.clear();
+}
+
+bool Reactor::onReadable(Connection& c)
+{
+  char buffer[SERVER_BUFLEN];
+  bool peerClosed = false;
+
+  //do not buffer more than one pipelined request head while a worker is busy
+  if (!(c.busy && c.input.size() >= SERVER_BUFLEN))
+  {
+    //one read per wakeup: head and body limits are checked before more is buffered and
+    //a fast sender does not hold up the other connections. The rest is reported by epoll again
+    ssize_t n;
+    do
+      n = recv(c.socket.sockfd, buffer, sizeof(buffer), 0);
+    while (n < 0 && errno == EINTR);
+
+    if (n > 0)
+    {
+      c.input.append(buffer, n);
+    } else if (n == 0)
+    {
+      peerClosed = true;
+    } else if (errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+      if (getLogLevel() <= ERROR && !getShouldClose())
+        std::cerr << colorize(RED) << "[ERROR] Failed to read from client socket: " << describeError() << colorize(NC) << "\n";
+      return false;
+    }
+  }
+
+  c.lastActivity = std::chrono::steady_clock::now();
+
+  if (peerClosed)
+  {
+    //peer will not send anything else. Close as soon as the responce is out
+    c.readClosed = true;
+    c.keepAlive = false;
+  }
+
+  if (!processInput(c))
+    return false;
+  updateEvents(c);
+  return true;
+}
+
+bool Reactor::processInput(Connection& c)
+{
+  if (c.stream)
+    return pumpStream(c);
+
+  //one request at a time per connection keeps responces in order.
+  //requests received before a half-close are still answered, unless a responce has closed the connection
+  if (c.busy || c.closing || (!c.keepAlive && !c.readClosed))
+    return true;
+
+  if (!c.bodyStarted)
+  {
+    //parser continues from the previous read
+    const RequestParser::Result result = c.parser.parse(c.input);
+    if (result == RequestParser::INCOMPLETE)
+      return true;
+
+    if (result == RequestParser::TOO_LARGE)
+      return refuse(c, HTTP_431);
+
+    if (result == RequestParser::COMPLETE)
+    {
+      //streaming routes read the body part by part, so its size is not limited
+      std::string_view target = c.parser.target.in(c.input);
+      const bool streaming = isStreamRoute(c.parser.method.in(c.input), target.substr(0, target.find('?')));
+
+      //framing errors are answered right away: the rest of the stream can't be trusted
+      switch (c.body.start(c.input, c.parser, streaming ? 0 : getMaxBodySize()))
+      {
+        case BodyDecoder::INVALID:
+          return refuse(c, HTTP_400);
+        case BodyDecoder::TOO_LARGE:
+          return refuse(c, HTTP_413);
+        case BodyDecoder::LENGTH_REQUIRED:
+          return refuse(c, HTTP_411);
+        case BodyDecoder::NOT_IMPLEMENTED:
+          return refuse(c, HTTP_501);
+        default:
+          break;
+      }
+      c.bodyStarted = true;
+
+      if (equalsIgnoreCase(c.parser.getHeader(c.input, "Expect"), "100-continue"))
+      {
+        writeOutput(c, "HTTP/1.1 100 Continue\r\n\r\n");
+        if (!flush(c))
+          return false;
+      }
+
+      if (streaming)
+        return startStream(c);
+    }
+  }
+
+  std::string rest; // bytes of the next request
+  if (c.bodyStarted)
+  {
+    switch (c.body.decode(c.input))
+    {
+      case BodyDecoder::INCOMPLETE:
+        return true;
+      case BodyDecoder::INVALID:
+        return refuse(c, HTTP_400);
+      case BodyDecoder::TOO_LARGE:
+      case BodyDecoder::LENGTH_REQUIRED:
+      case BodyDecoder::NOT_IMPLEMENTED:
+        return refuse(c, HTTP_413);
+      case BodyDecoder::COMPLETE:
+        break;
+    }
+
+    rest = c.input.substr(c.body.getConsumedEnd());
+    c.input.resize(c.body.getDecodedEnd()); // head + decoded body
+  }
+
+  //invalid requests are handed to the workers too (error handlers may be set)
+  auto request = std::make_shared<std::string>();
+  request->swap(c.input);
+  c.input.swap(rest);
+  RequestParser head = c.parser;
+  c.parser.reset();
+  c.body.reset();
+  c.bodyStarted = false;
+
+  const int fd = c.socket.sockfd;
+  const uint64_t id = c.id;
+  c.busy = true;
+  const bool queued = m_workers.trySubmit([this, fd, id, request, head = std::move(head)](){
+    Completion done{fd, id, {}, false, nullptr};
+    Stream stream(*this, fd, id);
+    done.keepAlive = m_handler(request, head, nullptr, stream, done.responce);
+    done.writer = stream.getWriter();
+    complete(std::move(done));
+  });
+
+  if (!queued)
+  {
+    //overloaded. Refuse the request without touching the workers
+    c.busy = false;
+    if (getLogLevel() <= WARNING)
+      std::cout << colorize(YELLOW) << "[WARNING] Worker queue is full!" << colorize(NC) << "\n";
+    return refuse(c, HTTP_503);
+  }
+
+  return true;
+}
+
+bool Reactor::startStream(Connection& c)
+{
+  //worker gets only the head, the body follows through the reader
+  auto request = std::make_shared<std::string>(c.input, 0, c.parser.getHeadSize());
+  RequestParser head = c.parser;
+  c.parser.reset();
+
+  const int fd = c.socket.sockfd;
+  const uint64_t id = c.id;
+  auto body = std::make_shared<BodyReader>(REACTOR_STREAM_BUFFER, [this, fd, id](){ resume(fd, id); });
+  c.busy = true;
+  c.stream = body;
+  const bool queued = m_workers.trySubmit([this, fd, id, request, head = std::move(head), body](){
+    Completion done{fd, id, {}, false, nullptr};
+    Stream stream(*this, fd, id);
+    done.keepAlive = m_handler(request, head, body, stream, done.responce);
+    done.writer = stream.getWriter();
+    complete(std::move(done));
+  });
+
+  if (!queued)
+  {
+    c.busy = false;
+    c.stream = nullptr;
+    if (getLogLevel() <= WARNING)
+      std::cout << colorize(YELLOW) << "[WARNING] Worker queue is full!" << colorize(NC) << "\n";
+    return refuse(c, HTTP_503);
+  }
+
+  return pumpStream(c);
+}
+
+bool Reactor::pumpStream(Connection& c)
+{
+  //full reader stops the input (see updateEvents) until the route takes some bytes
+  if (!c.stream || c.stream->isFull())
+    return true;
+
+  const BodyDecoder::Result result = c.body.decode(c.input);
+  if (result != BodyDecoder::INCOMPLETE && result != BodyDecoder::COMPLETE)
+  {
+    //route is already running and answers itself. The connection is closed after that
+    c.stream->fail();
+    c.stream = nullptr;
+    c.body.reset();
+    c.bodyStarted = false;
+    c.input.clear();
+    c.keepAlive = false;
+    c.closing = true;
+    return true;
+  }
+
+  c.stream->push(c.body.takeBody(c.input));
+
+  if (result == BodyDecoder::COMPLETE)
+  {
+    //'input' keeps the next request, it waits until the route answers
+    c.stream->finish();
+    c.stream = nullptr;
+    c.body.reset();
+    c.bodyStarted = false;
+  } else if (c.readClosed)
+  {
+    //peer will not send the rest
+    c.stream->fail();
+    c.stream = nullptr;
+  }
+  return true;
+}
+
+void Reactor::resume(int fd, uint64_t id)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_resumedMutex);
+    m_resumed.emplace_back(fd, id);
+  }
+  wake();
+}
+
+void Reactor::finishResumed()
+{
+  std::vector<std::pair<int, uint64_t>> resumed;
+  {
+    std::lock_guard<std::mutex> lock(m_resumedMutex);
+    resumed.swap(m_resumed);
+  }
+
+  for (auto& r : resumed)
+  {
+    auto it = m_connections.find(r.first);
+    if (it == m_connections.end() || it->second->id != r.second)
+      continue;
+
+    Connection& c = *it->second;
+    c.lastActivity = std::chrono::steady_clock::now(); // input was stopped because of the route
+    if (!pumpStream(c))
+    {
+      closeConnection(r.first);
+      continue;
+    }
+    updateEvents(c);
+  }
+}
+
+std::shared_ptr<ResponceWriter> Reactor::openWriter(int fd, uint64_t id)
+{
+  //the reactor is told about the writer before its data, both go through 'm_written'
+  auto writer = std::make_shared<ResponceWriter>(REACTOR_WRITER_BUFFER, [this, fd, id](){ written(Written{fd, id, nullptr}); });
+  written(Written{fd, id, writer});
+  return writer;
+}
+
+void Reactor::written(Written&& written)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_writtenMutex);
+    if (m_exited)
+    {
+      //nobody would take its data, the worker must not wait for it
+      if (written.writer)
+        written.writer->close();
+      return;
+    }
+    m_written.push_back(std::move(written));
+  }
+  wake();
+}
+
+void Reactor::finishWritten()
+{
+  std::vector<Written> written;
+  {
+    std::lock_guard<std::mutex> lock(m_writtenMutex);
+    written.swap(m_written);
+  }
+
+  for (auto& w : written)
+  {
+    auto it = m_connections.find(w.fd);
+    if (it == m_connections.end() || it->second->id != w.id)
+    {
+      if (w.writer)
+        w.writer->close(); // connection was closed, the worker must not wait for it
+      continue;
+    }
+
+    Connection& c = *it->second;
+    if (w.writer && !w.writer->isClosed()) // closed writers were finished by their completion already
+      c.writer = w.writer;
+    if (!pumpWriter(c))
+      closeConnection(w.fd);
+  }
+}
+
+bool Reactor::pumpWriter(Connection& c)
+{
+  //next part is taken when the previous one is sent, the worker waits meanwhile
+  std::string data;
+  while (c.writer && c.output.empty() && c.writer->take(data))
+  {
+    writeOutput(c, data);
+    if (!flush(c))
+      return false;
+  }
+  return true;
+}
+
+bool Reactor::refuse(Connection& c, const std::string& statusResponce)
+{
+  c.keepAlive = false;
+  c.closing = true;
+  writeOutput(c, statusResponce + "Content-Length: 0\r\nConnection: close\r\n" +
+    (statusResponce == HTTP_503 ? "Retry-After: 1\r\n" : "") + "\r\n");
+
+  if (getLogLevel() <= INFO)
+    std::cout << "[RESPONCE] " << colorize(RED) << "-- " << statusResponce.substr(9, statusResponce.size()-11) << colorize(NC) << "\n";
+  return flush(c);
+}
+
+void Reactor::finishCompleted()
+{
+  std::vector<Completion> completed;
+  {
+    std::lock_guard<std::mutex> lock(m_completedMutex);
+    completed.swap(m_completed);
+  }
+
+  for (auto& done : completed)
+  {
+    auto it = m_connections.find(done.fd);
+    if (it == m_connections.end() || it->second->id != done.id)
+      continue; // connection was closed while the request was processed
+
+    Connection& c = *it->second;
+    if (c.stream)
+    {
+      //route answered before the whole body arrived. The rest of it can't be skipped reliably
+      c.stream->fail();
+      c.stream = nullptr;
+      c.body.reset();
+      c.bodyStarted = false;
+      c.input.clear();
+      done.keepAlive = false;
+    }
+
+    if (done.writer)
+    {
+      //handler has returned, the rest of the written part is in the writer
+      std::string data;
+      if (done.writer->take(data))
+        writeOutput(c, data);
+      done.writer->close();
+      c.writer = nullptr;
+    }
+
+    c.busy = false;
+    c.closing = c.closing || !done.keepAlive;
+    c.keepAlive = !c.closing && !c.readClosed;
+    for (auto& segment : done.responce)
+    {
+      if (segment.file)
+        c.output.push_back(std::move(segment));
+      else
+        writeOutput(c, segment.data);
+    }
+
+    if (!flush(c) || !processInput(c))
+    {
+      closeConnection(done.fd);
+      continue;
+    }
+    updateEvents(c);
+
+    if (!c.keepAlive && !c.busy && c.output.empty())
+      closeConnection(done.fd);
+  }
+}
+
+bool Reactor::flush(Connection& c)
+{
+  while (!c.output.empty())
+  {
+    const OutputSegment& segment = c.output.front();
+    const size_t size = segment.file ? segment.length : segment.data.size();
+    if (c.outputOffset == size)
+    {
+      c.output.pop_front();
+      c.outputOffset = 0;
+      continue;
+    }
+
+    ssize_t n;
+    if (segment.file)
+    {
+      //the kernel copies the file to the socket directly
+      off_t offset = segment.offset + c.outputOffset;
+      n = sendfile(c.socket.sockfd, segment.file->getFd(), &offset, size - c.outputOffset);
+      if (n == 0)
+      {
+        if (getLogLevel() <= ERROR)
+          std::cerr << colorize(RED) << "[ERROR] Failed to send file: it is shorter than expected" << colorize(NC) << "\n";
+        return false;
+      }
+    } else {
+      //MSG_MORE - headers share packets with the file which follows them
+      const int more = c.output.size() > 1 ? MSG_MORE : 0;
+      n = send(c.socket.sockfd, segment.data.data() + c.outputOffset, size - c.outputOffset, MSG_NOSIGNAL | more);
+    }
+    if (n >= 0)
+    {
+      c.outputOffset += n;
+      continue;
+    }
+
+    if (errno == EINTR)
+      continue;
+
+    if (errno == EAGAIN || errno == EWOULDBLOCK)
+    {
+      updateEvents(c);
+      return true;
+    }
+
+    if (getLogLevel() <= ERROR)
+      std::cerr << colorize(RED) << "[ERROR] Failed to write to socket: " << describeError() << colorize(NC) << "\n";
+    return false;
+  }
+
+  updateEvents(c);
+  c.lastActivity = std::chrono::steady_clock::now();
+  return true;
+}
+
+void Reactor::updateEvents(Connection& c)
+{
+  //stop polling for input once the connection is going to be closed or while the input is full
+  uint32_t events = 0;
+  if (c.keepAlive && !(c.busy && c.input.size() >= SERVER_BUFLEN))
+    events = EPOLLIN | EPOLLRDHUP;
+  if (!c.output.empty())
+    events |= EPOLLOUT;
+
+  if (events == c.events)
+    return;
+
+  epoll_event ev{};
+  ev.events = events;
+  ev.data.fd = c.socket.sockfd;
+  if (epoll_ctl(m_epoll, EPOLL_CTL_MOD, c.socket.sockfd, &ev) < 0)
+  {
+    if (getLogLevel() <= ERROR)
+      std::cerr << colorize(RED) << "[ERROR] epoll_ctl failed: " << describeError() << colorize(NC) << "\n";
+    return;
+  }
+  c.events = events;
+}
+
+void Reactor::closeConnection(int fd)
+{
+  auto it = m_connections.find(fd);
+  if (it == m_connections.end())
+    return;
+
+  epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+  if (it->second->stream)
+    it->second->stream->fail();
+  if (it->second->writer)
+    it->second->writer->close();
+  Socket::closeSocket(it->second->socket);
+  m_connections.erase(it);
+}
+
+void Reactor::closeIdleConnections()
+{
+  const auto now = std::chrono::steady_clock::now();
+  if (now - m_lastSweep < std::chrono::seconds(1))
+    return;
+  m_lastSweep = now;
+
+  std::vector<int> idle;
+  for (auto& it : m_connections)
+  {
+    //streaming route waiting for the body is idle too, unless the route itself is slow.
+    //so is a worker waiting for the client to take the written responce
+    const Connection& c = *it.second;
+    const bool waiting = !c.busy || (c.stream && !c.stream->isFull()) || (c.writer && !c.output.empty());
+    if (waiting && now - c.lastActivity >= std::chrono::seconds(m_timeout))
+      idle.push_back(it.first);
+  }
+
+  for (int fd : idle)
+  {
+    if (getLogLevel() <= WARNING)
+      std::cout << colorize(YELLOW) << "[WARNING] Connection timed out!" << colorize(NC) << "\n";
+    closeConnection(fd);
+  }
+}
+
+EventLoop::EventLoop(const RequestHandler handler, ThreadPool& workers, const int timeoutSeconds, unsigned int reactorCount)
+: m_next(0)
+{
+  if (reactorCount == 0)
+    reactorCount = std::thread::hardware_concurrency();
+  if (reactorCount == 0)
+    reactorCount = 1;
+
+  for (unsigned int i=0;i<reactorCount;++i)
+    m_reactors.push_back(std::make_unique<Reactor>(handler, workers, timeoutSeconds));
+}
+
+EventLoop::~EventLoop()
+{
+  stop();
+}
+
+void EventLoop::setListeners(const std::vector<std::shared_ptr<Socket>>& listeners)
+{
+  for (size_t i=0;i<m_reactors.size() && i<listeners.size();++i)
+    m_reactors[i]->setListener(listeners[i]);
+}
+
+size_t EventLoop::getReactorCount() const
+{
+  return m_reactors.size();
+}
+
+bool EventLoop::start()
+{
+  for (auto& r : m_reactors)
+  {
+    if (!r->start())
+    {
+      stop();
+      return false;
+    }
+  }
+
+  if (getLogLevel() <= INFO)
+    std::cout << "[SERVER] Started " << m_reactors.size() << " reactor thread(s)\n";
+  return true;
+}
+
+void EventLoop::stop()
+{
+  for (auto& r : m_reactors)
+    r->stop();
+}
+
+void EventLoop::dispatch(SOCKFD socket)
+{
+  m_reactors[m_next]->addClient(socket);
+  m_next = (m_next + 1) % m_reactors.size();
+}
+
+}
+
+#endif
@@ -0,0 +1,179 @@
+#include "../include/FileWatcher.h"
+
+#ifdef __linux__
+
+#include "../include/Utility.h"
+
+#include <iostream>
+#include <filesystem>
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+
+#define WATCHER_EVENTS (IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF)
+
+namespace rweb
+{
+
+std::string describeError();
+
+FileWatcher::FileWatcher(std::function<void(const std::string& path, bool isDirectory)> onChange)
+: m_onChange(std::move(onChange)), m_inotify(-1), m_wakeFd(-1), m_running(false)
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+  stop();
+}
+
+bool FileWatcher::start(const std::string& root)
+{
+  m_root = root;
+  while (m_root.size() > 1 && m_root.back() == '/')
+    m_root.pop_back();
+
+  m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (m_inotify < 0)
+  {
+    if (getLogLevel() <= ERROR)
+      std::cerr << colorize(RED) << "[ERROR] Failed to create inotify instance: " << describeError() << colorize(NC) << "\n";
+    return false;
+  }
+
+  m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (m_wakeFd < 0)
+  {
+    if (getLogLevel() <= ERROR)
+      std::cerr << colorize(RED) << "[ERROR] Failed to create eventfd: " << describeError() << colorize(NC) << "\n";
+    close(m_inotify);
+    m_inotify = -1;
+    return false;
+  }
+
+  addTree(m_root);
+  if (m_dirs.empty())
+  {
+    close(m_wakeFd);
+    close(m_inotify);
+    m_wakeFd = -1;
+    m_inotify = -1;
+    return false;
+  }
+
+  m_running = true;
+  m_thread = std::thread(&FileWatcher::run, this);
+  return true;
+}
+
+void FileWatcher::stop()
+{
+  if (m_running.exchange(false))
+  {
+    const uint64_t one = 1;
+    if (write(m_wakeFd, &one, sizeof(one)) < 0 && getLogLevel() <= ERROR)
+      std::cerr << colorize(RED) << "[ERROR] Failed to wake file watcher: " << describeError() << colorize(NC) << "\n";
+  }
+
+  if (m_thread.joinable())
+    m_thread.join();
+
+  if (m_wakeFd >= 0)
+  {
+    close(m_wakeFd);
+    m_wakeFd = -1;
+  }
+
+  if (m_inotify >= 0)
+  {
+    close(m_inotify);
+    m_inotify = -1;
+  }
+  m_dirs.clear();
+}
+
+void FileWatcher::addTree(const std::string& dir)
+{
+  const int wd = inotify_add_watch(m_inotify, dir.c_str(), WATCHER_EVENTS | IN_ONLYDIR);
+  if (wd < 0)
+  {
+    if (getLogLevel() <= WARNING)
+      std::cout << colorize(YELLOW) << "[RWEB] Warning! Can't watch '" << dir << "' for changes: " << describeError() << colorize(NC) << "\n";
+    return;
+  }
+  m_dirs[wd] = dir;
+
+  std::error_code ec;
+  for (std::filesystem::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec))
+  {
+    if (it->is_directory(ec) && !it->is_symlink(ec))
+      addTree(dir + "/" + it->path().filename().string());
+  }
+}
+
+void FileWatcher::run()
+{
+  //events are aligned as inotify_event
+  alignas(inotify_event) char buffer[16 * 1024];
+
+  pollfd fds[2];
+  fds[0].fd = m_inotify;
+  fds[0].events = POLLIN;
+  fds[1].fd = m_wakeFd;
+  fds[1].events = POLLIN;
+
+  while (m_running)
+  {
+    if (poll(fds, 2, -1) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      if (getLogLevel() <= ERROR)
+        std::cerr << colorize(RED) << "[ERROR] File watcher poll failed: " << describeError() << colorize(NC) << "\n";
+      return;
+    }
+
+    while (m_running)
+    {
+      const ssize_t n = read(m_inotify, buffer, sizeof(buffer));
+      if (n <= 0)
+        break;
+
+      for (ssize_t pos = 0; pos < n;)
+      {
+        const inotify_event* e = reinterpret_cast<const inotify_event*>(buffer + pos);
+        pos += sizeof(inotify_event) + e->len;
+
+        if (e->mask & IN_Q_OVERFLOW)
+        {
+          m_onChange(m_root, true); // changes were lost
+          continue;
+        }
+
+        auto dir = m_dirs.find(e->wd);
+        if (dir == m_dirs.end())
+          continue;
+
+        if (e->mask & IN_IGNORED) // watch is removed (directory is gone)
+        {
+          m_dirs.erase(dir);
+          continue;
+        }
+        if (e->len == 0) // event of the directory itself
+          continue;
+
+        const std::string path = dir->second + "/" + e->name;
+        const bool isDirectory = e->mask & IN_ISDIR;
+        if (isDirectory && (e->mask & (IN_CREATE | IN_MOVED_TO)))
+          addTree(path);
+        m_onChange(path, isDirectory);
+      }
+    }
+  }
+}
+
+}
+
+#endif
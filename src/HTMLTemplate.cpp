@@ -8,6 +8,10 @@
 #include <sstream>
 #include <optional>
 #include <ctime>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <unordered_map>
 
 namespace rweb
 { 
@@ -116,1930 +120,1283 @@ static const inline std::string stringifyJson(const nlohmann::json& json)
   }
 }
 
-static const inline std::string stringifyJson(const nlohmann::json::const_iterator& json)
+
+typedef std::vector<std::pair<TOKEN_TYPE, std::string>> Tokens;
+
+//variables visible while rendering. Loop variables shadow the json passed to renderJSON
+struct Scope
 {
-  if (json->is_null())
-  {
-    if (getLogLevel() <= WARNING)
-      std::cerr << colorize(YELLOW) << "[TEMPLATE] Cannot stringify empty json!" << colorize(NC) << "\n";
-    return "";
-  } else if (json->is_array())
-  {
-    if (getLogLevel() <= WARNING)
-      std::cerr << colorize(YELLOW) << "[TEMPLATE] Cannot stringify json array!" << colorize(NC) << "\n";
-    return "";
-  } else if (json->is_object())
-  {
-    if (getLogLevel() <= WARNING)
-      std::cerr << colorize(YELLOW) << "[TEMPLATE] Cannot stringify json object!" << colorize(NC) << "\n";
-    return "";
-  } else if (json->is_string())
-  {
-    return trim((std::string)*json);
-  } else if (json->is_number())
+  const nlohmann::json& root;
+  std::vector<std::pair<const std::string*, const nlohmann::json*>> locals; // innermost loop last
+
+  const nlohmann::json* find(const std::string& name) const
   {
-    std::stringstream ss;
-    ss << *json;
-    return ss.str();
-  } else {
-    if (getLogLevel() <= WARNING)
-      std::cerr << colorize(YELLOW) << "[TEMPLATE] Cannot stringify unsupported type json!" << colorize(NC) << "\n";
-    return "";
-  } 
-}
+    for (auto it = locals.rbegin(); it != locals.rend(); ++it)
+    {
+      if (*it->first == name)
+        return it->second;
+    }
+    auto ptr = root.find(name);
+    return ptr == root.end() ? nullptr : &*ptr;
+  }
+};
 
-static unsigned long long getCurrentLine(const std::string& file, const unsigned long long pos)
+//returns the value of "name.attr.attr" given as a list of names. nullptr if it is not found
+static const nlohmann::json* getJson(const Scope& scope, const std::vector<std::string>& names)
 {
-  int cnt = 1;
-  for (int i=0;i<=pos;++i)
+  const nlohmann::json* leaf = names.empty() ? nullptr : scope.find(names[0]);
+  for (size_t i=1;leaf && i<names.size();++i)
   {
-    if (file[i] == '\n')
-      cnt++;
+    auto ptr = leaf->find(names[i]);
+    leaf = ptr == leaf->end() ? nullptr : &*ptr;
   }
-  return cnt;
+  return leaf;
 }
 
-static const std::optional<nlohmann::json> getJson(const nlohmann::json& root, const std::vector<std::string>& names)
+static std::string joinPath(const std::vector<std::string>& names)
 {
-  const nlohmann::json* leaf = &root;
+  std::string res;
   for (const auto& name: names)
-  {
-    if (leaf->contains(name))
-    {
-      leaf = &leaf->at(name);
-    } else {
-      if (getLogLevel() <= ERROR)
-        std::cerr << colorize(RED) << "[TEMPLATE] Cannot find the attribute \"" << name << "\"!" << colorize(NC) << "\n";
-      return std::nullopt;
-    }
-  }
-  return *leaf;
+    res += (res.empty() ? "" : ".") + name;
+  return res;
 }
 
-//false on an error
-static bool lexer_analyze(HTMLTemplate* templ, std::string& code, const nlohmann::json& json);
+static inline bool isOperator(const char c)
+{
+  return c == '*' || c == '-' || c == '+' || c == '/' || c == '%';
+}
 
-static const std::optional<std::string> parser_eval(HTMLTemplate* templ, std::vector<std::pair<TOKEN_TYPE, std::string>>& input, const nlohmann::json& _json, bool* error = nullptr)
+static inline bool isComparative(const char c)
 {
-  nlohmann::json json = _json; //working copy
-  std::string result = "";
-  std::string expression = "";
+  return c == '=' || c == '!' || c == '>' || c == '<';
+}
 
-  /*for (auto it : input)
-    {
-      std::cout << "{ " << typeToString(it.first) << " - " << it.second << " }\n";
-    }std::cout << "----TOKENS_END----\n";*/
+//---LEXER---
 
-  if (input.begin()->first == IF && (std::find_if(input.begin(), input.end(), [](const std::pair<TOKEN_TYPE, std::string>& in){return in.first == COMPARISON_OPERATOR;}) == input.end()))
+//splits the condition of "if" into tokens. Returns false if a string is not closed
+static bool tokenizeCondition(const std::string& cond, Tokens& tokens)
+{
+  std::string tmp = "";
+  for (size_t j=0;j<=cond.size();++j)
   {
-    //check if
-    auto token = input.begin();
-    bool found = true;
-
-    nlohmann::json val;
-    std::vector<std::string> attributes;
-    while (true)
+    if (j == cond.size())
     {
-      ++token;
-      if (token == input.end())
+      tmp = trim(tmp);
+      if (tmp.empty())
+        break;
+      char last = *tmp.rbegin();
+      char first = *tmp.begin();
+      if (isalpha(first) || last == '_')
       {
-        if (getLogLevel() <= ERROR)
-          std::cerr << colorize(RED) << "[TEMPLATE] Error! Unexpected end of input in the IF statement!" << colorize(NC) << "\n";
-        return std::nullopt;
-      }
-
-      if (token->first == VARIABLE)
+        tokens.emplace_back(VARIABLE, tmp);
+      } else if (isdigit(first))
       {
-        std::string name = token->second;
-
-        token++;
-        if (token == input.end())
-        {
-          if (getLogLevel() <= ERROR)
-            std::cerr << colorize(RED) << "[TEMPLATE] Error! Unexpected end of input in the IF statement!" << colorize(NC) << "\n";
-          return std::nullopt;
-        }
-
-        if (token->first == MATH && token->second == ".")
-        {
-          attributes.push_back(name);
-          while (true)
-          {
-            token++;
-            if (token == input.end())
-            {
-              if (getLogLevel() <= ERROR)
-                std::cerr << colorize(RED) << "[TEMPLATE] Error! Unexpected end of input in the IF statement!" << colorize(NC) << "\n";
-              return std::nullopt;
-            }
-
-            if (token->first != MATH && token->first != VARIABLE)
-              break;
-
-            if (token->first == VARIABLE)
-            {
-              attributes.push_back(token->second);
-            }
-
-            token++;
-            if (token == input.end())
-            {
-              if (getLogLevel() <= ERROR)
-                std::cerr << colorize(RED) << "[TEMPLATE] Error! Unexpected end of input in the IF statement!" << colorize(NC) << "\n";
-              return std::nullopt;
-            } 
-
-            if (token->first != MATH || token->second != ".")
-            {
-              break;
-            }
-          }
-
-          auto r = getJson(json, attributes);
-          if (!r)
-          {
-            found = false;
-            break;
-          }
-
-          {
-            val = *r;
-            attributes.clear();
-          }
-        } else {
-          token--;
-          attributes.clear();
-
-          auto ptr = json.find(token->second);
-          token++;
-          if (ptr != json.end())
-          {
-            val = *ptr;
-          } else {
-            found = false;
-            break;
-          }
-        }
-
-        break;
-      } else if (token->first == MATH)
+        tokens.emplace_back(MATH, tmp);
+      } else if (last == '.') // format like 3. = 3.0
       {
-        val = std::stoi(token->second);
-      } else if (token->first == IF_BODY)
+        tokens.emplace_back(MATH, tmp + "0");
+      } else if (isOperator(last))
       {
-        break;
-      } else if (token->first == STRING)
+        tokens.emplace_back(OPERATOR, tmp);
+      } else if (isComparative(last))
       {
-        val = token->second;
-      } else {
-        if (getLogLevel() <= ERROR)
-          std::cerr << colorize(RED) << "[TEMPLATE] Error! Unexpected token " << typeToString(token->first) << colorize(NC) << "\n";
-        return std::nullopt;
+        tokens.emplace_back(COMPARISON_OPERATOR, tmp);
       }
+      break;
     }
 
-    std::string true_body = "";
-    std::string else_body = "";
-
-    if (token != input.end())
+    if (cond[j] == '"')
     {
-      if (token->first != IF_BODY)
+      char last = tmp.empty() ? ' ' : *tmp.rbegin();
+      if (isalpha(last) || last == '_')
       {
-        if (getLogLevel() <= ERROR)
-          std::cerr << colorize(RED) << "[TEMPLATE] Error! Cannot find the IF_BODY token!" << colorize(NC) << "\n";
-        return std::nullopt;
-      }
-
-      true_body = trim(token->second);
-      token++;
-
-      if (token != input.end())
+        tokens.emplace_back(VARIABLE, trim(tmp));
+      } else if (isdigit(last))
       {
-        if (token->first != ELSE_BODY)
-        {
-          else_body = "";
-        } else {
-          else_body = trim(token->second);
-        }
+        tokens.emplace_back(MATH, trim(tmp));
+      } else if (last == '.') // format like 3. = 3.0
+      {
+        tokens.emplace_back(MATH, trim(tmp) + "0");
+      } else if (isOperator(last))
+      {
+        tokens.emplace_back(OPERATOR, trim(tmp));
+      } else if (isComparative(last))
+      {
+        tokens.emplace_back(COMPARISON_OPERATOR, trim(tmp));
       }
+      tmp = "";
 
-    }
+      std::size_t strEnd = cond.find('"', j+1);
+      if (strEnd == std::string::npos)
+        return false;
 
-    bool result;
+      tokens.emplace_back(STRING, cond.substr(j+1, strEnd-j-1));
+      j = strEnd;
+      continue;
+    }
 
-    if (!found)
+    if (tmp == "")
+    {
+      tmp += cond[j];
+    }
+    else if ( (isalpha(*tmp.rbegin()) || *tmp.rbegin() == '_') && !(isalpha(cond[j]) || isdigit(cond[j]) || cond[j] == '_'))
     {
-      result = false;
+      tokens.emplace_back(VARIABLE, trim(tmp));
+      tmp = cond[j];
+    } else if ( (isdigit(*tmp.rbegin()) || *tmp.rbegin() == '.' || *tmp.rbegin() == '-') && !(isdigit(cond[j]) || cond[j] == '.' || cond[j] == '-'))
+    {
+      tokens.emplace_back(MATH, trim(tmp));
+      tmp = cond[j];
+    } else if (isOperator(*tmp.rbegin()) && !isOperator(cond[j]))
+    {
+      tokens.emplace_back(OPERATOR, trim(tmp));
+      tmp = cond[j];
+    } else if (isComparative(*tmp.rbegin()) && !isComparative(cond[j]))
+    {
+      tokens.emplace_back(COMPARISON_OPERATOR, trim(tmp));
+      tmp = cond[j];
     } else {
-      if (val.is_null())
-      {
-        result = false;
-      } else if (val.is_array() || val.is_object())
-      {
-        result = val.size() > 0;
-      } else if (val.is_string())
-      {
-        try {
-          int id = std::stoi((std::string)val);
-          result = id != 0;
-        } catch (std::invalid_argument& e)
-        {
-          result = !trim((std::string)val).empty();
-        }
-      } else if (val.is_number())
-      {
-        result = static_cast<int>(val) != 0;
-      } else {
-        if (getLogLevel() <= ERROR)
-          std::cerr << colorize(RED) << "[TEMPLATE] Cannot check unsupported type json!" << colorize(NC) << "\n";
-        return std::nullopt;
-      }
+      tmp += cond[j];
     }
+  }
+  return true;
+}
 
-    return result ? true_body : else_body;
+//adds the iterator of "for" ("name" or "function(args)"). False if the argument list is not started with '('
+static bool addIterator(const std::string& iterator, Tokens& tokens, bool skipEmpty)
+{
+  std::size_t pos = iterator.find("(");
+  bool found = pos != std::string::npos;
+  std::size_t pos2 = iterator.find(")");
+  if (!found && pos2 != std::string::npos)
+    return false;
 
-  } else if (input.begin()->first == IF)
+  if (found)
   {
-    //default if
-    auto token = input.begin()+1;
-
-    std::string lv = "";
-    std::string op = "";
-    std::string rv = "";
-    std::string true_body = "";
-    std::string else_body = ""; 
-
-    //lv
-    std::vector<std::string> attributes; //temporary
-    while (true)
+    tokens.emplace_back(ITERATOR, iterator.substr(0, pos));
+    auto args = split(iterator.substr(pos+1, pos2-pos-1), ",");
+    for (auto ite: args)
     {
-      if (token == input.end())
-      {
-        if (getLogLevel() <= ERROR)
-          std::cerr << colorize(RED) << "[TEMPLATE] Error! Unexpected end of input in the IF statement!" << colorize(NC) << "\n";
-        return std::nullopt;
-      }
-
-      if (token->first == MATH)
-      {
-        lv += token->second;
-      } else if (token->first == OPERATOR)
-      {
-        lv += token->second;
-      } else if (token->first == VARIABLE)
-      {
-        std::string name = token->second;
-
-        token++;
-        if (token == input.end())
-        {
-          if (getLogLevel() <= ERROR)
-            std::cerr << colorize(RED) << "[TEMPLATE] Error! Unexpected end of input in the IF statement!" << colorize(NC) << "\n";
-          return std::nullopt;
-        }
-
-        if (token->first == MATH && token->second == ".")
-        {
-          attributes.push_back(name);
-          while (true)
-          {
-            token++;
-            if (token == input.end())
-            {
-              if (getLogLevel() <= ERROR)
-                std::cerr << colorize(RED) << "[TEMPLATE] Error! Unexpected end of input in the IF statement!" << colorize(NC) << "\n";
-              return std::nullopt;
-            }
-
-            if (token->first != MATH && token->first != VARIABLE)
-              break;
-
-            if (token->first == VARIABLE)
-            {
-              attributes.push_back(token->second);
-            }
-
-            token++;
-            if (token == input.end())
-            {
-              if (getLogLevel() <= ERROR)
-                std::cerr << colorize(RED) << "[TEMPLATE] Error! Unexpected end of input in the IF statement!" << colorize(NC) << "\n";
-              return std::nullopt;
-            } 
-
-            if (token->first != MATH || token->second != ".")
-            {
-              break;
-            }
-          }
-
-          auto r = getJson(json, attributes);
-          if (!r)
-          {
-            if (getLogLevel() <= ERROR)
-            {
-              std::cerr << colorize(RED) << "[TEMPLATE] Error! Cannot find the \"" << name;
-
-              for (int it = 1; it < attributes.size(); ++it)
-              {
-                std::cerr << "." << attributes[it];
-              }
-              std::cerr << colorize(NC) << "\n";
-            }
-            return std::nullopt;
-          }
-
-          {
-            nlohmann::json val = *r;
-            lv += stringifyJson(val);
-            attributes.clear();
-          }
-          token--;
-        } else {
-          token--;
-          attributes.clear();
-
-          nlohmann::json val;
-          auto ptr = json.find(token->second);
-          bool unfound = false;
-          if (ptr != json.end())
-          {
-            val = *ptr;
-            lv += stringifyJson(val);
-          } else {
-            if (getLogLevel() <= ERROR)
-              std::cerr << colorize(RED) << "[TEMPLATE] Error! Cannot find the \"" << token->second << "\"!" << colorize(NC) << "\n";
-            return std::nullopt;
-          }
-        }
-
-      } else if (token->first == STRING)
-      {
-        lv += token->second;
-      } else if (token->first == COMPARISON_OPERATOR)
-      {
-        op = token->second;
-        break;
-      } else {
-        if (getLogLevel() <= ERROR)
-          std::cerr << colorize(RED) << "[TEMPLATE] Unexpected token " << typeToString(token->first) << " in the IF statement!" << colorize(NC) << "\n";
-        return std::nullopt;
-      }
-
-      token++;
+      if (!skipEmpty || !trim(ite).empty())
+        tokens.emplace_back(ARGUMENT, trim(ite));
     }
+  } else {
+    tokens.emplace_back(VARIABLE, iterator);
+  }
+  return true;
+}
 
-    //rv 
+//splits the statement of "for" into tokens. Returns false if the argument list is not started with '('
+static bool tokenizeFor(const std::string& cond, Tokens& tokens)
+{
+  bool variablesProcessed = false;
+  std::string tmp = "";
+  for (size_t j=0;j<=cond.size();++j)
+  {
+    if (j == cond.size())
     {
-      token++;
-      while (true)
+      if (tmp.empty())
+        break;
+      char last = *tmp.rbegin();
+      if (isalpha(last) || last == '_' || last == ')' || last == '(')
       {
-        if (token == input.end())
-        {
-          if (getLogLevel() <= ERROR)
-            std::cerr << colorize(RED) << "[TEMPLATE] Error! Unexpected end of input in the IF statement!" << colorize(NC) << "\n";
-          return std::nullopt;
-        }
-
-        if (token->first == MATH)
+        if (!variablesProcessed)
         {
-          rv += token->second;
-        } else if (token->first == OPERATOR)
-        {
-          rv += token->second;
-        } else if (token->first == VARIABLE)
-        {
-          std::string name = token->second;
-
-          token++;
-          if (token == input.end())
-          {
-            if (getLogLevel() <= ERROR)
-              std::cerr << colorize(RED) << "[TEMPLATE] Error! Unexpected end of input in the IF statement!" << colorize(NC) << "\n";
-            return std::nullopt;
-          }
-
-          if (token->first == MATH && token->second == ".")
+          if (trim(tmp) == "in")
           {
-            attributes.push_back(name);
-            while (true)
-            {
-              token++;
-              if (token == input.end())
-              {
-                if (getLogLevel() <= ERROR)
-                  std::cerr << colorize(RED) << "[TEMPLATE] Error! Unexpected end of input in the IF statement!" << colorize(NC) << "\n";
-                return std::nullopt;
-              }
-
-              if (token->first != MATH && token->first != VARIABLE)
-                break;
-
-              if (token->first == VARIABLE)
-              {
-                attributes.push_back(token->second);
-              }
-
-              token++;
-              if (token == input.end())
-              {
-                if (getLogLevel() <= ERROR)
-                  std::cerr << colorize(RED) << "[TEMPLATE] Error! Unexpected end of input in the IF statement!" << colorize(NC) << "\n";
-                return std::nullopt;
-              } 
-
-              if (token->first != MATH || token->second != ".")
-              {
-                break;
-              }
-            }
-
-            auto r = getJson(json, attributes);
-            if (!r)
-            {
-              if (getLogLevel() <= ERROR)
-              {
-                std::cerr << colorize(RED) << "[TEMPLATE] Error! Cannot find the \"" << name;
-                for (int it = 1; it < attributes.size(); ++it)
-                {
-                  std::cerr << "." << attributes[it];
-                }
-                std::cerr << colorize(NC) << "\n";
-              }
-              return std::nullopt;
-            }
-
-            nlohmann::json val = *r;
-            rv += stringifyJson(val);
-            attributes.clear();
-          } else {
-            token--;
-            attributes.clear();
-
-            nlohmann::json val;
-            auto ptr = json.find(token->second);
-            if (ptr != json.end())
-            {
-              val = *ptr;
-              rv += stringifyJson(val);
-            } else {
-              if (getLogLevel() <= ERROR)
-                std::cerr << colorize(RED) << "[TEMPLATE] Error! Cannot find the \"" << token->second << "\"!" << colorize(NC) << "\n";
-              return std::nullopt;
-            }
+            tokens.emplace_back(KEYWORD, "in");
+            variablesProcessed = true;
           }
-
-        } else if (token->first == STRING)
-        {
-          rv += token->second;
-        } else if (token->first == IF_BODY)
+          else
+            tokens.emplace_back(VARIABLE, trim(tmp));
+        } else if (!addIterator(trim(tmp), tokens, true))
         {
-          break;
-        } else {
-          if (getLogLevel() <= ERROR)
-            std::cerr << colorize(RED) << "[TEMPLATE] Unexpected token " << typeToString(token->first) << " in the IF statement!" << colorize(NC) << "\n";
-          return std::nullopt;
+          return false;
         }
-
-        token++;
-      }
-    }
-
-    //if (token != input.end())
-    {
-      if (token->first != IF_BODY)
+      } else if (isdigit(last))
       {
-        if (getLogLevel() <= ERROR)
-          std::cerr << colorize(RED) << "[TEMPLATE] Error! Cannot find the IF_BODY token!" << colorize(NC) << "\n";
-        return std::nullopt;
-      }
-
-      true_body = trim(token->second);
-      token++;
-
-      if (token != input.end())
+        tokens.emplace_back(MATH, trim(tmp));
+      } else if (last == '.') // format like 3. = 3.0
       {
-        if (token->first != ELSE_BODY)
-        {
-          else_body = "";
-        } else {
-          else_body = trim(token->second);
-        }
-      }
-
-    }/* else {
-        std::cerr << colorize(RED) << "[TEMPLATE] Error! There is no data after IF conditons!" << colorize(NC) << "\n";
-        return std::nullopt;
-      }*/
-
-    long long l_res = 0;
-    long long r_res = 0;
-    bool useStrings = false;
-
-    {
-      //left math
+        tokens.emplace_back(MATH, trim(tmp) + "0");
+      } else if (isOperator(last))
       {
-        bool is_ok = true;
-        double r = calculate(lv, &is_ok);
-        if (is_ok)
-        {
-          std::stringstream ss;
-          ss << r;
-          lv = ss.str();
-        }
-      }
-
-      //right math
+        tokens.emplace_back(OPERATOR, trim(tmp));
+      } else if (isComparative(last))
       {
-        bool is_ok = true;
-        double r = calculate(rv, &is_ok);
-        if (is_ok)
-        {
-          std::stringstream ss;
-          ss << r;
-          rv = ss.str();
-        }
+        tokens.emplace_back(COMPARISON_OPERATOR, trim(tmp));
       }
+      break;
     }
 
-    try {
-      l_res = std::stoi(lv);
-    } catch (std::invalid_argument& e) {
-      useStrings = true;
-    }
-
-    if (!useStrings) //not needed
-    {
-      try {
-        r_res = std::stoi(rv);
-      } catch (std::invalid_argument& e) {
-        useStrings = true;
-      }
-    }
-
-    bool result;
-
-    if (useStrings)
+    if (!variablesProcessed)
     {
-      if (op == ">") {
-        result = lv.size() > rv.size();
-      } else if (op == "<")
+      if (tmp == "")
       {
-        result = lv.size() < rv.size();
-      } else if (op == "==")
+        tmp += cond[j];
+      } else if (cond[j] == ',')
       {
-        result = lv == rv;
-      } else if (op == "!=")
+        //Must be empty to not include commas in variable names
+      } else if ( (isalpha(*tmp.rbegin()) || *tmp.rbegin() == '_') && !(isalpha(cond[j]) || isdigit(cond[j]) || cond[j] == '_'))
       {
-        result = lv != rv;
-      } else if (op.empty())
+        if (trim(tmp) == "in")
+        {
+          tokens.emplace_back(KEYWORD, "in");
+          variablesProcessed = true;
+        } else
+          tokens.emplace_back(VARIABLE, trim(tmp));
+        tmp = cond[j];
+      } else if ( (isdigit(*tmp.rbegin()) || *tmp.rbegin() == '.' || *tmp.rbegin() == '-') && !(isdigit(cond[j]) || cond[j] == '.' || cond[j] == '-'))
+      {
+        tokens.emplace_back(MATH, trim(tmp));
+        tmp = cond[j];
+      } else if (isOperator(*tmp.rbegin()) && !isOperator(cond[j]))
       {
-        result = !lv.empty();
+        tokens.emplace_back(OPERATOR, trim(tmp));
+        tmp = cond[j];
+      } else if (isComparative(*tmp.rbegin()) && !isComparative(cond[j]))
+      {
+        tokens.emplace_back(COMPARISON_OPERATOR, trim(tmp));
+        tmp = cond[j];
       } else {
-        if (getLogLevel() <= ERROR)
-          std::cerr << colorize(RED) << "[TEMPLATE] Something went wrong! Unknown operator in IF statemnt: " << op << colorize(NC) << "\n";
-        return std::nullopt;
+        tmp += cond[j];
       }
     } else {
-      if (op == ">")
-      {
-        result = l_res > r_res;
-      } else if (op == "<")
-      {
-        result = l_res < r_res;
-      } else if (op == "==")
-      {
-        result = l_res == r_res;
-      } else if (op == "!=")
+      //parse iterator
+      if (tmp == "")
       {
-        result = l_res != r_res;
-      } else if (op.empty())
+        tmp += cond[j];
+      } else if ( ((isalpha(*tmp.rbegin()) || *tmp.rbegin() == '_' || *tmp.rbegin() == ')' || *tmp.rbegin() == '(') &&
+        !(isalpha(cond[j]) || cond[j] == '_' || cond[j] == ')' || cond[j] == '(' || cond[j] == ' ' || cond[j] == ',' || cond[j] == '.')))
       {
-        result = l_res;
+        if (!addIterator(trim(tmp), tokens, false))
+          return false;
       } else {
-        if (getLogLevel() <= ERROR)
-          std::cerr << colorize(RED) << "[TEMPLATE] Something went wrong! Unknown operator in IF statement: " << op << colorize(NC) << "\n";
-        return std::nullopt;
+        tmp += cond[j];
       }
     }
+  }
+  return true;
+}
 
-    if (result)
-    {
-      return true_body; //true
-    } else {
-      return else_body.empty() ? "" : else_body; //false
+//splits the inside of "{{ }}" into tokens
+static void tokenizeExpression(const std::string& code, Tokens& tokens)
+{
+  std::string tmp = "";
+  for (const char c: code)
+  {
+    if (c == ' ')
+      continue;
+
+    char first = tmp.empty() ? '\0' : *tmp.begin();
+    if (tmp == "")
+    {
+      tmp += c;
+    } else if (c == '|' && first == '|') //flag
+    {
+      tokens.emplace_back(FLAG, tmp.substr(1));
+      tmp = c;
+    } else if (isOperator(first) && !isOperator(c))
+    {
+      tokens.emplace_back(OPERATOR, trim(tmp));
+      tmp = c;
+    } else if ( (isdigit(first) || first == '.') && !(isdigit(c) || c == '.'))
+    {
+      tokens.emplace_back(MATH, trim(tmp));
+      tmp = c;
+    } else if ( (isalpha(first) || first == '_') && !(isalpha(c) || isdigit(c) || c == '_'))
+    {
+      tokens.emplace_back(VARIABLE, tmp);
+      tmp = c;
+    } else {
+      tmp += c;
     }
+  }
 
-  } else if (input.begin()->first == ELSE)
+  tmp = trim(tmp);
+  if (tmp.empty())
+    return;
+  char first = *tmp.begin();
+  if (first == '.' && tmp.size() > 1 && isdigit(tmp[1]))
   {
-    if (getLogLevel() <= ERROR)
-      std::cerr << colorize(RED) << "[TEMPLATE] Error! Unrecognized token ELSE before IF!" << colorize(NC) << "\n";
-    return std::nullopt;
-  } else if (input.begin()->first == ENDIF)
+    //.0 -> 0.0
+    tokens.emplace_back(MATH, "0" + tmp);
+  } else if (first == '|')
   {
-    if (getLogLevel() <= ERROR)
-      std::cerr << colorize(RED) << "[TEMPLATE] Error! Unrecognized token ENDIF before IF!" << colorize(NC) << "\n";
-    return std::nullopt;
-  } else if (input.begin()->first == FOR)
+    tokens.emplace_back(FLAG, tmp.substr(1));
+  } else if (isalpha(first) || first == '_')
+  {
+    tokens.emplace_back(VARIABLE, tmp);
+  } else if (isdigit(first))
   {
-    //FOR
+    tokens.emplace_back(MATH, tmp);
+  } else if (isOperator(first))
+  {
+    tokens.emplace_back(OPERATOR, tmp);
+  }
+}
 
-    auto token = input.begin()+1;
+//---COMPILER---
 
-    if (token->first != VARIABLE)
-    {
-      if (getLogLevel() <= ERROR)
-        std::cerr << colorize(RED) << "[TEMPLATE] Error! For loop must start with variable declaration!" << colorize(NC) << "\n";
-      return std::nullopt;
-    }
+//part of a compiled template
+struct TemplateNode
+{
+  enum Type
+  {
+    TEXT,
+    EXPRESSION, // {{ }}
+    CONDITION, // {% if %}
+    LOOP // {% for %}
+  };
+
+  enum LoopType
+  {
+    ARRAY, // for x in array
+    ENUMERATE, // for i, x in enumerate(array)
+    FLASHES // for category, message in get_flashed_messages()
+  };
+
+  Type type;
+  std::string text; //TEXT
+  Tokens tokens; //EXPRESSION and CONDITION
+  std::vector<TemplateNode> body; //CONDITION (true branch) and LOOP
+  std::vector<TemplateNode> elseBody; //CONDITION
+  LoopType loop = ARRAY;
+  std::vector<std::string> variables; //LOOP
+  std::vector<std::string> iterable; //LOOP, path of the array
+  size_t file = 0; //index in CompiledTemplate::files, for errors
+  size_t line = 0;
+};
+
+//template parsed once. Rendering walks 'nodes' without scanning the text
+struct CompiledTemplate
+{
+  std::string source;
+  std::vector<std::string> files; //files of the nodes (the template and files of "loadblock")
+  std::vector<TemplateNode> nodes;
+  bool failed = false; //compile error, rendering gives HTTP_500
+};
+
+struct TemplateParser
+{
+  const std::string& code;
+  size_t file; //index in CompiledTemplate::files
+  CompiledTemplate& result;
+  int depth; //depth of "loadblock"
+  size_t linePos; //'line' is counted up to this position
+  size_t line;
+};
+
+//line of 'pos' in the code. Lines are counted from the previous call: tags are met in order,
+//so the code is scanned once
+static size_t lineAt(TemplateParser& p, size_t pos)
+{
+  pos = std::min(pos, p.code.size());
+  if (pos >= p.linePos)
+    p.line += std::count(p.code.begin() + p.linePos, p.code.begin() + pos, '\n');
+  else
+    p.line -= std::count(p.code.begin() + pos, p.code.begin() + p.linePos, '\n');
+  p.linePos = pos;
+  return p.line;
+}
 
-    struct Variable {
-      std::string name;
-      nlohmann::json value;
-    };
+#define MAX_LOADBLOCK_DEPTH 16
 
-    std::vector<Variable> variables;
+//false on an error
+static bool parseNodes(TemplateParser& p, size_t& pos, std::vector<TemplateNode>& nodes, std::initializer_list<std::string_view> ends, std::string& end);
+
+static bool compileError(TemplateParser& p, size_t pos, const std::string& message)
+{
+  if (getLogLevel() <= ERROR)
+  {
+    std::cerr << colorize(RED) << "[TEMPLATE] Error! " << message << colorize(NC) << "\n";
+    std::cout << colorize(RED) << "[TEMPLATE] Error in '" << p.result.files[p.file] << "' on the line " << lineAt(p, pos) << colorize(NC) << "\n";
+  }
+  return false;
+}
+
+//adds text merging it with the previous text node
+static void addText(std::vector<TemplateNode>& nodes, std::string_view text)
+{
+  if (text.empty())
+    return;
+  if (nodes.empty() || nodes.back().type != TemplateNode::TEXT)
+  {
+    nodes.emplace_back();
+    nodes.back().type = TemplateNode::TEXT;
+  }
+  nodes.back().text += text;
+}
+
+//trims whitespaces at the edges of the body like the source of the body was trimmed
+static void trimNodes(std::vector<TemplateNode>& nodes)
+{
+  static const char* ws = " \t\n\r";
+  if (!nodes.empty() && nodes.front().type == TemplateNode::TEXT)
+  {
+    std::string& text = nodes.front().text;
+    text.erase(0, text.find_first_not_of(ws));
+    if (text.empty())
+      nodes.erase(nodes.begin());
+  }
+  if (!nodes.empty() && nodes.back().type == TemplateNode::TEXT)
+  {
+    std::string& text = nodes.back().text;
+    const size_t last = text.find_last_not_of(ws);
+    text.resize(last == std::string::npos ? 0 : last + 1);
+    if (text.empty())
+      nodes.pop_back();
+  }
+}
+
+//reads variables and the iterator of "for" from its tokens
+static bool parseLoop(const Tokens& tokens, TemplateNode& node, std::string& error)
+{
+  size_t t = 0;
+  while (t < tokens.size() && tokens[t].first == VARIABLE)
+    node.variables.push_back(tokens[t++].second);
+
+  if (node.variables.empty())
+  {
+    error = "For loop must start with variable declaration!";
+    return false;
+  }
+
+  if (t == tokens.size() || (tokens[t].first != KEYWORD && tokens[t].second != "in"))
+  {
+    error = "\"in\" keyword must separate variables and iterator!";
+    return false;
+  }
+  ++t;
+
+  if (t == tokens.size() || (tokens[t].first != ITERATOR && tokens[t].first != VARIABLE))
+  {
+    error = "An iterator or a variable must be present after \"in\" keyword!";
+    return false;
+  }
+
+  const auto& iterator = tokens[t++];
+  if (iterator.second == "enumerate")
+  {
+    if (iterator.first == VARIABLE && getLogLevel() <= WARNING)
+      std::cout << colorize(YELLOW) << "[TEMPLATE] Warning! Do not use 'enumerate' as a variable name, it is an iterator function name!" << colorize(NC) << "\n";
 
-    while (token->first == VARIABLE)
+    if (node.variables.size() != 2)
     {
-      variables.push_back({token->second, std::string("")});
-      token++;
+      error = "\"enumerate\" has 2 return values! " + std::to_string(node.variables.size()) + " provided!";
+      return false;
     }
-
-    if (token->first != KEYWORD && token->second != "in")
+    if (t == tokens.size() || tokens[t].first != ARGUMENT)
     {
-      if (getLogLevel() <= ERROR)
-        std::cerr << colorize(RED) << "[TEMPLATE] Error! \"in\" keyword must separate variables and iterator!" << colorize(NC) << "\n";
-      return std::nullopt;
+      error = "\"enumerate\" takes 1 positional argument! Less than 1 provided!";
+      return false;
     }
-    token++;
-
-    if (token->first != ITERATOR && token->first != VARIABLE)
+    node.loop = TemplateNode::ENUMERATE;
+    node.iterable = split(tokens[t++].second, ".");
+    if (t != tokens.size() && tokens[t].first == ARGUMENT)
     {
-      if (getLogLevel() <= ERROR)
-        std::cerr << colorize(RED) << "[TEMPLATE] Error! An iterator or a variable must be present after \"in\" keyword!" << colorize(NC) << "\n";
-      return std::nullopt;
+      error = "\"enumerate\" takes only 1 positional argument! More than 1 provided!";
+      return false;
     }
-
-    //handle iterator functions
-    if (token->second == "enumerate")
+  } else if (iterator.second == "get_flashed_messages")
+  {
+    if (node.variables.size() != 1 && node.variables.size() != 2)
     {
-      if (token->first == VARIABLE)
-      {
-        if (getLogLevel() <= WARNING)
-          std::cout << colorize(YELLOW) << "[TEMPLATE] Warning! Do not use 'enumerate' as a variable name, it is an iterator function name!"
-            << colorize(NC) << "\n";
-      }
+      error = "get_flashed_messages uses exactly 1 or 2 variables! " + std::to_string(node.variables.size()) + " provided!";
+      return false;
+    }
+    if (t != tokens.size() && tokens[t].first == ARGUMENT)
+    {
+      error = "get_flashed_messages does not require any arguments!";
+      return false;
+    }
+    node.loop = TemplateNode::FLASHES;
+  } else {
+    if (node.variables.size() > 1)
+    {
+      error = "Array iteration uses exactly 1 argument! More than 1 provided!";
+      return false;
+    }
+    node.loop = TemplateNode::ARRAY;
+    node.iterable = split(iterator.second, ".");
+  }
 
-      if (variables.size() != 2)
-      {
-        if (getLogLevel() <= ERROR)
-          std::cerr << colorize(RED) << "[TEMPLATE] Error! \"enumerate\" has 2 return values! " << variables.size() << " provided!"
-            << colorize(NC) << "\n";
-        return std::nullopt;
-      }
+  if (t != tokens.size())
+  {
+    error = "Unexpected token " + typeToString(tokens[t].first) + " in the FOR statement!";
+    return false;
+  }
+  return true;
+}
 
-      token++;
-      if (token->first != ARGUMENT)
+//adds the content of "{% raw %}" (until the matching "{% endraw %}") as text
+static bool parseRaw(TemplateParser& p, size_t& pos, std::vector<TemplateNode>& nodes)
+{
+  const size_t start = pos;
+  size_t search = pos;
+  int cnt = 0;
+  while (true)
+  {
+    const size_t tag = p.code.find("{%", search);
+    const size_t tagEnd = tag == std::string::npos ? tag : p.code.find("%}", tag);
+    if (tagEnd == std::string::npos)
+      return compileError(p, start - 1, "Cannot find {% endraw %}!");
+
+    const std::string found = trim(p.code.substr(tag+2, tagEnd-tag-2));
+    search = tag + 1;
+    if (found == "raw")
+    {
+      cnt++;
+    } else if (found == "endraw")
+    {
+      if (cnt == 0)
       {
-        if (getLogLevel() <= ERROR)
-          std::cerr << colorize(RED) << "[TEMPLATE] Error! \"enumerate\" takes 1 positional argument! Less than 1 provided!"
-            << colorize(NC) << "\n";
-        return std::nullopt;
+        addText(nodes, std::string_view(p.code).substr(start, tag-start));
+        pos = tagEnd + 2;
+        return true;
       }
+      cnt--;
+    }
+  }
+}
 
-      std::string argName = std::move(token->second);
+//inlines the block 'name' of the file: {% loadblock("file.html", name) %}
+static bool parseLoadBlock(TemplateParser& p, size_t tag, const std::string& op, std::vector<TemplateNode>& nodes)
+{
+  std::size_t bracketStart = op.find_first_of("(");
+  std::size_t bracketEnd = bracketStart == std::string::npos ? bracketStart : op.find_first_of(")", bracketStart+1);
+  if (bracketEnd == std::string::npos)
+    return compileError(p, tag, "Invalid \"loadblock\" syntax!");
+
+  const std::string args = op.substr(bracketStart+1, bracketEnd-bracketStart-1);
+  const std::size_t nameStart = args.find_first_of("\"");
+  const std::size_t nameEnd = nameStart == std::string::npos ? nameStart : args.find_first_of("\"", nameStart+1);
+  const std::size_t comma = nameEnd == std::string::npos ? nameEnd : args.find_first_of(",", nameEnd+1);
+  if (comma == std::string::npos)
+    return compileError(p, tag, "Invalid \"loadblock\" syntax!");
+
+  const std::string filename = args.substr(nameStart+1, nameEnd-nameStart-1);
+  const std::string name = trim(args.substr(comma+1));
+  if (p.depth >= MAX_LOADBLOCK_DEPTH)
+    return compileError(p, tag, "\"loadblock\" is nested too deep!");
+
+  const std::string file = getFileString(filename);
+  std::size_t blockStart, blockStartEnd;
+  std::size_t search = 0;
+  while (true)
+  {
+    blockStart = file.find("{%", search);
+    blockStartEnd = blockStart == std::string::npos ? blockStart : file.find("%}", blockStart+2);
+    if (blockStartEnd == std::string::npos)
+      return compileError(p, tag, "Cannot find the \"" + name + "\" in the file \"" + filename + "\"!");
+    search = blockStartEnd + 2;
+
+    const std::string fnd = trim(file.substr(blockStart+2, blockStartEnd-blockStart-2));
+    if (fnd.substr(0, 5) == "block" && fnd.size() > 5 && trim(fnd.substr(6)) == name)
+      break;
+  }
 
-      token++;
-      if (token->first == ARGUMENT)
-      {
-        if (getLogLevel() <= ERROR)
-          std::cerr << colorize(RED) << "[TEMPLATE] Error! \"enumerate\" takes only 1 positional argument! More than 1 provided!"
-            << colorize(NC) << "\n";
-        return std::nullopt;
-      }
+  std::size_t blockEnd;
+  int cnt = 0;
+  while (true)
+  {
+    blockEnd = file.find("{%", search);
+    const std::size_t blockEndEnd = blockEnd == std::string::npos ? blockEnd : file.find("%}", blockEnd);
+    if (blockEndEnd == std::string::npos)
+      return compileError(p, tag, "Cannot find \"endblock\" of the block \"" + name + "\"!");
+    search = blockEndEnd + 2;
+
+    const std::string fnd = trim(file.substr(blockEnd+2, blockEndEnd-blockEnd-2));
+    if (fnd == "endblock")
+    {
+      if (cnt == 0)
+        break;
+      cnt--;
+    } else if (fnd.substr(0, 5) == "block") {
+      cnt++;
+    }
+  }
 
-      if (token->first != FOR_BODY)
-      {
-        if (getLogLevel() <= ERROR)
-          std::cerr << colorize(RED) << "[TEMPLATE] Error! Cannot find the FOR_BODY token!" << colorize(NC) << "\n";
-        return std::nullopt;
-      }
+  const std::string block = trim(file.substr(blockStartEnd+2, blockEnd-blockStartEnd-2));
+  p.result.files.push_back(filename);
+  TemplateParser inner{block, p.result.files.size() - 1, p.result, p.depth + 1, 0, 1};
+  size_t pos = 0;
+  std::string end;
+  return parseNodes(inner, pos, nodes, {}, end);
+}
 
-      std::string temp = token->second; //template body
+static bool parseNodes(TemplateParser& p, size_t& pos, std::vector<TemplateNode>& nodes, std::initializer_list<std::string_view> ends, std::string& end)
+{
+  const std::string& code = p.code;
+  end.clear();
+  while (pos < code.size())
+  {
+    //next "{{" or "{%"
+    size_t tag = code.find('{', pos);
+    while (tag != std::string::npos && tag+1 < code.size() && code[tag+1] != '{' && code[tag+1] != '%')
+      tag = code.find('{', tag+1);
+    if (tag == std::string::npos || tag+1 >= code.size())
+      break;
 
-      nlohmann::json val;
+    addText(nodes, std::string_view(code).substr(pos, tag-pos));
 
-      bool found = false;
-      if (argName.find_first_of(".") != std::string::npos)
+    if (code[tag+1] == '{')
+    {
+      const size_t close = code.find("}}", tag+2);
+      if (close == std::string::npos) // not closed, kept as text
       {
-        auto sp = split(argName, ".");
-        auto r = getJson(json, sp);
-        if (!r)
-        {
-          found = false;
-        } else {
-          val = *r;
-          found = true;
-        }
-      } else {
-        auto ptr = json.find(argName);
-        found = ptr != json.end();
-        val = *ptr;
+        pos = tag;
+        break;
       }
 
-      if (found)
-      {
-        if (!val.is_array())
-        {
-          if (getLogLevel() <= ERROR)
-            std::cerr << colorize(RED) << "[TEMPLATE] Error! Iteration using \"enumerate\" supports only json arrays!" << colorize(NC) << "\n";
-          return std::nullopt;
-        }
-
-        int iter=0;
-        for (auto it = val.begin(); it != val.end(); ++it)
-        {
-          //iteration
-
-          //process
-          std::string tmp = temp;
-          {
-            variables[0].value = std::to_string(iter);
-            variables[1].value = *it;
-          }
+      TemplateNode node;
+      node.type = TemplateNode::EXPRESSION;
+      node.file = p.file;
+      node.line = lineAt(p, tag);
+      tokenizeExpression(code.substr(tag+2, close-tag-2), node.tokens);
+      nodes.push_back(std::move(node));
+      pos = close + 2;
+      continue;
+    }
 
-          nlohmann::json innerJson = json;
-          innerJson[variables[0].name] = variables[0].value;
-          innerJson[variables[1].name] = variables[1].value;
+    //statement
+    const size_t close = code.find("%}", tag+2);
+    if (close == std::string::npos)
+      return compileError(p, tag, "Cannot find the end of the statement!");
 
-          if (!lexer_analyze(templ, tmp, innerJson))
-          {
-            return std::nullopt;
-          }
+    const std::string op = trim(code.substr(tag+2, close-tag-2));
+    const size_t space = op.find(' ');
+    const std::string word = op.substr(0, space);
+    const std::string cond = space == std::string::npos ? "" : trim(op.substr(space+1));
+    pos = close + 2;
 
-          //result
-          result += trim(tmp);
+    if (std::find(ends.begin(), ends.end(), word) != ends.end())
+    {
+      end = word;
+      return true;
+    }
 
-          //after result
-          ++iter;
-        }
+    if (op == "raw")
+    {
+      if (!parseRaw(p, pos, nodes))
+        return false;
+    } else if (word == "if" && space != std::string::npos)
+    {
+      TemplateNode node;
+      node.type = TemplateNode::CONDITION;
+      node.file = p.file;
+      node.line = lineAt(p, tag);
+      if (!tokenizeCondition(cond, node.tokens))
+        return compileError(p, tag, "Failed to parse string! Cannot find string end!");
+
+      std::string found;
+      if (!parseNodes(p, pos, node.body, {"else", "endif"}, found))
+        return false;
+      if (found == "else" && !parseNodes(p, pos, node.elseBody, {"endif"}, found))
+        return false;
+      if (found != "endif")
+        return compileError(p, tag, "Cannot find ENDIF!");
+
+      trimNodes(node.body);
+      trimNodes(node.elseBody);
+      nodes.push_back(std::move(node));
+    } else if (word == "for" && space != std::string::npos)
+    {
+      TemplateNode node;
+      node.type = TemplateNode::LOOP;
+      node.file = p.file;
+      node.line = lineAt(p, tag);
+      Tokens tokens;
+      if (!tokenizeFor(cond, tokens))
+        return compileError(p, tag, "Argument list must be started with '('!");
+      std::string error;
+      if (!parseLoop(tokens, node, error))
+        return compileError(p, tag, error);
+
+      std::string found;
+      if (!parseNodes(p, pos, node.body, {"endfor"}, found))
+        return false;
+      if (found != "endfor")
+        return compileError(p, tag, "Cannot find ENDFOR!");
+
+      trimNodes(node.body);
+      nodes.push_back(std::move(node));
+    } else if ((word == "block" && space != std::string::npos) || op == "endblock")
+    {
+      //blocks only mark parts for "loadblock"
+    } else if (op.substr(0, 9) == "loadblock")
+    {
+      if (!parseLoadBlock(p, tag, op, nodes))
+        return false;
+    } else {
+      return compileError(p, tag, "Unrecognized token \"" + op + "\"!");
+    }
+  }
 
-      } else {
-        if (getLogLevel() <= ERROR)
-          std::cerr << colorize(RED) << "[TEMPLATE] Error! Cannot find the json array \"" << argName << "\"!" << colorize(NC) << "\n";
-        return std::nullopt;
-      }
+  addText(nodes, std::string_view(code).substr(std::min(pos, code.size())));
+  pos = code.size();
+  return true;
+}
 
-    } else if (token->second == "get_flashed_messages") 
-    {
-      if (variables.size() != 1 && variables.size() != 2)
-      {
-        if (getLogLevel() <= ERROR)
-          std::cerr << colorize(RED) << "[TEMPLATE] Error! get_flashed_messages uses exactly 1 or 2 variables! " << variables.size() << " provided!" 
-            << colorize(NC) << "\n";
-        return std::nullopt;
-      }
+//errors are logged here. A template which fails to compile is kept with 'failed' set
+static std::shared_ptr<const CompiledTemplate> compileTemplate(std::string source, const std::string& fileName)
+{
+  auto compiled = std::make_shared<CompiledTemplate>();
+  compiled->source = std::move(source);
+  compiled->files.push_back(fileName);
+  TemplateParser parser{compiled->source, 0, *compiled, 0, 0, 1};
+  size_t pos = 0;
+  std::string end;
+  if (!parseNodes(parser, pos, compiled->nodes, {}, end))
+  {
+    compiled->nodes.clear();
+    compiled->failed = true;
+  }
+  return compiled;
+}
 
-      token++;
-      if (token->first == ARGUMENT)
-      {
-        if (getLogLevel() <= ERROR)
-          std::cerr << colorize(RED) << "[TEMPLATE] Error! get_flashed_messages does not require any arguments!" << colorize(NC) << "\n";
-        return std::nullopt;
-      }
+//compiled template files by their path in the resource directory. Cleared when any file in the
+//directory changes (a template may inline other files with "loadblock")
+static std::mutex templatesMutex;
+static std::unordered_map<std::string, std::shared_ptr<const CompiledTemplate>> compiledTemplates;
+static uint64_t templatesGeneration = 0; // incremented by clearTemplateCache
 
-      if (token->first != FOR_BODY)
-      {
-        if (getLogLevel() <= ERROR)
-          std::cerr << colorize(RED) << "[TEMPLATE] Error! Cannot find FOR_BODY token!" << colorize(NC) << "\n";
-        return std::nullopt;
-      }
+void clearTemplateCache()
+{
+  std::lock_guard<std::mutex> lock(templatesMutex);
+  compiledTemplates.clear();
+  templatesGeneration++;
+}
 
-      auto msg = templ->getFlashedMessages();
-      while (!msg->empty())
-      {
-        std::string tmp = token->second;
-        if (variables.size() == 1)
-        {
-          variables[0].value = msg->top().first;
-        } else {
-          variables[0].value = msg->top().second;
-          variables[1].value = msg->top().first;
-        }
+bool HTMLTemplate::loadFile(const std::string& path, const bool cached)
+{
+  m_templateFileName = path;
+  m_html.clear();
+  m_compiled = nullptr;
 
-        nlohmann::json innerJson = json;
-        for (auto it: variables)
-        {
-          innerJson[it.name] = it.value;
-        }
+  uint64_t generation = 0;
+  if (cached)
+  {
+    std::lock_guard<std::mutex> lock(templatesMutex);
+    auto it = compiledTemplates.find(path);
+    if (it != compiledTemplates.end())
+    {
+      m_compiled = it->second;
+      return true;
+    }
+    generation = templatesGeneration;
+  }
 
-        if (!lexer_analyze(templ, tmp, innerJson))
-        {
-          return std::nullopt;
-        }
+  //read and compile without the lock, other templates are loaded meanwhile
+  std::string file = getFileString(path);
+  if (file.empty())
+    return false;
+  m_compiled = compileTemplate(std::move(file), path);
 
-        //result
-        result += trim(tmp);
+  if (cached)
+  {
+    //the file may be changed while it was compiled -> it is not kept after clearTemplateCache
+    std::lock_guard<std::mutex> lock(templatesMutex);
+    if (generation == templatesGeneration)
+      compiledTemplates.emplace(path, m_compiled);
+  }
+  return true;
+}
 
-        msg->pop();
-      }
+//---RENDERER---
 
-    } else {
-      if (variables.size() > 1)
-      {
-        if (getLogLevel() <= ERROR)
-          std::cerr << colorize(RED) << "[TEMPLATE] Error! Array iteration uses exactly 1 argument! More than 1 provided!" << colorize(NC) << "\n";
-        return std::nullopt;
-      }
+//reads the value of the variable at 'tokens[t]' ("name" or "name.attr.attr") and moves 't' after it.
+//'path' gets the names. Returns nullptr if the variable is not found
+static const nlohmann::json* resolveVariable(const Tokens& tokens, size_t& t, const Scope& scope, std::vector<std::string>& path)
+{
+  path = {tokens[t++].second};
+  while (t < tokens.size() && tokens[t].first == MATH && tokens[t].second == ".")
+  {
+    ++t;
+    if (t == tokens.size() || (tokens[t].first != MATH && tokens[t].first != VARIABLE))
+      break;
+    if (tokens[t].first == VARIABLE)
+      path.push_back(tokens[t].second);
+    ++t;
+  }
+  return getJson(scope, path);
+}
 
-      nlohmann::json val;
-      bool found = false;
-      if (token->second.find_first_of(".") != std::string::npos)
+//returns the value of the "if" condition. std::nullopt on an error
+static std::optional<bool> evalCondition(const Tokens& tokens, const Scope& scope)
+{
+  std::vector<std::string> path;
+  if (std::find_if(tokens.begin(), tokens.end(), [](const std::pair<TOKEN_TYPE, std::string>& in){return in.first == COMPARISON_OPERATOR;}) == tokens.end())
+  {
+    //check if the value is set
+    const nlohmann::json* val = nullptr;
+    nlohmann::json literal;
+    size_t t = 0;
+    while (t < tokens.size())
+    {
+      if (tokens[t].first == VARIABLE)
       {
-        auto sp = split(token->second, ".");
-        auto r = getJson(json, sp);
-        if (!r)
-        {
-          found = false;
-        } else {
-          val = *r; 
-          found = true;
-        }
-      } else {
-        auto ptr = json.find(token->second);
-        found = ptr != json.end();
-        if (found)
-          val = *ptr;
-      }
-
-      if (found)
+        val = resolveVariable(tokens, t, scope, path);
+        if (!val)
+          return false;
+        break;
+      } else if (tokens[t].first == MATH)
       {
-
-        if (!val.is_array())
-        {
-          if (getLogLevel() <= ERROR)
-            std::cerr << colorize(RED) << "[TEMPLATE] Error! Iteration supports only json arrays! Provided object is not an array!" << colorize(NC) << "\n";
-          return std::nullopt;
-        }
-
-        ++token;
-        if (token == input.end() || token->first != FOR_BODY)
+        try {
+          literal = std::stoi(tokens[t].second);
+        } catch (std::exception& e)
         {
           if (getLogLevel() <= ERROR)
-            std::cerr << colorize(RED) << "[TEMPLATE] Cannot find the FOR_BODY token!" << colorize(NC) << "\n";
+            std::cerr << colorize(RED) << "[TEMPLATE] Error! Invalid number \"" << tokens[t].second << "\" in the IF statement!" << colorize(NC) << "\n";
           return std::nullopt;
         }
-
-        const std::string temp = std::move(token->second);
-        const std::string varName = variables[0].name;
-
-        for (auto it: val)
-        {
-          std::string tmp = temp;
-
-          nlohmann::json innerJson = json;
-          innerJson[varName] = it;
-
-          if (!lexer_analyze(templ, tmp, innerJson))
-          {
-            return std::nullopt;
-          }
-
-          result += trim(tmp);
-        }
+        val = &literal;
+      } else if (tokens[t].first == STRING)
+      {
+        literal = tokens[t].second;
+        val = &literal;
       } else {
         if (getLogLevel() <= ERROR)
-          std::cerr << colorize(RED) << "[TEMPLATE] Cannot find the json array \"" << token->second << "\"!" << colorize(NC) << "\n";
+          std::cerr << colorize(RED) << "[TEMPLATE] Error! Unexpected token " << typeToString(tokens[t].first) << colorize(NC) << "\n";
         return std::nullopt;
       }
+      ++t;
+    }
+
+    if (t < tokens.size())
+    {
+      if (getLogLevel() <= ERROR)
+        std::cerr << colorize(RED) << "[TEMPLATE] Error! Unexpected token " << typeToString(tokens[t].first) << " in the IF statement!" << colorize(NC) << "\n";
+      return std::nullopt;
+    }
+
+    if (!val || val->is_null())
+    {
+      return false;
+    } else if (val->is_array() || val->is_object())
+    {
+      return val->size() > 0;
+    } else if (val->is_string())
+    {
+      try {
+        int id = std::stoi((std::string)*val);
+        return id != 0;
+      } catch (std::exception& e)
+      {
+        return !trim((std::string)*val).empty();
+      }
+    } else if (val->is_number())
+    {
+      return static_cast<int>(*val) != 0;
     }
 
-    return result;
-  } else if (input.begin()->first == ENDFOR)
-  {
     if (getLogLevel() <= ERROR)
-      std::cerr << colorize(RED) << "[TEMPLATE] Error! Unrecognized token ENDFOR before FOR!" << colorize(NC) << "\n";
+      std::cerr << colorize(RED) << "[TEMPLATE] Cannot check unsupported type json!" << colorize(NC) << "\n";
     return std::nullopt;
-  } else {
-    //flags
-    bool strFlag = false;
-    bool safeFlag = false;
+  }
 
-    // VARIABLE 
-    for (auto token = input.begin(); token != input.end(); ++token)
+  //comparison
+  std::string lv = "";
+  std::string op = "";
+  std::string rv = "";
+  std::string* side = &lv;
+  size_t t = 0;
+  while (t < tokens.size())
+  {
+    const auto& token = tokens[t];
+    if (token.first == MATH || token.first == OPERATOR || token.first == STRING)
     {
-      if (token->first == SUBSCRIPT){
+      *side += token.second;
+      ++t;
+    } else if (token.first == VARIABLE)
+    {
+      const nlohmann::json* val = resolveVariable(tokens, t, scope, path);
+      if (!val)
+      {
         if (getLogLevel() <= ERROR)
-          std::cerr << colorize(RED) << "[TEMPLATE] Error! Unrecognized subscript token in variable!" << colorize(NC) << "\n";
+          std::cerr << colorize(RED) << "[TEMPLATE] Error! Cannot find the \"" << joinPath(path) << "\"!" << colorize(NC) << "\n";
         return std::nullopt;
-      } else if (token->first == FLAG)
-      {
-        if (token->second == "str")
-        {
-          strFlag = true;
-        } else if (token->second == "safe")
-        {
-          safeFlag = true;
-        } else {
-          if (getLogLevel() <= ERROR)
-            std::cerr << colorize(YELLOW) << "[TEMPLATE] Warning! Ignoring unknown flag \"" << token->second << "\"!" << colorize(NC) << "\n";
-        }
-      } else if (token->first == VARIABLE)
-      {
-        if ((++token) != input.end() && token->first == MATH && token->second == ".")
-        {
-          token--;
-          std::string lastName = token->second;
-          std::string expr = token->second;
-          bool fnd = true;
-
-          std::vector<std::string> attributes = {token->second};
-          while (token != input.end())
-          {
-            token++;
-            if (token->first == MATH && token->second == ".")
-            {
-              token++;
-
-              if (token->first != VARIABLE)
-              {
-                break;
-              }
-
-              attributes.emplace_back(token->second);
-            } else if (token->first == FLAG)
-            {
-              if (token->second == "str")
-              {
-                strFlag = true;
-              } else if (token->second == "safe")
-              {
-                safeFlag = true;
-              } else {
-                if (getLogLevel() <= WARNING)
-                  std::cerr << colorize(YELLOW) << "[TEMPLATE] Warning! Ignoring unknown flag \"" << token->second << "\"!" << colorize(NC) << "\n";
-              }
-            } else {
-              break;
-            }
-          }
+      }
+      *side += stringifyJson(*val);
+    } else if (token.first == COMPARISON_OPERATOR && side == &lv)
+    {
+      op = token.second;
+      side = &rv;
+      ++t;
+    } else {
+      if (getLogLevel() <= ERROR)
+        std::cerr << colorize(RED) << "[TEMPLATE] Unexpected token " << typeToString(token.first) << " in the IF statement!" << colorize(NC) << "\n";
+      return std::nullopt;
+    }
+  }
 
-          auto val = getJson(json, attributes);
-          if (!val)
-          {
-            if (getLogLevel() <= ERROR)
-              std::cout << colorize(RED) << "[TEMPLATE] Failed to process attributes: " << colorize(NC) << attributes[0];
-            for (auto it = attributes.begin()+1; it!= attributes.end();++it)
-            {
-              std::cout << "." << *it;
-            }std::cout << colorize(NC) << "\n";
-            return std::nullopt;
-          }
+  long long l_res = 0;
+  long long r_res = 0;
+  bool useStrings = false;
 
-          token--;
-          expression += stringifyJson(val);
-        } else {
-          token--;
-          try {
-            expression += stringifyJson(json.at(token->second));
-          } catch (const nlohmann::detail::out_of_range& e)
-          {
-            if (getLogLevel() <= ERROR)
-              std::cerr << colorize(RED) << "[TEMPLATE] Error! Cannot find the \"" << token->second << "\"!" << colorize(NC) << "\n";
-            return std::nullopt;
-          }
-        }
-      } else if (token->first == VARIABLE)
-      {
-        auto ptr = json.find(token->second);
-        if (ptr != json.end())
-        {
-          expression += stringifyJson(*ptr);
-        } else {
-          if (getLogLevel() <= ERROR)
-            std::cerr << colorize(RED) << "[TEMPLATE] Cannot find the \"" << token->second << "\"!" << colorize(NC) << "\n";
-          return std::nullopt;
-        }
-      }
-      else if (token->first == MATH)
-      {
-        expression += token->second;
-      }
-      else if (token->first == OPERATOR)
+  {
+    //left math
+    {
+      bool is_ok = true;
+      double r = calculate(lv, &is_ok);
+      if (is_ok)
       {
-        expression += token->second;
+        std::stringstream ss;
+        ss << r;
+        lv = ss.str();
       }
     }
 
-    bool is_ok = true;
-    double r = calculate(expression, &is_ok);
-    if (!is_ok || expression.empty() || strFlag)
+    //right math
     {
-      if (safeFlag)
+      bool is_ok = true;
+      double r = calculate(rv, &is_ok);
+      if (is_ok)
       {
-        //safe from html tags
-        expression = replace(expression, "<", "&lt;"); //possible place for optimization
-        expression = replace(expression, ">", "&gt;");
+        std::stringstream ss;
+        ss << r;
+        rv = ss.str();
       }
-
-      return expression;
     }
+  }
 
-    std::stringstream ss;
-    ss << r;
-    result = ss.str();
-    if (safeFlag)
+  try {
+    l_res = std::stoi(lv);
+    r_res = std::stoi(rv);
+  } catch (std::exception& e) {
+    useStrings = true;
+  }
+
+  if (useStrings)
+  {
+    if (op == ">") {
+      return lv.size() > rv.size();
+    } else if (op == "<")
     {
-      //possible place for optimization
-      result = replace(result, "<", "&lt;");
-      result = replace(result, ">", "&gt;");
+      return lv.size() < rv.size();
+    } else if (op == "==")
+    {
+      return lv == rv;
+    } else if (op == "!=")
+    {
+      return lv != rv;
+    }
+  } else {
+    if (op == ">")
+    {
+      return l_res > r_res;
+    } else if (op == "<")
+    {
+      return l_res < r_res;
+    } else if (op == "==")
+    {
+      return l_res == r_res;
+    } else if (op == "!=")
+    {
+      return l_res != r_res;
     }
   }
 
-  return result;
-}  
-
-static inline bool isOperator(const char c)
-{
-  return c == '*' || c == '-' || c == '+' || c == '/' || c == '%';
+  if (getLogLevel() <= ERROR)
+    std::cerr << colorize(RED) << "[TEMPLATE] Something went wrong! Unknown operator in IF statement: " << op << colorize(NC) << "\n";
+  return std::nullopt;
 }
 
-static inline bool isComparative(const char c)
-{
-  return c == '=' || c == '!' || c == '>' || c == '<';
-}
-
-//false on an error
-static bool lexer_analyze(HTMLTemplate* templ, std::string& code, const nlohmann::json& json)
+//appends the value of "{{ }}" to 'out'. False on an error
+static bool evalExpression(const Tokens& input, const Scope& scope, std::string& out)
 {
-  std::vector<std::pair<TOKEN_TYPE, std::string>> tokens;
-
-  for (int i=0;i<code.size();++i)
+  //flags
+  bool strFlag = false;
+  bool safeFlag = false;
+  auto setFlag = [&](const std::string& flag)
   {
+    if (flag == "str")
+    {
+      strFlag = true;
+    } else if (flag == "safe")
+    {
+      safeFlag = true;
+    } else {
+      if (getLogLevel() <= WARNING)
+        std::cerr << colorize(YELLOW) << "[TEMPLATE] Warning! Ignoring unknown flag \"" << flag << "\"!" << colorize(NC) << "\n";
+    }
+  };
 
-    if (i+1 < code.size() && code[i] == '{' && code[i+1] == '%') //statement
+  std::string expression = "";
+  std::vector<std::string> path;
+  size_t t = 0;
+  while (t < input.size())
+  {
+    const auto& token = input[t];
+    if (token.first == SUBSCRIPT)
+    {
+      if (getLogLevel() <= ERROR)
+        std::cerr << colorize(RED) << "[TEMPLATE] Error! Unrecognized subscript token in variable!" << colorize(NC) << "\n";
+      return false;
+    } else if (token.first == FLAG)
+    {
+      setFlag(token.second);
+      ++t;
+    } else if (token.first == VARIABLE)
     {
-      std::size_t start = i;
-      std::size_t end = code.find("%}", start);
-      std::string op = code.substr(start+2, end-start-2);
-      if (trim(op) == "raw")
+      const nlohmann::json* val = resolveVariable(input, t, scope, path);
+      if (!val)
       {
-        std::size_t pos = end+2;
-        std::size_t pos2 = pos;
-
-        int cnt = 0;
-        while (true)
-        {
-          pos = code.find("{%", pos);
-          if (pos == std::string::npos || pos >= code.size())
-          {
-            if (getLogLevel() <= ERROR)
-            {
-              std::cerr << colorize(RED) << "[TEMPLATE] Error! Cannot find {% endraw %}!" << colorize(NC) << "\n";
-              const std::string filename = templ->getFileName();
-              const std::string code = getFileString(filename);
-              int cnt = getCurrentLine(code, end);
-              std::cout << colorize(RED) << "[TEMPLATE] Error in '" << filename << "' on the line " << cnt << colorize(NC) << "\n";
-            }
-            return false;
-          }
-
-          pos2 = code.find("%}", pos);
-          if (pos2 == std::string::npos || pos >= code.size())
-          {
-            if (getLogLevel() <= ERROR)
-            {
-              std::cerr << colorize(RED) << "[TEMPLATE] Error! Cannot find {% endraw %}!" << colorize(NC) << "\n";
-              const std::string filename = templ->getFileName();
-              const std::string code = getFileString(filename);
-              int cnt = getCurrentLine(code, end);
-              std::cout << colorize(RED) << "[TEMPLATE] Error in '" << filename << "' on the line " << cnt << colorize(NC) << "\n";
-            }
-            return false;
-          }
-
-          std::string found = trim(code.substr(pos+2, pos2-pos-2));
-
-          if (found == "raw")
-          {
-            cnt++;
-            pos++;
-            continue;
-          } else if (found == "endraw")
-          { 
-            if (cnt == 0)
-            {
-              break;
-            } else {
-              cnt--;
-              pos++;
-              continue;
-            }
-          } else {
-            pos++;
-            continue;
-          }
-        } //end while
-
-        i += pos2+2 - end-2;
-        code.replace(pos, pos2-pos+2, "");
-        code.replace(start, end-start+2, "");
-      } else {
-        //NOT RAW
-
-        i += end - start;
-
-        std::string tmp; //first operator
-
-        std::string cond = "";
-        {
-          std::string trimmed = trim(op);
-          std::size_t pos = trimmed.find(" ");
-          if (pos == std::string::npos)
-          {
-            tmp = "";
-          } else {
-            tmp = trimmed.substr(0, pos);
-            cond = trim(trimmed.substr(pos+1));
-          }
-        }
-
-        //parsing statement
-        if (tmp == "if")
-        {
-          tokens.emplace_back(IF, "if");
-
-          {
-            int j = 0;
-            std::string tmp = "";
-            while (true)
-            {
-              if (j >= cond.size())
-              {
-                char last = *trim(tmp).rbegin();
-                char first = *trim(tmp).begin();
-                if (isalpha(first) || last == '_')
-                {
-                  tokens.emplace_back(VARIABLE, trim(tmp));
-                } else if (isdigit(first))
-                {
-                  tokens.emplace_back(MATH, trim(tmp));
-                } else if (last == '.') // format like 3. = 3.0
-                {
-                  tmp += "0";
-                  tokens.emplace_back(MATH, trim(tmp));
-                } else if (isOperator(last))
-                {
-                  tokens.emplace_back(OPERATOR, trim(tmp));
-                } else if (isComparative(last))
-                {
-                  tokens.emplace_back(COMPARISON_OPERATOR, trim(tmp));
-                }
-                tmp = "";
-
-                break;
-              }
-
-              if (cond[j] == '"')
-              {
-                char last = *tmp.rbegin();
-                if (isalpha(last) || last == '_')
-                {
-                  tokens.emplace_back(VARIABLE, trim(tmp));
-                } else if (isdigit(last))
-                {
-                  tokens.emplace_back(MATH, trim(tmp));
-                } else if (last == '.') // format like 3. = 3.0
-                {
-                  tmp += "0";
-                  tokens.emplace_back(MATH, trim(tmp));
-                } else if (isOperator(last))
-                {
-                  tokens.emplace_back(OPERATOR, trim(tmp));
-                } else if (isComparative(last))
-                {
-                  tokens.emplace_back(COMPARISON_OPERATOR, trim(tmp));
-                }
-                tmp = "";
-
-                std::size_t strStart = j;
-                std::size_t strEnd = cond.find('"', j+1);
-                if (strEnd == std::string::npos)
-                {
-                  if (getLogLevel() <= ERROR)
-                  {     
-                    std::cerr << colorize(RED) << "[TEMPLATE] Error! Failed to parse string! Cannot find string end!" << colorize(NC) << "\n";
-                    const std::string filename = templ->getFileName();
-                    const std::string code = getFileString(filename);
-                    int cnt = getCurrentLine(code, i);
-                    std::cout << colorize(RED) << "[TEMPLATE] Error in '" << filename << "' on the line " << cnt << colorize(NC) << "\n";
-                  }
-                  return false;
-                }
-
-                std::string str = cond.substr(strStart+1, strEnd-strStart-1);
-                tokens.emplace_back(STRING, str);
-                j = strEnd+1; //strEnd+1 - 1
-                continue;
-              }
-
-              if (tmp == "")
-              {
-                tmp += cond[j];
-              }
-              else if ( (isalpha(*tmp.rbegin()) || *tmp.rbegin() == '_') && !(isalpha(cond[j]) || isdigit(cond[j]) || cond[j] == '_'))
-              {
-                tokens.emplace_back(VARIABLE, trim(tmp));
-                tmp = cond[j];
-              } else if ( (isdigit(*tmp.rbegin()) || *tmp.rbegin() == '.' || *tmp.rbegin() == '-') && !(isdigit(cond[j]) || cond[j] == '.' || cond[j] == '-'))
-              {
-                tokens.emplace_back(MATH, trim(tmp));
-                tmp = cond[j];
-              } else if (isOperator(*tmp.rbegin()) && !isOperator(cond[j]))
-              {
-                tokens.emplace_back(OPERATOR, trim(tmp));
-                tmp = cond[j];
-              } else if (isComparative(*tmp.rbegin()) && !isComparative(cond[j]))
-              {
-                tokens.emplace_back(COMPARISON_OPERATOR, trim(tmp));
-                tmp = cond[j];
-              } else {
-                tmp += cond[j];
-              }
-
-              j++;
-            } //end while
-          }
-
-          std::size_t else_end = 0;
-          std::size_t endif_end = 0;
-          int cnt = 0;
-          while (true)
-          {
-
-            if (i+1 == code.size())
-            {
-              break; //EOF
-            }
-
-            std::size_t pos1 = code.find("{%", i);
-            if (pos1 == std::string::npos || i >= code.size())
-            {
-              if (getLogLevel() <= ERROR)
-              {
-                std::cerr << colorize(RED) << "[TEMPLATE] Error! Cannot find ENDIF!" << colorize(NC) << "\n";
-                const std::string filename = templ->getFileName();
-                const std::string code = getFileString(filename);
-                int cnt = getCurrentLine(code, i);
-                std::cout << colorize(RED) << "[TEMPLATE] Error in '" << filename << "' on the line " << cnt << colorize(NC) << "\n";
-              }
-              return false;
-            }
-
-            std::size_t pos2 = code.find("%}", pos1+2);
-            if (pos1 == std::string::npos || i >= code.size())
-            {
-              if (getLogLevel() <= ERROR)
-              {
-                std::cerr << colorize(RED) << "[TEMPLATE] Error! Cannot find ENDIF!" << colorize(NC) << "\n";
-                const std::string filename = templ->getFileName();
-                const std::string code = getFileString(filename);
-                int cnt = getCurrentLine(code, i);
-                std::cout << colorize(RED) << "[TEMPLATE] Error in '" << filename << "' on the line " << cnt << colorize(NC) << "\n";
-              }
-              return false;
-            }
-
-            i = pos2;
-
-            std::string found = code.substr(pos1+2, pos2-pos1-2);
-            std::string oper = "";
-            {
-              std::stringstream ss;
-              ss << trim(found);
-              std::getline(ss, oper, ' '); 
-              oper = trim(oper);
-            }
+        if (getLogLevel() <= ERROR)
+          std::cerr << colorize(RED) << "[TEMPLATE] Error! Cannot find the \"" << joinPath(path) << "\"!" << colorize(NC) << "\n";
+        return false;
+      }
+      expression += stringifyJson(*val);
+    } else {
+      if (token.first == MATH || token.first == OPERATOR)
+        expression += token.second;
+      ++t;
+    }
+  }
 
-            if (oper == "if")
-            {
-              cnt++;
-            } else if (oper == "endif")
-            {
-              if (cnt != 0)
-              {
-                cnt--;
-              } else {
-                if (else_end != 0)
-                {
-                  std::string body = code.substr(else_end, pos1-else_end);
-                  tokens.emplace_back(ELSE_BODY, trim(body));
-                  tokens.emplace_back(ENDIF, "endif");
-                  endif_end = pos2+2;
-                  break;
-                } else {
-                  std::string body = code.substr(end+2, pos1-end-2);
-                  tokens.emplace_back(IF_BODY, trim(body));
-                  tokens.emplace_back(ENDIF, "endif");
-                  endif_end = pos2+2;
-                  break;
-                }
-              }
-            } else if (oper == "else" && cnt == 0)
-            {
-              std::string body = code.substr(end+2, pos1-end-2);
-              else_end = pos2+2;
-              tokens.emplace_back(IF_BODY, trim(body));
-              i = else_end;
-            }
+  bool is_ok = true;
+  double r = calculate(expression, &is_ok);
+  if (is_ok && !expression.empty() && !strFlag)
+  {
+    std::stringstream ss;
+    ss << r;
+    expression = ss.str();
+  }
 
-            i++;
-          }
+  if (safeFlag)
+  {
+    //safe from html tags
+    for (const char c: expression)
+    {
+      if (c == '<')
+        out += "&lt;";
+      else if (c == '>')
+        out += "&gt;";
+      else
+        out += c;
+    }
+  } else {
+    out += expression;
+  }
+  return true;
+}
 
-          auto res = parser_eval(templ, tokens, json);
-          if (!res)
-          {
-            return false;
-          }
-          std::string result = *res;
-          tokens.clear();
-          code.replace(start, endif_end-start, result);
-          i = -1; //to the beginning
-          continue;
+static bool renderError(const CompiledTemplate& compiled, const TemplateNode& node)
+{
+  if (getLogLevel() <= ERROR)
+    std::cout << colorize(RED) << "[TEMPLATE] Error in '" << compiled.files[node.file] << "' on the line " << node.line << colorize(NC) << "\n";
+  return false;
+}
 
-        } else if (tmp == "for")
-        {
+//removes whitespaces at the edges of 'out' after 'start'
+static void trimFrom(std::string& out, size_t start)
+{
+  static const char* ws = " \t\n\r";
+  const size_t first = out.find_first_not_of(ws, start);
+  if (first == std::string::npos)
+  {
+    out.resize(start);
+    return;
+  }
+  out.resize(out.find_last_not_of(ws) + 1);
+  out.erase(start, first - start);
+}
 
-          tokens.emplace_back(FOR, "for");
+//rendered text. With 'write' set the text is passed to it in parts of 'chunkSize' bytes as it is rendered
+struct RenderOutput
+{
+  std::string data;
+  const HTMLTemplate::TemplateWriter* write = nullptr;
+  size_t chunkSize = 0;
+  int loops = 0; //open loop iterations. They are trimmed when they end, so their text is kept until then
+  bool writeFailed = false;
+};
+
+//passes the rendered text to 'out.write' if a part is ready. False if the writer fails
+static bool flushOutput(RenderOutput& out, bool last=false)
+{
+  if (!out.write || out.loops > 0 || out.data.empty() || (!last && out.data.size() < out.chunkSize))
+    return true;
 
-          //FOR
-          //parse statement
-          {
-            bool variablesProcessed = false;
-            bool argsProcessing = false;
-            int j = 0;
-            std::string tmp = "";
-            while (true)
-            {
-              if (j >= cond.size())
-              {
-                char last = *tmp.rbegin();
-                if (isalpha(last) || last == '_' || last == ')' || last == '(')
-                {
-                  if (!variablesProcessed)
-                  {
-                    if (trim(tmp) == "in")
-                    {
-                      tokens.emplace_back(KEYWORD, "in");
-                      variablesProcessed = true;
-                    }
-                    else
-                    tokens.emplace_back(VARIABLE, trim(tmp));
-                  } else {
-                    std::string iterator = trim(tmp);
-                    {
-                      std::size_t pos = iterator.find("(");
-                      bool found = pos != std::string::npos;
-                      std::size_t pos2 = iterator.find(")");
-                      if (!found && pos2 != std::string::npos)
-                      {
-                        if (getLogLevel() <= ERROR)
-                        {
-                          std::cerr << colorize(RED) << "[TEMPLATE] Error! Argument list must be started with '('!" << colorize(NC) << "\n";
-                          const std::string filename = templ->getFileName();
-                          const std::string code = getFileString(filename);
-                          int cnt = getCurrentLine(code, i);
-                          std::cout << colorize(RED) << "[TEMPLATE] Error in '" << filename << "' on the line " << cnt << colorize(NC) << "\n";
-                        }
-                        return false;
-                      }
-
-                      if (found)
-                      {
-                        tokens.emplace_back(ITERATOR, iterator.substr(0, pos));
-                        auto args = split(iterator.substr(pos+1, pos2-pos-1), ",");
-                        for (auto ite: args)
-                        {
-                          if (!trim(ite).empty())
-                            tokens.emplace_back(ARGUMENT, trim(ite));
-                        }
-                      } else {
-                        tokens.emplace_back(VARIABLE, iterator);
-                      }
-                    }
-                  }
-                } else if (isdigit(last))
-                {
-                  tokens.emplace_back(MATH, trim(tmp));
-                } else if (last == '.') // format like 3. = 3.0
-                {
-                  tmp += "0";
-                  tokens.emplace_back(MATH, trim(tmp));
-                } else if (isOperator(last))
-                {
-                  tokens.emplace_back(OPERATOR, trim(tmp));
-                } else if (isComparative(last))
-                {
-                  tokens.emplace_back(COMPARISON_OPERATOR, trim(tmp));
-                }
-                tmp = "";
-
-                break;
-              }
-
-              if (!variablesProcessed)
-              {
-                if (tmp == "")
-                {
-                  tmp += cond[j];
-                } else if (cond[j] == ',')
-                {
-                  //Must be empty to not include commas in variable names 
-                } else if ( (isalpha(*tmp.rbegin()) || *tmp.rbegin() == '_') && !(isalpha(cond[j]) || isdigit(cond[j]) || cond[j] == '_'))
-                {
-                  if (trim(tmp) == "in")
-                  {
-                    tokens.emplace_back(KEYWORD, "in");
-                    variablesProcessed = true;
-                  } else 
-                      tokens.emplace_back(VARIABLE, trim(tmp));
-                    tmp = cond[j];
-                } else if ( (isdigit(*tmp.rbegin()) || *tmp.rbegin() == '.' || *tmp.rbegin() == '-') && !(isdigit(cond[j]) || cond[j] == '.' || cond[j] == '-'))
-                {
-                  tokens.emplace_back(MATH, trim(tmp));
-                  tmp = cond[j];
-                } else if (isOperator(*tmp.rbegin()) && !isOperator(cond[j]))
-                {
-                  tokens.emplace_back(OPERATOR, trim(tmp));
-                  tmp = cond[j];
-                } else if (isComparative(*tmp.rbegin()) && !isComparative(cond[j]))
-                {
-                  tokens.emplace_back(COMPARISON_OPERATOR, trim(tmp));
-                  tmp = cond[j];
-                } else {
-                  tmp += cond[j];
-                }
-              } else {
-                //parse iterator
-
-                if (tmp == "")
-                {
-                  tmp += cond[j];
-                } else if ( ((isalpha(*tmp.rbegin()) || *tmp.rbegin() == '_' || *tmp.rbegin() == ')' || *tmp.rbegin() == '(') && 
-                  !(isalpha(cond[j]) || cond[j] == '_' || cond[j] == ')' || cond[j] == '(' || cond[j] == ' ' || cond[j] == ',' || cond[j] == '.')))
-                {
-                  std::string iterator = trim(tmp);
-                  {
-                    std::size_t pos = iterator.find("(");
-                    bool found = pos != std::string::npos;
-                    std::size_t pos2 = iterator.find(")");
-                    if (!found && pos2 != std::string::npos)
-                    {
-                      if (getLogLevel() <= ERROR)
-                      {
-                        std::cerr << colorize(RED) << "[TEMPLATE] Error! Argument list must be started with '('!\n" << "  " << iterator << colorize(NC) << "\n";
-                        const std::string filename = templ->getFileName();
-                        const std::string code = getFileString(filename);
-                        int cnt = getCurrentLine(code, i);
-                        std::cout << colorize(RED) << "[TEMPLATE] Error in '" << filename << "' on the line " << cnt << colorize(NC) << "\n";
-                      }
-                      return false;
-                    }
-
-                    if (found)
-                    {
-                      tokens.emplace_back(ITERATOR, iterator.substr(0, pos));
-                      auto args = split(iterator.substr(pos+1, pos2-pos-1), ",");
-                      for (auto ite: args)
-                      {
-                        tokens.emplace_back(ARGUMENT, trim(ite));
-                      }
-                    } else {
-                      tokens.emplace_back(VARIABLE, iterator);
-                    }
-                  }
-
-                  //tmp = cond[j];
-                } else {
-                  tmp += cond[j];
-                }
-              }
-
-              j++;
-            } //end while
-
-            //find body
-            std::size_t endfor_end = 0;
-            int cnt = 0;
-            while (true)
-            {
+  if (!(*out.write)(out.data))
+  {
+    out.writeFailed = true;
+    return false;
+  }
+  out.data.clear();
+  return true;
+}
 
-              if (i+1 == code.size())
-              {
-                break; //EOF
-              }
-
-              std::size_t pos1 = code.find("{%", i);
-              if (pos1 == std::string::npos || i >= code.size())
-              {
-                if (getLogLevel() <= ERROR)
-                {
-                  std::cerr << colorize(RED) << "[TEMPLATE] Error! Cannot find ENDFOR!" << colorize(NC) << "\n";
-                  const std::string filename = templ->getFileName();
-                  const std::string code = getFileString(filename);
-                  int cnt = getCurrentLine(code, i);
-                  std::cout << colorize(RED) << "[TEMPLATE] Error in '" << filename << "' on the line " << cnt << colorize(NC) << "\n";
-                }
-                return false;
-              }
-
-              std::size_t pos2 = code.find("%}", pos1+2);
-              if (pos1 == std::string::npos || i >= code.size())
-              {
-                if (getLogLevel() <= ERROR)
-                {
-                  std::cerr << colorize(RED) << "[TEMPLATE] Error! Cannot find ENDFOR!" << colorize(NC) << "\n";
-                  const std::string filename = templ->getFileName();
-                  const std::string code = getFileString(filename);
-                  int cnt = getCurrentLine(code, i);
-                  std::cout << colorize(RED) << "[TEMPLATE] Error in '" << filename << "' on the line " << cnt << colorize(NC) << "\n";
-                }
-                return false;
-              }
-
-              i += pos2-pos1;
-
-              std::string found = code.substr(pos1+2, pos2-pos1-2);
-              std::string oper = "";
-              {
-                std::stringstream ss;
-                ss << trim(found);
-                std::getline(ss, oper, ' '); 
-                oper = trim(oper);
-              }
-
-              if (oper == "for")
-              {
-                cnt++;
-              } else if (oper == "endfor")
-              {
-                if (cnt != 0)
-                {
-                  cnt--;
-                } else {
-                  std::string body = code.substr(end+2, pos1-end-2);
-                  tokens.emplace_back(FOR_BODY, trim(body));
-                  tokens.emplace_back(ENDFOR, "endfor");
-                  endfor_end = pos2+2;
-                  break;
-                }
-              }
-
-              i++;
-            }
+static bool renderNodes(const CompiledTemplate& compiled, const std::vector<TemplateNode>& nodes, Scope& scope, HTMLTemplate* templ, RenderOutput& out);
 
-            bool is_ok = true;
-            auto res = parser_eval(templ, tokens, json, &is_ok);
-            tokens.clear();
-            if (!is_ok || !res)
-              return false;
+//renders the body of the loop for the variables pushed to 'scope' and removes them
+static bool renderIteration(const CompiledTemplate& compiled, const TemplateNode& node, Scope& scope, HTMLTemplate* templ, RenderOutput& out)
+{
+  //every iteration is trimmed
+  const size_t start = out.data.size();
+  out.loops++;
+  const bool ok = renderNodes(compiled, node.body, scope, templ, out);
+  out.loops--;
+  scope.locals.resize(scope.locals.size() - node.variables.size());
+  if (!ok)
+    return false;
+  trimFrom(out.data, start);
+  return flushOutput(out);
+}
 
-            std::string result = *res;
-            code.replace(start, endfor_end-start, result);
-            i = -1;
-            continue;
-          }
-        } else if (tmp == "block" || trim(op) == "endblock")
-        {
-          code.replace(start, end-start+2, "");
-          i = -1;
-          continue;
-        } else if (trim(op).substr(0, 9) == "loadblock")
+//appends the rendered nodes to 'out' in one pass. False on an error
+static bool renderNodes(const CompiledTemplate& compiled, const std::vector<TemplateNode>& nodes, Scope& scope, HTMLTemplate* templ, RenderOutput& out)
+{
+  for (const TemplateNode& node: nodes)
+  {
+    switch (node.type)
+    {
+      case TemplateNode::TEXT:
+        out.data += node.text;
+        break;
+      case TemplateNode::EXPRESSION:
+        if (!evalExpression(node.tokens, scope, out.data))
+          return renderError(compiled, node);
+        break;
+      case TemplateNode::CONDITION:
+      {
+        const auto result = evalCondition(node.tokens, scope);
+        if (!result)
+          return renderError(compiled, node);
+        if (!renderNodes(compiled, *result ? node.body : node.elseBody, scope, templ, out))
+          return false;
+        break;
+      }
+      case TemplateNode::LOOP:
+      {
+        if (node.loop == TemplateNode::FLASHES)
         {
-          std::string trimmed = trim(op);
-          std::size_t bracketStart = trimmed.find_first_of("(");
-          if (bracketStart == std::string::npos)
-          {
-            if (getLogLevel() <= ERROR)
-            {
-              std::cerr << colorize(RED) << "[TEMPLATE] Error! Invalid \"loadblock\" syntax!" << colorize(NC) << "\n";
-              const std::string filename = templ->getFileName();
-              const std::string code = getFileString(filename);
-              int cnt = getCurrentLine(code, i);
-              std::cout << colorize(RED) << "[TEMPLATE] Error in '" << filename << "' on the line " << cnt << colorize(NC) << "\n";
-            }
-            return false;
-          }
-
-          std::size_t bracketEnd = trimmed.find_first_of(")", bracketStart+1);
-          if (bracketEnd == std::string::npos)
-          {
-            if (getLogLevel() <= ERROR)
-            {
-              std::cerr << colorize(RED) << "[TEMPLATE] Error! Invalid \"loadblock\" syntax!" << colorize(NC) << "\n";
-              const std::string filename = templ->getFileName();
-              const std::string code = getFileString(filename);
-              int cnt = getCurrentLine(code, i);
-              std::cout << colorize(RED) << "[TEMPLATE] Error in '" << filename << "' on the line " << cnt << colorize(NC) << "\n";
-            }
-            return false;
-          }
-
-          std::string substr = trimmed.substr(bracketStart+1, bracketEnd-bracketStart-1);
-          bracketStart = substr.find_first_of("\""); //reuse variable
-          if (bracketStart == std::string::npos)
+          auto msg = templ->getFlashedMessages();
+          while (!msg->empty())
           {
-            if (getLogLevel() <= ERROR)
+            const nlohmann::json message = msg->top().first;
+            const nlohmann::json category = msg->top().second;
+            if (node.variables.size() == 1)
             {
-              std::cerr << colorize(RED) << "[TEMPLATE] Error! Invalid \"loadblock\" syntax!" << colorize(NC) << "\n";
-              const std::string filename = templ->getFileName();
-              const std::string code = getFileString(filename);
-              int cnt = getCurrentLine(code, i);
-              std::cout << colorize(RED) << "[TEMPLATE] Error in '" << filename << "' on the line " << cnt << colorize(NC) << "\n";
-            }
-            return false;
-          }
-
-          bracketEnd = substr.find_first_of("\"", bracketStart+1); //reuse variable
-          if (bracketEnd == std::string::npos)
-          {
-            if (getLogLevel() <= ERROR)
-            {
-              std::cerr << colorize(RED) << "[TEMPLATE] Error! Invalid \"loadblock\" syntax!" << colorize(NC) << "\n";
-              const std::string filename = templ->getFileName();
-              const std::string code = getFileString(filename);
-              int cnt = getCurrentLine(code, i);
-              std::cout << colorize(RED) << "[TEMPLATE] Error in '" << filename << "' on the line " << cnt << colorize(NC) << "\n";
-            }
-            return false;
-          }
-
-          std::string filename = substr.substr(bracketStart+1, bracketEnd-bracketStart-1);
-
-          std::size_t nameStart = substr.find_first_of(",", bracketEnd+1);
-          if (nameStart == std::string::npos)
-          {
-            if (getLogLevel() <= ERROR)
-            {
-              std::cerr << colorize(RED) << "[TEMPLATE] Error! Invalid \"loadblock\" syntax!" << colorize(NC) << "\n";
-              const std::string filename = templ->getFileName();
-              const std::string code = getFileString(filename);
-              int cnt = getCurrentLine(code, i);
-              std::cout << colorize(RED) << "[TEMPLATE] Error in '" << filename << "' on the line " << cnt << colorize(NC) << "\n";
-            }
-            return false;
-          }
-
-          std::string name = trim(substr.substr(nameStart+1));
-
-          std::string file = getFileString(filename);
-          std::size_t blockStart = -2;
-          std::size_t blockStartEnd = -2;
-          while (blockStart != std::string::npos && blockStartEnd != std::string::npos)
-          {
-            blockStart = file.find("{%", blockStartEnd+2);
-            if (blockStart == std::string::npos)
-            {
-              if (getLogLevel() <= ERROR)
-              {
-                std::cerr << colorize(RED) << "[TEMPLATE] Error! Cannot find the \"" << name << "\" in the file \"" << filename << "\"!" << colorize(NC) << "\n";
-                const std::string filename = templ->getFileName();
-                const std::string code = getFileString(filename);
-                int cnt = getCurrentLine(code, i);
-                std::cout << colorize(RED) << "[TEMPLATE] Error in '" << filename << "' on the line " << cnt << colorize(NC) << "\n";
-              }
-              return false;
-            }
-
-            blockStartEnd = file.find("%}", blockStart+2);
-            if (blockStartEnd == std::string::npos)
-            {
-              if (getLogLevel() <= ERROR)
-              {
-                std::cerr << colorize(RED) << "[TEMPLATE] Error! Cannot find the \"" << name << "\" in the file \"" << filename << "\"!" << colorize(NC) << "\n";
-                const std::string filename = templ->getFileName();
-                const std::string code = getFileString(filename);
-                int cnt = getCurrentLine(code, i);
-                std::cout << colorize(RED) << "[TEMPLATE] Error in '" << filename << "' on the line " << cnt << colorize(NC) << "\n";
-              }
-              return false;
-            }
-
-            std::string fnd = trim(file.substr(blockStart+2, blockStartEnd-blockStart-2));
-            if (fnd.substr(0, 5) != "block")
-              continue;
-
-            if (trim(fnd.substr(6)) != name)
-            {
-              continue;
+              scope.locals.emplace_back(&node.variables[0], &message);
             } else {
-              break;
+              scope.locals.emplace_back(&node.variables[0], &category);
+              scope.locals.emplace_back(&node.variables[1], &message);
             }
-          }
 
-          std::size_t blockEnd = blockStartEnd;
-          std::size_t blockEndEnd = blockStartEnd;
-          int cnt = 0;
-          while (blockEnd != std::string::npos && blockEndEnd != std::string::npos)
-          {
-            blockEnd = file.find("{%", blockEndEnd+2);
-            if (blockEnd == std::string::npos)
-            {
-              if (getLogLevel() <= ERROR)
-              {
-                std::cerr << colorize(RED) << "[TEMPLATE] Error! Cannot find \"endblock\" of the block \"" << name << "\"!" << colorize(NC) << "\n";
-                int cnt = getCurrentLine(file, blockEndEnd);
-                std::cout << colorize(RED) << "[TEMPLATE] Error in '" << filename << "' on the line " << cnt << colorize(NC) << "\n";
-              }
+            if (!renderIteration(compiled, node, scope, templ, out))
               return false;
-            }
-
-            blockEndEnd = file.find("%}", blockEnd);
-            if (blockEndEnd == std::string::npos)
-            {
-              if (getLogLevel() <= ERROR)
-              {
-                std::cerr << colorize(RED) << "[TEMPLATE] Error! Cannot find \"endblock\" of the block \"" << name << "\"!" << colorize(NC) << "\n";
-                int cnt = getCurrentLine(file, blockEndEnd);
-                std::cout << colorize(RED) << "[TEMPLATE] Error in '" << filename << "' on the line " << cnt << colorize(NC) << "\n";
-              }
-              return false;
-            }
-
-            std::string fnd = trim(file.substr(blockEnd+2, blockEndEnd-blockEnd-2));
-            if (fnd == "endblock")
-            {
-              if (cnt == 0)
-              {
-                break;
-              } else {
-                cnt--;
-              }
-            } else if (fnd.substr(0, 5) == "block") {
-              cnt++;
-            } else {
-              continue;
-            }
-          }
-
-          std::string blockPart = trim(file.substr(blockStartEnd+2, blockEnd-blockStartEnd-2));
-          code.replace(start, end-start+2, blockPart);
-          i = -1;
-          continue;
-
-        } else {
-          if (getLogLevel() <= ERROR)
-          {
-            std::cerr << colorize(RED) << "[TEMPLATE] Unrecognized token \"" << trim(op) << "\"!" << colorize(NC) << "\n";
-            const std::string filename = templ->getFileName();
-            const std::string code = getFileString(filename);
-            int cnt = getCurrentLine(code, i);
-            std::cout << colorize(RED) << "[TEMPLATE] Error in '" << filename << "' on the line " << cnt << colorize(NC) << "\n";
+            msg->pop();
           }
-          return false;
+          break;
         }
-      }
-    }
-
-    if (i+1 < code.size() && code[i] == '{' && code[i+1] == '{')
-    {
-      i += 2; //on position after '{{'
-
-      std::string tmp = "";
 
-      std::size_t start = i-2;
-      std::size_t end = i-2;
-      while (true)
-      {
-        if (code[i] == ' ')
+        const nlohmann::json* val = getJson(scope, node.iterable);
+        if (!val)
         {
-          i++;
-          continue;
+          if (getLogLevel() <= ERROR)
+            std::cerr << colorize(RED) << "[TEMPLATE] Error! Cannot find the json array \"" << joinPath(node.iterable) << "\"!" << colorize(NC) << "\n";
+          return renderError(compiled, node);
         }
-
-        if (i+1 == code.size()) //end of file
+        if (!val->is_array())
         {
-          break;
+          if (getLogLevel() <= ERROR)
+            std::cerr << colorize(RED) << "[TEMPLATE] Error! Iteration supports only json arrays! Provided object is not an array!" << colorize(NC) << "\n";
+          return renderError(compiled, node);
         }
 
-        if (i+1 < code.size() && code[i] == '}' && code[i+1] == '}')
+        size_t index = 0;
+        nlohmann::json indexValue;
+        for (const nlohmann::json& item: *val)
         {
-
-          char first = *trim(tmp).begin();
-          char last = *trim(tmp).rbegin();
-          if (first == '.' && isdigit(*(tmp.begin()+1)))
-          {
-            //.0 -> 0.0
-            tokens.emplace_back(MATH, "0" + trim(tmp));
-          } else if (first == '|')
-          {
-            tokens.emplace_back(FLAG, tmp.substr(1));
-          } else if (isalpha(first) || first == '_')
+          if (node.loop == TemplateNode::ENUMERATE)
           {
-            tokens.emplace_back(VARIABLE, trim(tmp));
-          } else if (isdigit(first))
-          {
-            tokens.emplace_back(MATH, trim(tmp));
-          } else if (isOperator(first))
-          {
-            tokens.emplace_back(OPERATOR, trim(tmp));
+            indexValue = std::to_string(index++);
+            scope.locals.emplace_back(&node.variables[0], &indexValue);
+            scope.locals.emplace_back(&node.variables[1], &item);
+          } else {
+            scope.locals.emplace_back(&node.variables[0], &item);
           }
 
-          tmp = "";
-
-          i += 2;
-
-          end = i;
-          auto res = parser_eval(templ, tokens, json);
-          if (!res)
-          {
-            if (getLogLevel() <= ERROR)
-            {
-              const std::string filename = templ->getFileName();
-              const std::string code = getFileString(filename);
-              int cnt = getCurrentLine(code, i)-1;
-              std::cout << colorize(RED) << "[TEMPLATE] Error in '" << filename << "' on the line " << cnt << colorize(NC) << "\n";
-            }
+          if (!renderIteration(compiled, node, scope, templ, out))
             return false;
-          }
-          const std::string result = *res;
-          tokens.clear();
-          code.replace(start, end-start, result);
-          i = -1; //to the beginning
-
-          break;
         }
+        break;
+      }
+    }
 
-        /*if (tmp == "")
-          {
-            tmp += code[i];
-          }
-          else if ( (isalpha(*tmp.rbegin()) || *tmp.rbegin() == '_') && (!(isalpha(code[i]) || code[i] == '_')))
-          {
-            tokens.emplace_back(VARIABLE, tmp);
-            tmp = code[i];
-          } else if ( (isdigit(*tmp.rbegin()) || *tmp.rbegin() == '.') && !(isdigit(code[i]) || code[i] == '.'))
-          {
-            tokens.emplace_back(MATH, tmp);
-            tmp = code[i];
-          } else if (isOperator(*tmp.rbegin()) && !isOperator(code[i]))
-          {
-            tokens.emplace_back(OPERATOR, tmp);
-            tmp = code[i];
-          } else {
-            tmp += code[i];
-          }*/
+    if (!flushOutput(out))
+      return false;
+  }
+  return true;
+}
 
-        char first = *tmp.begin();
-        char last = *tmp.rbegin();
-        if (tmp == "")
-        {
-          tmp += code[i];
-        } else if (code[i] == '|' && first == '|') //flag
-        {
-          tokens.emplace_back(FLAG, tmp.substr(1));
-          tmp = code[i];
-        } else if (isOperator(first) && !isOperator(code[i]))
-        {
-          tokens.emplace_back(OPERATOR, trim(tmp));
-          tmp = code[i];
-        } else if ( (isdigit(first) || first == '.') && !(isdigit(code[i]) || code[i] == '.'))
-        {
-          tokens.emplace_back(MATH, trim(tmp));
-          tmp = code[i];
-        } else if ( (isalpha(first) || first == '_') && !(isalpha(code[i]) || isdigit(code[i]) || code[i] == '_'))
-        {
-          tokens.emplace_back(VARIABLE, tmp);
-          tmp = code[i];
-        } else {
-          tmp += code[i];
-        }
+bool HTMLTemplate::render(const nlohmann::json& json, const TemplateWriter* write, const size_t chunkSize)
+{
+  //templates of files are compiled by createTemplate, others are compiled on every render
+  auto compiled = m_compiled ? m_compiled : compileTemplate(m_html, m_templateFileName);
+  RenderOutput out;
+  out.write = write;
+  out.chunkSize = chunkSize;
+  bool ok = !compiled->failed;
+  if (ok)
+  {
+    if (!write)
+      out.data.reserve(compiled->source.size() + compiled->source.size() / 2);
+    Scope scope{json, {}};
+    ok = renderNodes(*compiled, compiled->nodes, scope, this, out) && flushOutput(out, true);
+  }
 
-        i++;
-      } //end while
+  if (!ok)
+  {
+    if (out.writeFailed) // connection is lost
+      return false;
+    if (getLogLevel() <= ERROR)
+    {
+      if (write)
+        std::cout << colorize(RED) << "[TEMPLATE] Rendering error detected! Streaming is stopped!" << colorize(NC) << "\n";
+      else
+        std::cout << colorize(RED) << "[TEMPLATE] Rendering error detected! No changes have been made!" << colorize(NC) << "\n";
     }
+    responce = HTTP_500;
+    return false;
   }
 
+  m_html = std::move(out.data); // empty if it is written
+  m_compiled = nullptr;
   return true;
 }
 
 void HTMLTemplate::renderJSON(const nlohmann::json& json)
 {
-  std::string reserve_copy = m_html;
-  if (!lexer_analyze(this, reserve_copy, json))
-  {
-    if (getLogLevel() <= ERROR)
-      std::cout << colorize(RED) << "[TEMPLATE] Rendering error detected! No changes have been made!" << colorize(NC) << "\n";
-    responce = HTTP_500;
-    return;
-  }
+  render(json, nullptr, 0);
+}
+
+void HTMLTemplate::streamJSON(nlohmann::json json, const size_t chunkSize)
+{
+  m_streamJson = std::make_shared<const nlohmann::json>(std::move(json));
+  m_streamChunkSize = chunkSize;
+}
+
+bool HTMLTemplate::isStreamed() const
+{
+  return m_streamJson != nullptr;
+}
+
+bool HTMLTemplate::renderStream(const TemplateWriter& write)
+{
+  if (!m_streamJson)
+    return true;
 
-  m_html = reserve_copy;
+  const auto json = std::move(m_streamJson);
+  m_streamJson = nullptr;
+  return render(*json, write ? &write : nullptr, m_streamChunkSize);
 }
 
 const std::string& HTMLTemplate::getHTML() const
 {
+  if (m_compiled)
+    return m_compiled->source;
   return m_html;
 }
 
@@ -2092,11 +1449,15 @@ HTMLTemplate::HTMLTemplate()
 HTMLTemplate::HTMLTemplate(const HTMLTemplate& temp)
 {
   m_html = temp.m_html;
+  m_compiled = temp.m_compiled;
+  m_streamJson = temp.m_streamJson;
+  m_streamChunkSize = temp.m_streamChunkSize;
   m_templateFileName = temp.m_templateFileName;
   responce = temp.responce;
   encoding = temp.encoding;
   contentType = temp.contentType;
   ignoreHandlers = temp.ignoreHandlers;
+  compress = temp.compress;
   m_location = temp.m_location;
   m_cookies = temp.m_cookies;
 }
@@ -2106,11 +1467,15 @@ HTMLTemplate& HTMLTemplate::operator=(const HTMLTemplate& temp)
   if (this != &temp)
   {
     m_html = temp.m_html;
+    m_compiled = temp.m_compiled;
+    m_streamJson = temp.m_streamJson;
+    m_streamChunkSize = temp.m_streamChunkSize;
     m_templateFileName = temp.m_templateFileName;
     responce = temp.responce;
     encoding = temp.encoding;
     contentType = temp.contentType;
     ignoreHandlers = temp.ignoreHandlers;
+    compress = temp.compress;
     m_location = temp.m_location;
     m_cookies = temp.m_cookies;
   }
@@ -2122,20 +1487,27 @@ HTMLTemplate& HTMLTemplate::operator=(HTMLTemplate&& temp)
   if (this != &temp)
   {
     m_html = temp.m_html;
+    m_compiled = temp.m_compiled;
+    m_streamJson = temp.m_streamJson;
+    m_streamChunkSize = temp.m_streamChunkSize;
     m_templateFileName = temp.m_templateFileName;
     responce = temp.responce;
     encoding = temp.encoding;
     contentType = temp.contentType;
     ignoreHandlers = temp.ignoreHandlers;
+    compress = temp.compress;
     m_location = temp.m_location;
     m_cookies = temp.m_cookies;
 
     temp.m_html = "";
+    temp.m_compiled = nullptr;
+    temp.m_streamJson = nullptr;
     temp.m_templateFileName = "";
     temp.responce = HTTP_500; //if server sends empty HTML -> error
     temp.encoding = "";
     temp.contentType = "";
     temp.ignoreHandlers = false;
+    temp.compress = true;
     temp.m_location = "";
     temp.m_cookies.clear();
   }
@@ -2145,20 +1517,27 @@ HTMLTemplate& HTMLTemplate::operator=(HTMLTemplate&& temp)
 HTMLTemplate::HTMLTemplate(HTMLTemplate&& temp)
 {
   m_html = temp.m_html;
+  m_compiled = temp.m_compiled;
+  m_streamJson = temp.m_streamJson;
+  m_streamChunkSize = temp.m_streamChunkSize;
   m_templateFileName = temp.m_templateFileName;
   responce = temp.responce;
   encoding = temp.encoding;
   contentType = temp.contentType;
   ignoreHandlers = temp.ignoreHandlers;
+  compress = temp.compress;
   m_location = temp.m_location;
   m_cookies = temp.m_cookies;
 
   temp.m_html = "";
+  temp.m_compiled = nullptr;
+  temp.m_streamJson = nullptr;
   temp.m_templateFileName = "";
   temp.responce = HTTP_500; //if server sends empty HTML -> error
   temp.encoding = "";
   temp.contentType = "";
   temp.ignoreHandlers = false;
+  temp.compress = true;
   temp.m_location = "";
   temp.m_cookies.clear();
 }
@@ -0,0 +1,545 @@
+#include "../include/HTTPParser.h"
+#include "../include/Utility.h"
+#include "../include/Scanner.h"
+
+#include <algorithm>
+
+#define MAX_CHUNK_FRAMING 65536 // ignored bytes of a chunk extension or of the trailer section
+
+namespace rweb
+{
+
+//visible ASCII characters allowed in method and request target
+static inline bool isTokenChar(const char c)
+{
+  return c > 0x20 && c < 0x7f;
+}
+
+RequestParser::RequestParser(size_t maxHeadSize)
+: m_maxHeadSize(maxHeadSize)
+{
+  reset();
+}
+
+void RequestParser::reset()
+{
+  m_state = LEADING_NEWLINES;
+  m_result = INCOMPLETE;
+  m_pos = 0;
+  m_tokenStart = 0;
+  m_headerName = Slice{};
+  method = Slice{};
+  target = Slice{};
+  protocol = Slice{};
+  headers.clear();
+}
+
+RequestParser::Result RequestParser::getResult() const
+{
+  return m_result;
+}
+
+size_t RequestParser::getHeadSize() const
+{
+  return m_pos;
+}
+
+RequestParser::Result RequestParser::parse(std::string_view buffer)
+{
+  if (m_result != INCOMPLETE)
+    return m_result;
+
+  while (m_pos < buffer.size())
+  {
+    //ordinary bytes of a token are skipped at once, the switch only sees delimiters
+    switch (m_state)
+    {
+      case METHOD:
+      case TARGET:
+      case PROTOCOL:
+        m_pos = scanFor(buffer, m_pos, SCAN_NONTOKEN);
+        break;
+      case HEADER_NAME:
+        m_pos = scanFor(buffer, m_pos, SCAN_NONTOKEN | SCAN_COLON);
+        break;
+      case HEADER_VALUE:
+        m_pos = scanFor(buffer, m_pos, SCAN_CONTROL);
+        break;
+      default:
+        break;
+    }
+
+    if (m_pos >= m_maxHeadSize)
+    {
+      m_result = TOO_LARGE;
+      return m_result;
+    }
+
+    if (m_pos >= buffer.size())
+      break;
+
+    const char c = buffer[m_pos];
+    switch (m_state)
+    {
+      case LEADING_NEWLINES:
+        //empty lines before the request line are ignored (RFC 7230 3.5)
+        if (c != '\r' && c != '\n')
+        {
+          m_tokenStart = m_pos;
+          m_state = METHOD;
+          continue; // parse this byte again as a part of the method
+        }
+        break;
+
+      case METHOD:
+        if (c == ' ')
+        {
+          if (m_pos == m_tokenStart)
+            return m_result = INVALID;
+          method = Slice{(uint32_t)m_tokenStart, (uint32_t)(m_pos - m_tokenStart)};
+          m_tokenStart = m_pos + 1;
+          m_state = TARGET;
+        } else if (!isTokenChar(c))
+        {
+          return m_result = INVALID;
+        }
+        break;
+
+      case TARGET:
+        if (c == ' ')
+        {
+          if (m_pos == m_tokenStart)
+            return m_result = INVALID;
+          target = Slice{(uint32_t)m_tokenStart, (uint32_t)(m_pos - m_tokenStart)};
+          m_tokenStart = m_pos + 1;
+          m_state = PROTOCOL;
+        } else if (!isTokenChar(c))
+        {
+          return m_result = INVALID;
+        }
+        break;
+
+      case PROTOCOL:
+        if (c == '\r' || c == '\n')
+        {
+          protocol = Slice{(uint32_t)m_tokenStart, (uint32_t)(m_pos - m_tokenStart)};
+          if (protocol.in(buffer).substr(0, 5) != "HTTP/")
+            return m_result = INVALID;
+          m_state = c == '\r' ? REQUEST_LINE_LF : HEADER_START;
+        } else if (!isTokenChar(c))
+        {
+          return m_result = INVALID;
+        }
+        break;
+
+      case REQUEST_LINE_LF:
+        if (c != '\n')
+          return m_result = INVALID;
+        m_state = HEADER_START;
+        break;
+
+      case HEADER_START:
+        if (c == '\r')
+        {
+          m_state = HEAD_END_LF;
+        } else if (c == '\n')
+        {
+          m_pos++;
+          m_state = DONE;
+          return m_result = COMPLETE;
+        } else if (c == ' ' || c == '\t' || c == ':')
+        {
+          //obsolete line folding and empty names are not supported
+          return m_result = INVALID;
+        } else if (!isTokenChar(c))
+        {
+          return m_result = INVALID;
+        } else {
+          m_tokenStart = m_pos;
+          m_state = HEADER_NAME;
+        }
+        break;
+
+      case HEADER_NAME:
+        if (c == ':')
+        {
+          m_headerName = Slice{(uint32_t)m_tokenStart, (uint32_t)(m_pos - m_tokenStart)};
+          m_state = HEADER_VALUE_START;
+        } else if (!isTokenChar(c))
+        {
+          //no whitespace is allowed between the name and the colon (RFC 7230 3.2.4)
+          return m_result = INVALID;
+        }
+        break;
+
+      case HEADER_VALUE_START:
+        if (c == ' ' || c == '\t')
+          break;
+        m_tokenStart = m_pos;
+        m_state = HEADER_VALUE;
+        continue; // parse this byte again as a part of the value
+
+      case HEADER_VALUE:
+        if (c == '\r' || c == '\n')
+        {
+          // trailing whitespace is not a part of the value
+          size_t valueEnd = m_pos;
+          while (valueEnd > m_tokenStart && (buffer[valueEnd-1] == ' ' || buffer[valueEnd-1] == '\t'))
+            valueEnd--;
+          headers.emplace_back(m_headerName, Slice{(uint32_t)m_tokenStart, (uint32_t)(valueEnd - m_tokenStart)});
+          m_state = c == '\r' ? HEADER_LF : HEADER_START;
+        } else {
+          return m_result = INVALID; // control character
+        }
+        break;
+
+      case HEADER_LF:
+        if (c != '\n')
+          return m_result = INVALID;
+        m_state = HEADER_START;
+        break;
+
+      case HEAD_END_LF:
+        if (c != '\n')
+          return m_result = INVALID;
+        m_pos++;
+        m_state = DONE;
+        return m_result = COMPLETE;
+
+      case DONE:
+        return m_result = COMPLETE;
+    }
+
+    m_pos++;
+  }
+
+  if (m_pos >= m_maxHeadSize)
+    m_result = TOO_LARGE;
+  return m_result;
+}
+
+std::string_view RequestParser::getHeader(std::string_view buffer, std::string_view name) const
+{
+  for (auto& h : headers)
+  {
+    if (equalsIgnoreCase(h.first.in(buffer), name))
+      return h.second.in(buffer);
+  }
+  return std::string_view{};
+}
+
+//returns -1 for non-hex characters
+static inline int hexValue(const char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+BodyDecoder::BodyDecoder()
+{
+  reset();
+}
+
+void BodyDecoder::reset()
+{
+  m_chunked = false;
+  m_state = CHUNK_SIZE;
+  m_maxBodySize = 0;
+  m_bodyStart = 0;
+  m_contentLength = 0;
+  m_bodySize = 0;
+  m_chunkLeft = 0;
+  m_chunkDigits = 0;
+  m_framingSize = 0;
+  m_read = 0;
+  m_write = 0;
+}
+
+bool BodyDecoder::isChunked() const
+{
+  return m_chunked;
+}
+
+size_t BodyDecoder::getBodySize() const
+{
+  return m_bodySize;
+}
+
+size_t BodyDecoder::getContentLength() const
+{
+  return m_contentLength;
+}
+
+size_t BodyDecoder::getDecodedEnd() const
+{
+  return m_write;
+}
+
+size_t BodyDecoder::getConsumedEnd() const
+{
+  return m_read;
+}
+
+BodyDecoder::Result BodyDecoder::start(std::string_view buffer, const RequestParser& head, size_t maxBodySize)
+{
+  reset();
+  m_maxBodySize = maxBodySize;
+  m_bodyStart = head.getHeadSize();
+  m_read = m_bodyStart;
+  m_write = m_bodyStart;
+
+  //only bare chunked is decoded. Other codings would reach the route still encoded
+  bool transferEncoding = false;
+  bool contentLength = false;
+  for (auto& h : head.headers)
+  {
+    std::string_view name = h.first.in(buffer);
+    if (equalsIgnoreCase(name, "Content-Length"))
+    {
+      contentLength = true;
+    } else if (equalsIgnoreCase(name, "Transfer-Encoding"))
+    {
+      std::string_view value = h.second.in(buffer);
+      while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+        value.remove_prefix(1);
+      while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+        value.remove_suffix(1);
+      if (transferEncoding || !equalsIgnoreCase(value, "chunked"))
+        return NOT_IMPLEMENTED;
+      transferEncoding = true;
+    }
+  }
+
+  if (transferEncoding)
+  {
+    //both framings at once is a request smuggling attempt (RFC 7230 3.3.3)
+    if (contentLength)
+      return INVALID;
+
+    m_chunked = true;
+    return INCOMPLETE;
+  }
+
+  bool found = false;
+  for (auto& h : head.headers)
+  {
+    if (!equalsIgnoreCase(h.first.in(buffer), "Content-Length"))
+      continue;
+
+    std::string_view value = h.second.in(buffer);
+    if (value.empty() || value.size() > 18)
+      return INVALID;
+
+    size_t length = 0;
+    for (const char c : value)
+    {
+      if (c < '0' || c > '9')
+        return INVALID;
+      length = length * 10 + (c - '0');
+    }
+
+    //repeated headers must agree
+    if (found && length != m_contentLength)
+      return INVALID;
+    found = true;
+    m_contentLength = length;
+  }
+
+  if (!found)
+  {
+    std::string_view method = head.method.in(buffer);
+    if (method == "POST" || method == "PUT" || method == "PATCH")
+      return LENGTH_REQUIRED;
+    return COMPLETE; // no body
+  }
+
+  if (m_maxBodySize && m_contentLength > m_maxBodySize)
+    return TOO_LARGE;
+
+  return m_contentLength == 0 ? COMPLETE : INCOMPLETE;
+}
+
+BodyDecoder::Result BodyDecoder::onChunkSize()
+{
+  m_framingSize = 0;
+  if (m_chunkLeft == 0)
+  {
+    m_state = TRAILER_START;
+    return INCOMPLETE;
+  }
+
+  if (m_maxBodySize && m_bodySize + m_chunkLeft > m_maxBodySize)
+    return TOO_LARGE;
+
+  m_state = CHUNK_DATA;
+  return INCOMPLETE;
+}
+
+BodyDecoder::Result BodyDecoder::decode(std::string& buffer)
+{
+  if (!m_chunked)
+  {
+    //bytes before m_read are already counted (takeBody may have removed them)
+    const size_t n = std::min(m_contentLength - m_bodySize, buffer.size() - m_read);
+    m_read += n;
+    m_write = m_read;
+    m_bodySize += n;
+    return m_bodySize == m_contentLength ? COMPLETE : INCOMPLETE;
+  }
+
+  while (m_read < buffer.size())
+  {
+    const char c = buffer[m_read];
+    switch (m_state)
+    {
+      case CHUNK_SIZE:
+      {
+        const int v = hexValue(c);
+        if (v >= 0)
+        {
+          if (++m_chunkDigits > 15)
+            return TOO_LARGE;
+          m_chunkLeft = m_chunkLeft * 16 + v;
+        } else if (m_chunkDigits == 0)
+        {
+          return INVALID;
+        } else if (c == ';' || c == ' ' || c == '\t')
+        {
+          m_state = CHUNK_EXTENSION;
+        } else if (c == '\r')
+        {
+          m_state = CHUNK_SIZE_LF;
+        } else if (c == '\n')
+        {
+          Result res = onChunkSize();
+          if (res != INCOMPLETE)
+            return res;
+        } else {
+          return INVALID;
+        }
+        break;
+      }
+
+      case CHUNK_EXTENSION:
+        //extensions are ignored, but they stay in the buffer until the body is complete
+        if (++m_framingSize > MAX_CHUNK_FRAMING)
+          return TOO_LARGE;
+        if (c == '\r')
+        {
+          m_state = CHUNK_SIZE_LF;
+        } else if (c == '\n')
+        {
+          Result res = onChunkSize();
+          if (res != INCOMPLETE)
+            return res;
+        }
+        break;
+
+      case CHUNK_SIZE_LF:
+      {
+        if (c != '\n')
+          return INVALID;
+        Result res = onChunkSize();
+        if (res != INCOMPLETE)
+          return res;
+        break;
+      }
+
+      case CHUNK_DATA:
+      {
+        //move chunk data over the framing bytes which are already consumed
+        const size_t n = std::min(m_chunkLeft, buffer.size() - m_read);
+        if (m_write != m_read)
+          buffer.replace(m_write, n, buffer, m_read, n);
+        m_write += n;
+        m_read += n;
+        m_bodySize += n;
+        m_chunkLeft -= n;
+        if (m_chunkLeft == 0)
+          m_state = CHUNK_DATA_CR;
+        continue;
+      }
+
+      case CHUNK_DATA_CR:
+        if (c == '\r')
+        {
+          m_state = CHUNK_DATA_LF;
+        } else if (c == '\n')
+        {
+          m_state = CHUNK_SIZE;
+          m_chunkDigits = 0;
+        } else {
+          return INVALID;
+        }
+        break;
+
+      case CHUNK_DATA_LF:
+        if (c != '\n')
+          return INVALID;
+        m_state = CHUNK_SIZE;
+        m_chunkDigits = 0;
+        break;
+
+      case TRAILER_START:
+        if (++m_framingSize > MAX_CHUNK_FRAMING)
+          return TOO_LARGE;
+        if (c == '\r')
+        {
+          m_state = END_LF;
+        } else if (c == '\n')
+        {
+          m_read++;
+          m_state = DONE;
+          return COMPLETE;
+        } else {
+          m_state = TRAILER; // trailer fields are ignored
+        }
+        break;
+
+      case TRAILER:
+        if (++m_framingSize > MAX_CHUNK_FRAMING)
+          return TOO_LARGE;
+        if (c == '\n')
+          m_state = TRAILER_START;
+        break;
+
+      case END_LF:
+        if (c != '\n')
+          return INVALID;
+        m_read++;
+        m_state = DONE;
+        return COMPLETE;
+
+      case DONE:
+        return COMPLETE;
+    }
+
+    m_read++;
+  }
+
+  return m_state == DONE ? COMPLETE : INCOMPLETE;
+}
+
+std::string BodyDecoder::takeBody(std::string& buffer)
+{
+  std::string body;
+  if (m_bodyStart == 0 && m_read == buffer.size() && m_write == m_read)
+  {
+    body.swap(buffer); // everything received is body
+  } else {
+    body = buffer.substr(m_bodyStart, m_write - m_bodyStart);
+    buffer.erase(0, m_read);
+  }
+
+  m_bodyStart = 0;
+  m_read = 0;
+  m_write = 0;
+  return body;
+}
+
+}
@@ -0,0 +1,485 @@
+#include "../include/Multipart.h"
+#include "../include/BodyReader.h"
+#include "../include/Utility.h"
+
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <random>
+
+namespace rweb
+{
+
+static std::string_view trimView(std::string_view s)
+{
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+    s.remove_prefix(1);
+  while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+    s.remove_suffix(1);
+  return s;
+}
+
+TempFile::TempFile()
+: m_file(nullptr), m_kept(false)
+{
+  std::error_code ec;
+  const std::filesystem::path dir = std::filesystem::temp_directory_path(ec);
+  if (!ec)
+  {
+    std::random_device random;
+    for (int i=0;i<16 && !m_file;++i)
+    {
+      char name[40];
+      snprintf(name, sizeof(name), "rweb-%08x%08x.tmp", (unsigned)random(), (unsigned)random());
+      m_path = (dir / name).string();
+      m_file = std::fopen(m_path.c_str(), "wbx"); // fails if the file exists
+    }
+  }
+
+  if (!m_file)
+  {
+    m_path.clear();
+    if (getLogLevel() <= ERROR)
+      std::cerr << colorize(RED) << "[ERROR] Failed to create temp file!" << colorize(NC) << "\n";
+  }
+}
+
+TempFile::~TempFile()
+{
+  if (m_file)
+    std::fclose(m_file);
+  if (!m_kept && !m_path.empty())
+    std::remove(m_path.c_str());
+}
+
+bool TempFile::isOpen() const
+{
+  return m_file != nullptr;
+}
+
+bool TempFile::write(std::string_view data)
+{
+  return m_file && std::fwrite(data.data(), 1, data.size(), m_file) == data.size();
+}
+
+bool TempFile::close()
+{
+  if (!m_file)
+    return !m_path.empty();
+
+  const bool ok = std::fclose(m_file) == 0;
+  m_file = nullptr;
+  return ok;
+}
+
+bool TempFile::keep(const std::string& path)
+{
+  if (!close())
+    return false;
+
+  std::error_code ec;
+  std::filesystem::rename(m_path, path, ec);
+  if (ec)
+  {
+    //temp directory may be on another device
+    ec.clear();
+    std::filesystem::copy_file(m_path, path, std::filesystem::copy_options::overwrite_existing, ec);
+    if (ec)
+      return false;
+    std::remove(m_path.c_str());
+  }
+
+  m_path = path;
+  m_kept = true;
+  return true;
+}
+
+const std::string& TempFile::getPath() const
+{
+  return m_path;
+}
+
+std::string_view FormPart::getHeader(std::string_view name) const
+{
+  for (auto& h : headers)
+  {
+    if (equalsIgnoreCase(h.first, name))
+      return h.second;
+  }
+  return {};
+}
+
+MultipartParser::MultipartParser(std::string_view boundary, size_t maxHeaderSize)
+: m_delimiter("\r\n--" + std::string(boundary)), m_searcher(m_delimiter.begin(), m_delimiter.end()),
+  m_maxHeaderSize(maxHeaderSize), m_state(PREAMBLE), m_carry("\r\n") // first delimiter has no CRLF before it
+{
+}
+
+bool MultipartParser::emit(std::string_view data, Handler& handler)
+{
+  //preamble is ignored
+  if (m_state != DATA || data.empty())
+    return true;
+  return handler.onPartData(data);
+}
+
+bool MultipartParser::findDelimiter(std::string_view input, size_t& pos, Handler& handler, bool& failed)
+{
+  const size_t keep = m_delimiter.size() - 1; // longest unfinished delimiter
+
+  if (!m_carry.empty())
+  {
+    //delimiter may start in the tail of the previous input. Only a boundary-long piece is copied
+    std::string joined = m_carry;
+    joined.append(input.substr(pos, keep));
+    const size_t p = joined.find(m_delimiter);
+    if (p != std::string::npos)
+    {
+      failed = !emit(std::string_view(joined).substr(0, p), handler);
+      pos += p + m_delimiter.size() - m_carry.size();
+      m_carry.clear();
+      return true;
+    }
+
+    if (input.size() - pos < keep)
+    {
+      //whole input is in 'joined'
+      const size_t tail = std::min(keep, joined.size());
+      failed = !emit(std::string_view(joined).substr(0, joined.size() - tail), handler);
+      m_carry = joined.substr(joined.size() - tail);
+      pos = input.size();
+      return false;
+    }
+
+    failed = !emit(m_carry, handler);
+    m_carry.clear();
+    if (failed)
+      return false;
+  }
+
+  const auto it = std::search(input.begin() + pos, input.end(), m_searcher);
+  if (it != input.end())
+  {
+    const size_t p = it - input.begin();
+    failed = !emit(input.substr(pos, p - pos), handler);
+    pos = p + m_delimiter.size();
+    return true;
+  }
+
+  const size_t tail = std::min(keep, input.size() - pos);
+  failed = !emit(input.substr(pos, input.size() - pos - tail), handler);
+  m_carry.assign(input.substr(input.size() - tail));
+  pos = input.size();
+  return false;
+}
+
+MultipartParser::Result MultipartParser::feed(std::string_view input, Handler& handler)
+{
+  size_t pos = 0;
+  while (true)
+  {
+    switch (m_state)
+    {
+      case PREAMBLE:
+      case DATA:
+      {
+        bool failed = false;
+        const bool found = findDelimiter(input, pos, handler, failed);
+        if (failed)
+          return INVALID;
+        if (!found)
+          return INCOMPLETE;
+        if (m_state == DATA && !handler.onPartEnd())
+          return INVALID;
+        m_state = DELIMITER_END;
+        break;
+      }
+
+      case DELIMITER_END:
+      {
+        //"--" closes the body, CRLF starts the next part. Padding before CRLF is allowed
+        if (pos >= input.size())
+          return INCOMPLETE;
+        const char c = input[pos++];
+        if (c == '-')
+          m_state = DELIMITER_DASH;
+        else if (c == '\r')
+          m_state = DELIMITER_LF;
+        else if (c != ' ' && c != '\t')
+          return INVALID;
+        break;
+      }
+
+      case DELIMITER_DASH:
+        if (pos >= input.size())
+          return INCOMPLETE;
+        if (input[pos++] != '-')
+          return INVALID;
+        m_state = DONE;
+        break;
+
+      case DELIMITER_LF:
+        if (pos >= input.size())
+          return INCOMPLETE;
+        if (input[pos++] != '\n')
+          return INVALID;
+        m_state = HEADERS;
+        break;
+
+      case HEADERS:
+      {
+        //header block ends with an empty line. Part without headers starts with it
+        std::string_view block = input.substr(pos);
+        size_t used = 0; // bytes of 'input' taken by the block and the empty line
+        if (!m_headers.empty() || (block.substr(0, 2) != "\r\n" && block.find("\r\n\r\n") == std::string_view::npos))
+        {
+          //block is split between inputs
+          const size_t old = m_headers.size();
+          m_headers.append(block);
+          size_t end = m_headers.compare(0, 2, "\r\n") == 0 ? 0 : m_headers.find("\r\n\r\n", old < 3 ? 0 : old - 3);
+          if (end == std::string::npos)
+          {
+            if (m_headers.size() > m_maxHeaderSize)
+              return INVALID;
+            return INCOMPLETE;
+          }
+          block = std::string_view(m_headers).substr(0, end);
+          used = (end == 0 ? 2 : end + 4) - old;
+        } else {
+          const size_t end = block.substr(0, 2) == "\r\n" ? 0 : block.find("\r\n\r\n");
+          block = block.substr(0, end);
+          used = end == 0 ? 2 : end + 4;
+        }
+
+        if (block.size() > m_maxHeaderSize || !handler.onPartBegin(block))
+          return INVALID;
+        pos += used;
+        m_headers.clear();
+        m_state = DATA;
+        break;
+      }
+
+      case DONE:
+        return COMPLETE; // epilogue is ignored
+    }
+  }
+}
+
+std::string_view getHeaderParam(std::string_view value, std::string_view name)
+{
+  size_t pos = value.find(';');
+  while (pos != std::string_view::npos)
+  {
+    const size_t eq = value.find('=', pos+1);
+    if (eq == std::string_view::npos)
+      return {};
+
+    const std::string_view key = trimView(value.substr(pos+1, eq-pos-1));
+    std::string_view param;
+    size_t start = eq+1;
+    while (start < value.size() && (value[start] == ' ' || value[start] == '\t'))
+      start++;
+
+    if (start < value.size() && value[start] == '"')
+    {
+      const size_t close = value.find('"', start+1);
+      if (close == std::string_view::npos)
+        return {};
+      param = value.substr(start+1, close-start-1);
+      pos = value.find(';', close);
+    } else {
+      pos = value.find(';', start);
+      param = trimView(value.substr(start, pos == std::string_view::npos ? std::string_view::npos : pos-start));
+    }
+
+    if (equalsIgnoreCase(key, name))
+      return param;
+  }
+  return {};
+}
+
+std::string_view getBoundary(std::string_view contentType)
+{
+  const std::string_view boundary = getHeaderParam(contentType, "boundary");
+  if (boundary.size() > 70) // RFC 2046 limit
+    return {};
+  return boundary;
+}
+
+bool parsePartHeaders(std::string_view block, std::vector<std::pair<std::string_view, std::string_view>>& headers)
+{
+  size_t pos = 0;
+  while (pos < block.size())
+  {
+    size_t end = block.find("\r\n", pos);
+    if (end == std::string_view::npos)
+      end = block.size();
+
+    const std::string_view line = block.substr(pos, end-pos);
+    const size_t colon = line.find(':');
+    if (colon == std::string_view::npos || colon == 0)
+      return false;
+
+    headers.emplace_back(line.substr(0, colon), trimView(line.substr(colon+1)));
+    pos = end + 2;
+  }
+  return true;
+}
+
+//fills part description from its header block. Views point into 'block'
+static bool describePart(std::string_view block, FormPart& part)
+{
+  if (!parsePartHeaders(block, part.headers))
+    return false;
+
+  const std::string_view disposition = part.getHeader("Content-Disposition");
+  part.name = getHeaderParam(disposition, "name");
+  part.filename = getHeaderParam(disposition, "filename");
+  part.contentType = part.getHeader("Content-Type");
+  return true;
+}
+
+//collects parts of a body which is fed at once. Everything is a view into the body
+class PartCollector : public MultipartParser::Handler
+{
+public:
+  explicit PartCollector(std::vector<FormPart>& parts)
+  : m_parts(parts)
+  {
+  }
+
+  bool onPartBegin(std::string_view headers) override
+  {
+    m_part = FormPart();
+    return describePart(headers, m_part);
+  }
+
+  bool onPartData(std::string_view data) override
+  {
+    if (m_part.data.empty())
+      m_part.data = data;
+    else if (m_part.data.data() + m_part.data.size() == data.data())
+      m_part.data = std::string_view(m_part.data.data(), m_part.data.size() + data.size());
+    else
+      return false; // body was not fed at once
+    return true;
+  }
+
+  bool onPartEnd() override
+  {
+    m_part.size = m_part.data.size();
+    m_parts.push_back(std::move(m_part));
+    return true;
+  }
+
+private:
+  std::vector<FormPart>& m_parts;
+  FormPart m_part;
+};
+
+//collects parts of a streamed body. Every part owns a copy of its bytes, large files go to temp files
+class SpillingCollector : public MultipartParser::Handler
+{
+public:
+  SpillingCollector(std::vector<FormPart>& parts, size_t spillSize)
+  : m_parts(parts), m_spillSize(spillSize), m_blockSize(0), m_size(0), m_isFile(false)
+  {
+  }
+
+  bool onPartBegin(std::string_view headers) override
+  {
+    FormPart part;
+    if (!describePart(headers, part))
+      return false;
+
+    m_storage.assign(headers);
+    m_blockSize = headers.size();
+    m_size = 0;
+    m_isFile = !part.filename.empty();
+    m_file.reset();
+    return true;
+  }
+
+  bool onPartData(std::string_view data) override
+  {
+    m_size += data.size();
+    if (m_file)
+      return m_file->write(data);
+
+    if (m_isFile && m_size > m_spillSize)
+    {
+      m_file = std::make_shared<TempFile>();
+      if (!m_file->write(std::string_view(m_storage).substr(m_blockSize)) || !m_file->write(data))
+        return false;
+      m_storage.resize(m_blockSize);
+      return true;
+    }
+
+    m_storage.append(data);
+    return true;
+  }
+
+  bool onPartEnd() override
+  {
+    if (m_file && !m_file->close())
+      return false;
+
+    auto storage = std::make_shared<const std::string>(std::move(m_storage));
+    m_storage = std::string();
+
+    FormPart part;
+    describePart(std::string_view(*storage).substr(0, m_blockSize), part);
+    if (!m_file)
+      part.data = std::string_view(*storage).substr(m_blockSize);
+    part.size = m_size;
+    part.file = std::move(m_file);
+    part.storage = std::move(storage);
+    m_parts.push_back(std::move(part));
+    return true;
+  }
+
+private:
+  std::vector<FormPart>& m_parts;
+  const size_t m_spillSize;
+  std::string m_storage; //header block followed by the content
+  size_t m_blockSize;
+  size_t m_size;
+  bool m_isFile;
+  std::shared_ptr<TempFile> m_file;
+};
+
+bool parseMultipart(std::string_view body, std::string_view boundary, std::vector<FormPart>& parts)
+{
+  if (boundary.empty())
+    return false;
+
+  MultipartParser parser(boundary);
+  PartCollector collector(parts);
+  return parser.feed(body, collector) == MultipartParser::COMPLETE;
+}
+
+bool readMultipart(BodyReader& body, std::string_view boundary, std::vector<FormPart>& parts, size_t spillSize)
+{
+  if (boundary.empty())
+    return false;
+
+  MultipartParser parser(boundary);
+  SpillingCollector collector(parts, spillSize);
+  std::string chunk;
+  while (body.readChunk(chunk))
+  {
+    const MultipartParser::Result result = parser.feed(chunk, collector);
+    if (result == MultipartParser::INVALID)
+      return false;
+
+    if (result == MultipartParser::COMPLETE)
+    {
+      //epilogue is read out, so the connection can be kept alive
+      while (body.readChunk(chunk));
+      return !body.hasFailed();
+    }
+  }
+  return false;
+}
+
+}
@@ -0,0 +1,98 @@
+#include "../include/Output.h"
+
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#elif _WIN32
+#include <io.h>
+#endif
+
+namespace rweb
+{
+
+std::shared_ptr<const OpenFile> OpenFile::open(const std::string& path)
+{
+#ifdef __linux__
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return nullptr;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+  {
+    ::close(fd);
+    return nullptr;
+  }
+  const long nanoseconds = st.st_mtim.tv_nsec;
+#elif _WIN32
+  const int fd = _open(path.c_str(), _O_RDONLY | _O_BINARY);
+  if (fd < 0)
+    return nullptr;
+
+  struct _stat64 st;
+  if (_fstat64(fd, &st) != 0 || !(st.st_mode & _S_IFREG))
+  {
+    _close(fd);
+    return nullptr;
+  }
+  const long nanoseconds = 0;
+#endif
+
+  return std::shared_ptr<const OpenFile>(new OpenFile(fd, st.st_size, st.st_mtime, nanoseconds));
+}
+
+OpenFile::OpenFile(int fd, size_t size, int64_t modified, long modifiedNanoseconds)
+  : m_fd(fd), m_size(size), m_modified(modified), m_modifiedNanoseconds(modifiedNanoseconds)
+{
+}
+
+OpenFile::~OpenFile()
+{
+#ifdef __linux__
+  ::close(m_fd);
+#elif _WIN32
+  _close(m_fd);
+#endif
+}
+
+int OpenFile::getFd() const
+{
+  return m_fd;
+}
+
+size_t OpenFile::getSize() const
+{
+  return m_size;
+}
+
+int64_t OpenFile::getModifiedTime() const
+{
+  return m_modified;
+}
+
+long OpenFile::getModifiedNanoseconds() const
+{
+  return m_modifiedNanoseconds;
+}
+
+bool OpenFile::read(std::string& data) const
+{
+  data.resize(m_size);
+  size_t done = 0;
+  while (done < m_size)
+  {
+#ifdef __linux__
+    const ssize_t n = pread(m_fd, data.data() + done, m_size - done, done);
+#elif _WIN32
+    const int n = _read(m_fd, data.data() + done, m_size - done);
+#endif
+    if (n <= 0) // error or the file got shorter
+      return false;
+    done += n;
+  }
+  return true;
+}
+
+}
@@ -9,35 +9,214 @@
 #include <fstream>
 #include <sstream>
 #include <cstdio>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <charconv>
+#include <algorithm>
 
 #include "Socket.h"
+#include "EventLoop.h"
+#include "ResponceWriter.h"
+#include "HTTPParser.h"
+#include "Router.h"
+#include "RouteTable.h"
+#include "ResourceCache.h"
+#include "FileWatcher.h"
+#include "Compression.h"
 #include "HTMLTemplate.h"
 #include "Utility.h"
 
 #ifdef __linux__
 #include <signal.h>
+#include <unistd.h>
 #endif
 
 namespace rweb
 {
 static std::string resourcePath = "";
 static std::string execPath = "";
-static std::unordered_map<std::string, HTTPCallback> serverPaths;
-static std::unordered_map<std::string, HTTPCallback> serverSpecialPaths;
+
+//callback of a route. Only one of them is set
+struct Route
+{
+  HTTPCallback callback = nullptr;
+  HTTPStreamCallback streamCallback = nullptr;
+
+  bool isSet() const
+  {
+    return callback || streamCallback;
+  }
+};
+
+//callbacks of one path
+struct RouteMethods
+{
+  Route methods[ROUTE_METHOD_COUNT];
+  Route any; // added without a method
+
+  //returns callback for 'method'. HEAD uses GET callback. nullptr if the method is not allowed
+  const Route* get(std::string_view method) const
+  {
+    const int index = getRouteMethodIndex(method);
+    if (index >= 0 && methods[index].isSet())
+      return &methods[index];
+    if (method == "HEAD" && methods[0].isSet())
+      return &methods[0];
+    if (any.isSet())
+      return &any;
+    return nullptr;
+  }
+
+  //value of the Allow header. OPTIONS is always answered
+  std::string getAllowed() const
+  {
+    std::string res;
+    for (int i=0;i<ROUTE_METHOD_COUNT;++i)
+    {
+      const bool allowed = any.isSet() || methods[i].isSet() || (i == 1 && methods[0].isSet()) || i == ROUTE_METHOD_COUNT-1;
+      if (!allowed)
+        continue;
+      if (!res.empty())
+        res += ", ";
+      res += ROUTE_METHODS[i];
+    }
+    return res;
+  }
+};
+
+static std::unordered_map<std::string, RouteMethods> serverPaths;
+static std::unordered_map<std::string, RouteMethods> serverSpecialPaths;
 static std::unordered_map<std::string, std::pair<std::string, std::string>> serverResources;
 static std::unordered_map<int, HTTPCallback> errorHandlers;
 static std::unordered_map<std::string, std::pair<std::string, std::string>> serverDynamicResources;
+
+//what a router value points to. Only one of them is set
+struct RouteTarget
+{
+  const RouteMethods* route = nullptr;
+  const std::pair<std::string, std::string>* resource = nullptr; // file path, content type
+};
+
+static RouteTableView serverRouteTable; // compile-time routes
+
+//immutable copy of the maps above with the router built from them. Requests only read snapshots,
+//changes of a running server publish a new one
+struct Registry
+{
+  std::unordered_map<std::string, RouteMethods> paths;
+  std::unordered_map<std::string, RouteMethods> specialPaths;
+  std::unordered_map<std::string, std::pair<std::string, std::string>> resources;
+  std::unordered_map<std::string, std::pair<std::string, std::string>> dynamicResources;
+  std::unordered_map<int, HTTPCallback> errorHandlers;
+  RouteTableView staticRoutes; // checked before the router
+  Router router;
+  std::vector<RouteTarget> targets; // indexed by router values
+};
+
+static std::mutex registryMutex; // guards the maps above and publishing of snapshots
+static std::shared_ptr<const Registry> registry; // current snapshot. Accessed with std::atomic_load/atomic_store only.
+                                                // Requests keep the snapshot they started with, it is freed after the last of them
+static bool registryLive = false; // server is running -> publish every change
+static int registryUpdates = 0; // running updateRoutes calls. Changes are published when they end
 static std::unordered_map<unsigned long long, Session> sessions;
 static unsigned long long nextSessionID = 1; // 0 is invalid!
 static int serverPort = 4221;
 static bool serverDebugMode = false;
 static bool serverProfiling = false;
-static bool serverCompression = false; //not supported yet
-static bool shouldClose = false;
+static bool serverCompression = false; // on-the-fly compression of route responces
+static int compressionLevel = 6;
+static size_t compressionThreshold = 1024; // smaller bodies are sent as they are
+static std::atomic<bool> shouldClose{false};
 static bool initialized = false;
 static std::shared_ptr<Socket> serverSocket;
 static LogLevel serverLogLevel;
 static int maxKeepAliveRequests = 200;
+static int serverTimeout = 20; // keep-alive timeout in seconds
+static unsigned int workerThreads = 0; // 0 - one per core
+static size_t workerQueueDepth = 1024;
+static bool serverReusePort = false;
+static size_t maxBodySize = 16 * 1024 * 1024; // 0 - unlimited
+static ResourceCache resourceCache(32 * 1024 * 1024); // files of static and dynamic resources
+static bool serverWatchFiles = true;
+static bool serverTemplateCache = true; // compiled template files are kept between requests
+
+//returns current snapshot. Empty one before startServer. Keep the pointer while using anything of the snapshot
+static std::shared_ptr<const Registry> getRegistry()
+{
+  static const std::shared_ptr<const Registry> empty = std::make_shared<const Registry>();
+  std::shared_ptr<const Registry> res = std::atomic_load(&registry);
+  return res ? res : empty;
+}
+
+//builds a snapshot from the maps and makes it current. Must be called with registryMutex locked
+static void publishRegistry()
+{
+  auto next = std::make_shared<Registry>();
+  next->paths = serverPaths;
+  next->specialPaths = serverSpecialPaths;
+  next->resources = serverResources;
+  next->dynamicResources = serverDynamicResources;
+  next->errorHandlers = errorHandlers;
+  next->staticRoutes = serverRouteTable;
+
+  //earlier entries win: routes before resources, exact paths before paths with args
+  Router& router = next->router;
+  std::vector<RouteTarget>& targets = next->targets;
+  for (auto& it : next->paths)
+  {
+    if (router.add(it.first, targets.size(), false))
+      targets.push_back(RouteTarget{&it.second, nullptr});
+  }
+  for (auto& it : next->resources)
+  {
+    if (router.add(it.first, targets.size(), false))
+      targets.push_back(RouteTarget{nullptr, &it.second});
+  }
+  for (auto& it : next->specialPaths)
+  {
+    if (router.add(it.first, targets.size()))
+      targets.push_back(RouteTarget{&it.second, nullptr});
+  }
+  for (auto& it : next->dynamicResources)
+  {
+    if (router.addPrefix(it.first, targets.size()))
+      targets.push_back(RouteTarget{nullptr, &it.second});
+  }
+
+  std::atomic_store(&registry, std::shared_ptr<const Registry>(std::move(next)));
+}
+
+//publishes a change of the maps if the server is running. Must be called with registryMutex locked
+static void onRegistryChange()
+{
+  if (registryLive && registryUpdates == 0)
+    publishRegistry();
+}
+
+//drops the current snapshot. It is freed when the last request using it ends
+static void releaseRegistries()
+{
+  std::lock_guard<std::mutex> lock(registryMutex);
+  registryLive = false;
+  std::atomic_store(&registry, std::shared_ptr<const Registry>());
+}
+
+//removes routes, resources and sessions after the server is closed
+static void clearServerState()
+{
+  {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    serverPaths.clear();
+    serverSpecialPaths.clear();
+    serverResources.clear();
+    errorHandlers.clear();
+    serverDynamicResources.clear();
+    serverRouteTable = RouteTableView{};
+  }
+  sessions.clear();
+  std::cout << colorize(NC);
+}
 
 // Initialize default values
 bool Debug::showConnectionLifetime = false;
@@ -160,106 +339,181 @@ std::string describeError()
   return std::to_string(errno);
 }
 
-static const Request parseRequest(const std::string request)
+std::string_view Request::getHeader(std::string_view name) const
 {
-  Request r;
-  std::string str = request;
-  if (Debug::outputRequests)
-    std::cout << "[DEBUG] REQUEST:\n" << request << "\n[DEBUG] REQUEST END\n";
-  std::size_t pos;
+  for (auto& h : headers)
+  {
+    if (equalsIgnoreCase(h.first, name))
+      return h.second;
+  }
+  return std::string_view{};
+}
 
-  //method
-  pos = str.find(" ");
-  r.method = str.substr(0, pos);
-  str = str.substr(pos+1);
+std::map<std::string, std::string> Request::getHeaders() const
+{
+  std::map<std::string, std::string> res;
+  for (auto& h : headers)
+    res.emplace(h.first, h.second);
+  return res;
+}
 
-  //path
-  pos = str.find(" ");
-  r.path = str.substr(0, pos);
-  str = str.substr(pos+1);
+//decodes only if there is something to decode
+static std::string decodeQueryPart(std::string_view part)
+{
+  if (part.find_first_of("%+") == std::string_view::npos)
+    return std::string(part);
+  return urlDecode(part);
+}
 
-  //protocol
-  pos = str.find("\r\n");
-  if (pos == std::string::npos)
+//calls 'f(name, value)' with raw parts of every query parameter until it returns true
+template<typename F>
+static void forEachQueryParam(std::string_view query, F f)
+{
+  while (!query.empty())
   {
-    r.isValid = false;
-    return r;
+    const size_t end = query.find('&');
+    const std::string_view param = query.substr(0, end);
+    const size_t eq = param.find('=');
+    if (!param.empty() && f(param.substr(0, eq), eq == std::string_view::npos ? std::string_view{} : param.substr(eq+1)))
+      return;
+    if (end == std::string_view::npos)
+      return;
+    query.remove_prefix(end+1);
   }
-  r.protocol = str.substr(0, pos);
-  str = str.substr(pos+1);
+}
 
-  //headers
-  pos = str.find_first_not_of("\r\n");
-  if (pos != std::string::npos)
-  {
-    std::size_t newPos = str.find("\r\n\r\n", pos);
-    if (newPos == std::string::npos)
-    {
-      r.isValid = false;
-      return r;
-    }
+std::optional<std::string> Request::getQueryParam(std::string_view key) const
+{
+  std::optional<std::string> res;
+  forEachQueryParam(query, [&](std::string_view name, std::string_view value){
+    //most names are not encoded, compare them as is
+    const bool match = name.find_first_of("%+") == std::string_view::npos ? name == key : urlDecode(name) == key;
+    if (match)
+      res = decodeQueryPart(value);
+    return match;
+  });
+  return res;
+}
 
-    std::string headerSection = str.substr(pos, newPos);
-    std::vector<std::string> lines = splitByWord(headerSection, "\r\n", -1, true);
-    for (auto& l : lines)
-    {
-      if (l.empty())
-        continue;
+std::map<std::string, std::string> Request::getQueryParams() const
+{
+  std::map<std::string, std::string> res;
+  forEachQueryParam(query, [&](std::string_view name, std::string_view value){
+    res.emplace(decodeQueryPart(name), decodeQueryPart(value));
+    return false;
+  });
+  return res;
+}
 
-      std::vector<std::string> line = split(l, ":", 1, true);
-      if (line.size() != 2)
-      {
-        r.isValid = false;
-        return r;
-      }
-      r.headers.emplace(line[0], line[1]);
-    }
+int64_t Request::getIntArg(size_t index) const
+{
+  if (index >= args.size() || argValues[index].type != ArgType::INT)
+    return 0;
+  return argValues[index].i;
+}
+
+uint64_t Request::getUintArg(size_t index) const
+{
+  if (index >= args.size() || argValues[index].type != ArgType::UINT)
+    return 0;
+  return argValues[index].u;
+}
+
+std::array<uint8_t, 16> Request::getUUIDArg(size_t index) const
+{
+  if (index >= args.size() || argValues[index].type != ArgType::UUID)
+    return std::array<uint8_t, 16>{};
+  return argValues[index].uuid;
+}
+
+//path with the query. Used to send the client back to the same URL
+static std::string getTarget(const Request& r)
+{
+  if (r.query.empty())
+    return r.path;
+  return r.path + "?" + std::string(r.query);
+}
+
+//builds request from the parsed head. Header views point into 'raw', body is everything after the head
+//'streaming' - request of a streaming route. Its body is not a part of 'raw' and is not parsed
+static Request parseRequest(const std::shared_ptr<const std::string>& raw, const RequestParser& head, const bool streaming=false)
+{
+  Request r;
+  r.raw = raw;
+  const std::string_view str = *raw;
+  if (Debug::outputRequests)
+    std::cout << "[DEBUG] REQUEST:\n" << str << "\n[DEBUG] REQUEST END\n";
+
+  if (head.getResult() != RequestParser::COMPLETE)
+  {
+    r.isValid = false;
+    return r;
   }
 
-  if (r.method == "GET")
+  r.method = head.method.in(str);
+  //routes are matched by the bare path, the query is decoded on demand
+  const std::string_view target = head.target.in(str);
+  const size_t queryStart = target.find('?');
+  r.path = target.substr(0, queryStart);
+  if (queryStart != std::string_view::npos)
+    r.query = target.substr(queryStart+1);
+  r.protocol = head.protocol.in(str);
+
+  //headers
+  r.headers.reserve(head.headers.size());
+  for (auto& h : head.headers)
+    r.headers.emplace_back(h.first.in(str), h.second.in(str));
+
+  if (r.method == "GET" || r.method == "HEAD" || r.method == "DELETE" || r.method == "OPTIONS")
   {
     r.isValid = true;
-  } else if (r.method == "POST")
+  } else if (r.method == "POST" || r.method == "PUT" || r.method == "PATCH")
   {
-    std::size_t pos1 = str.find("Content-Type:")+13;
-    if (pos1 == std::string::npos)
+    std::string_view contentType = r.getHeader("Content-Type");
+    if (contentType.empty() && !streaming)
     {
       r.isValid = false;
       return r;
-    } else {
-      std::size_t pos2 = str.find_first_of("\r\n;", pos1);
-      if (pos2 == std::string::npos)
-      {
-        r.isValid = false;
-        return r;
-      }
+    }
 
-      r.contentType = trim(str.substr(pos1, pos2-pos1));
+    //parameters (charset, boundary...) are not a part of the type
+    r.contentType = trim(std::string(contentType.substr(0, contentType.find(';'))));
 
-      pos1 = str.find_last_of("\n")+1;
-      std::string body = str.substr(pos1);
+    const std::string_view body = str.substr(head.getHeadSize());
 
-      if (r.contentType == MIME::FORMURLENCODED)
-      {
-        r.isValid = true;
-        auto v = split(body, "&");
-        for (auto it: v)
-        {
-          std::size_t pos = it.find_first_of("=");
-          r.body.emplace(trim(urlDecode(it.substr(0, pos))), trim(urlDecode(it.substr(pos+1))));
-        }
-      } else if (r.contentType == MIME::PLAINTEXT)
+    if (streaming)
+    {
+      //any body is accepted, the route reads it itself
+      r.isValid = true;
+    } else if (r.contentType == MIME::FORMURLENCODED)
+    {
+      r.isValid = true;
+      auto v = split(std::string(body), "&");
+      for (auto it: v)
       {
-        r.isValid = true;
-        r.body.emplace("text", trim(body));
-      } else if (r.contentType == MIME::JSON)
+        std::size_t pos = it.find_first_of("=");
+        r.body.emplace(trim(urlDecode(it.substr(0, pos))), trim(urlDecode(it.substr(pos+1))));
+      }
+    } else if (r.contentType == MIME::PLAINTEXT)
+    {
+      r.isValid = true;
+      r.body.emplace("text", trim(std::string(body)));
+    } else if (r.contentType == MIME::JSON)
+    {
+      r.isValid = true;
+      r.body.emplace("json", trim(std::string(body)));
+    } else if (r.contentType == MIME::MULTIPART)
+    {
+      //parts are views into 'raw'. Regular fields are copied to 'body' for the old handlers
+      r.isValid = parseMultipart(body, getBoundary(contentType), r.parts);
+      for (auto& part : r.parts)
       {
-        r.isValid = true;
-        r.body.emplace("json", trim(body));
-      } else {
-        r.isValid = false;
-        return r;
+        if (part.filename.empty())
+          r.body.emplace(part.name, part.data);
       }
+    } else {
+      r.isValid = false;
+      return r;
     }
 
   } else {
@@ -267,33 +521,25 @@ static const Request parseRequest(const std::string request)
     return r;
   }
 
+  for (auto& h : r.headers)
   {
-    size_t lastfnd = str.find("Cookie: ")+8;
-    while (lastfnd != std::string::npos+8)
-    {
-      size_t end = str.find_first_of("\n", lastfnd);
-      if (end == std::string::npos)
-      {
-        r.isValid = false;
-        return r;
-      }
+    if (!equalsIgnoreCase(h.first, "Cookie"))
+      continue;
 
-      auto v = split(trim(str.substr(lastfnd, end-lastfnd)), ";");
-      for (auto c: v)
-      {
-        size_t start = c.find_first_of("=");
-        r.cookies.emplace(c.substr(0, start), c.substr(start+1));
-      }
-      lastfnd = str.find("Cookie: ", lastfnd)+8;
+    auto v = split(std::string(h.second), ";");
+    for (auto c: v)
+    {
+      size_t start = c.find_first_of("=");
+      r.cookies.emplace(c.substr(0, start), c.substr(start+1));
     }
   }
 
   {
     bool keepAlive = true; // Persistent connections are enabled by default in HTTP/1.1
-    auto it = r.headers.find("Connection");
-    if (it != r.headers.end())
+    std::string_view connection = r.getHeader("Connection");
+    if (!connection.empty())
     {
-      keepAlive = toLower(it->second) == "keep-alive";
+      keepAlive = equalsIgnoreCase(connection, "keep-alive");
     }
     r.keepAlive = Debug::disableKeepAlive ? false : keepAlive;
   }
@@ -301,6 +547,17 @@ static const Request parseRequest(const std::string request)
   return r;
 }
 
+#ifdef _WIN32
+static Request parseRequest(const std::string& request)
+{
+  auto raw = std::make_shared<const std::string>(request);
+  RequestParser head(SERVER_BUFLEN);
+  head.parse(*raw);
+  std::string_view target = head.target.in(*raw);
+  return parseRequest(raw, head, isStreamRoute(head.method.in(*raw), target.substr(0, target.find('?'))));
+}
+#endif
+
 std::string getResourcePath()
 {
   return resourcePath;
@@ -309,9 +566,11 @@ std::string getResourcePath()
 void setResourcePath(const std::string resPath)
 {
   resourcePath = resPath;
+  clearTemplateCache(); // keys are relative to the directory
 }
 
-void addRoute(const std::string& path, const HTTPCallback callback)
+//'method' is an index in ROUTE_METHODS, -1 adds the route for any method
+static void registerRoute(const std::string& path, const int method, const Route& route)
 {
   std::string urlPath = path;
 
@@ -403,6 +662,17 @@ void addRoute(const std::string& path, const HTTPCallback callback)
             std::cout << "[RWEB] Block: '" << it << "'. Should be '" << it.substr(pos, pos2-pos+1) << "'" << colorize(NC) << "\n";
           }
         }
+
+        ArgType type;
+        if (!warn && !Router::getArgType(it, type))
+        {
+          warn = true;
+          if (getLogLevel() <= WARNING)
+          {
+            std::cout << colorize(YELLOW) << "[RWEB] Warning! Route arg has unknown type!\n";
+            std::cout << "[RWEB] Block: '" << it << "'. Known types are int, uint, uuid and string" << colorize(NC) << "\n";
+          }
+        }
       }
     }
     if (warn) // Ignores log level for safety
@@ -416,10 +686,101 @@ void addRoute(const std::string& path, const HTTPCallback callback)
     std::cout << colorize(NC) << "\n";
   }
 
-  if (spec && !warn)
-    serverSpecialPaths.emplace(urlPath, callback);
-  else
-    serverPaths.emplace(urlPath, callback);
+  std::lock_guard<std::mutex> lock(registryMutex);
+  RouteMethods& methods = (spec && !warn) ? serverSpecialPaths[urlPath] : serverPaths[urlPath];
+  Route& slot = method < 0 ? methods.any : methods.methods[method];
+  if (!slot.isSet()) // the first added callback is used
+  {
+    slot = route;
+    onRegistryChange();
+  }
+}
+
+//returns index of 'method' in ROUTE_METHODS. -1 (with a warning) if it is not supported
+static int getRouteMethod(const std::string& method, const std::string& path)
+{
+  const int index = getRouteMethodIndex(toUpper(method));
+  if (index < 0 && getLogLevel() <= WARNING)
+  {
+    std::cout << colorize(YELLOW) << "[RWEB] Warning! Method '" << method << "' is not supported! Route is ignored.\n";
+    std::cout << "[RWEB] Path: '" << path << "'" << colorize(NC) << "\n";
+  }
+  return index;
+}
+
+void addRoute(const std::string& path, const HTTPCallback callback)
+{
+  registerRoute(path, -1, Route{callback, nullptr});
+}
+
+void addRoute(const std::string& path, const HTTPStreamCallback callback)
+{
+  registerRoute(path, -1, Route{nullptr, callback});
+}
+
+void addRoute(const std::string& method, const std::string& path, const HTTPCallback callback)
+{
+  const int index = getRouteMethod(method, path);
+  if (index >= 0)
+    registerRoute(path, index, Route{callback, nullptr});
+}
+
+void addRoute(const std::string& method, const std::string& path, const HTTPStreamCallback callback)
+{
+  const int index = getRouteMethod(method, path);
+  if (index >= 0)
+    registerRoute(path, index, Route{nullptr, callback});
+}
+
+bool readMultipart(const Request& r, BodyReader& body, std::vector<FormPart>& parts, const size_t spillSize)
+{
+  return readMultipart(body, getBoundary(r.getHeader("Content-Type")), parts, spillSize);
+}
+
+void setRouteTable(const RouteTableView& table)
+{
+  std::lock_guard<std::mutex> lock(registryMutex);
+  serverRouteTable = table;
+  onRegistryChange();
+}
+
+void updateRoutes(const std::function<void()>& update)
+{
+  {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    registryUpdates++;
+  }
+
+  //changes are published even if 'update' throws, later changes would never be published otherwise
+  struct UpdateEnd
+  {
+    ~UpdateEnd()
+    {
+      std::lock_guard<std::mutex> lock(registryMutex);
+      registryUpdates--;
+      onRegistryChange();
+    }
+  } updateEnd;
+
+  update();
+}
+
+bool isStreamRoute(std::string_view method, std::string_view path)
+{
+  const std::shared_ptr<const Registry> snapshot = getRegistry();
+  const Registry& reg = *snapshot;
+
+  //same precedence as handleClient: paths of the route table are never streamed
+  const StaticRoute* staticRoute = nullptr;
+  size_t staticCount = 0;
+  if (reg.staticRoutes.find(path, staticRoute, staticCount))
+    return false;
+
+  Router::Match match;
+  if (!reg.router.find(path, match) || !reg.targets[match.value].route)
+    return false;
+  const Route* route = reg.targets[match.value].route->get(method);
+  return route && route->streamCallback;
 }
 
 std::optional<HTTPCallback> getRoute(const std::string& path)
@@ -432,10 +793,14 @@ std::optional<HTTPCallback> getRoute(const std::string& path)
   if (urlPath[0] != '/')
     urlPath = '/' + urlPath;
 
+  std::lock_guard<std::mutex> lock(registryMutex);
   auto it = serverPaths.find(urlPath);
   if (it != serverPaths.end())
   {
-    return it->second;
+    if (it->second.any.callback)
+      return it->second.any.callback;
+    if (it->second.methods[0].callback)
+      return it->second.methods[0].callback; // GET
   }
 
   return std::nullopt;
@@ -447,7 +812,9 @@ void addResource(const std::string& URLpath, const std::string& resourcePath, co
   if (urlPath[0] != '/')
     urlPath = '/' + urlPath;
 
-  serverResources.insert({urlPath, {resourcePath, contentType}});
+  std::lock_guard<std::mutex> lock(registryMutex);
+  if (serverResources.insert({urlPath, {resourcePath, contentType}}).second)
+    onRegistryChange();
 }
 
 void addDynamicResource(const std::string& URLPrefix, const std::string& resourceFolderPrefix, const std::string& contentType)
@@ -470,7 +837,9 @@ void addDynamicResource(const std::string& URLPrefix, const std::string& resourc
     resPrefix = '/' + resPrefix;
   }
 
-  serverDynamicResources.insert({urlPrefix, {resPrefix, contentType}});
+  std::lock_guard<std::mutex> lock(registryMutex);
+  if (serverDynamicResources.insert({urlPrefix, {resPrefix, contentType}}).second)
+    onRegistryChange();
 }
 
 void setErrorHandler(const int code, const HTTPCallback callback)
@@ -478,6 +847,7 @@ void setErrorHandler(const int code, const HTTPCallback callback)
   if (code / 100 == 1 || code / 100 == 2 || code / 100 == 3)
     return;
 
+  std::lock_guard<std::mutex> lock(registryMutex);
   auto it = errorHandlers.find(code);
   if (it != errorHandlers.end())
   {
@@ -486,6 +856,7 @@ void setErrorHandler(const int code, const HTTPCallback callback)
   } else {
     errorHandlers.emplace(code, callback);
   }
+  onRegistryChange();
 }
 
 void setPort(const int port)
@@ -523,6 +894,117 @@ bool getProfilingMode()
   return serverProfiling;
 }
 
+void setWorkerThreads(const unsigned int count)
+{
+  workerThreads = count;
+}
+
+unsigned int getWorkerThreads()
+{
+  return workerThreads;
+}
+
+void setReusePort(const bool enabled)
+{
+  serverReusePort = enabled;
+}
+
+bool getReusePort()
+{
+  return serverReusePort;
+}
+
+void setMaxBodySize(const size_t bytes)
+{
+  maxBodySize = bytes;
+}
+
+size_t getMaxBodySize()
+{
+  return maxBodySize;
+}
+
+void setFileWatching(const bool enabled)
+{
+  serverWatchFiles = enabled;
+}
+
+bool getFileWatching()
+{
+  return serverWatchFiles;
+}
+
+void setTemplateCache(const bool enabled)
+{
+  serverTemplateCache = enabled;
+  clearTemplateCache();
+}
+
+bool getTemplateCache()
+{
+  return serverTemplateCache;
+}
+
+void setResourceCacheSize(const size_t bytes)
+{
+  resourceCache.setCapacity(bytes);
+}
+
+size_t getResourceCacheSize()
+{
+  return resourceCache.getCapacity();
+}
+
+void setCompression(const bool enabled)
+{
+  serverCompression = enabled;
+}
+
+bool getCompression()
+{
+  return serverCompression;
+}
+
+void setCompressionLevel(const int level)
+{
+  compressionLevel = level < 1 ? 1 : (level > 9 ? 9 : level);
+}
+
+int getCompressionLevel()
+{
+  return compressionLevel;
+}
+
+void setCompressionThreshold(const size_t bytes)
+{
+  compressionThreshold = bytes;
+}
+
+size_t getCompressionThreshold()
+{
+  return compressionThreshold;
+}
+
+void setPrecompressed(const bool enabled)
+{
+  resourceCache.setPrecompressed(enabled);
+}
+
+bool getPrecompressed()
+{
+  return resourceCache.getPrecompressed();
+}
+
+void setQueueDepth(const size_t depth)
+{
+  workerQueueDepth = depth;
+}
+
+size_t getQueueDepth()
+{
+  return workerQueueDepth;
+}
+
 const char *colorize(int color) {
 
   if (!initialized)
@@ -586,7 +1068,139 @@ static unsigned long long getEmptySessionID()
   return nextSessionID-1;
 }
 
-static const std::string handleRequest(const HTTPCallback callback, Request& r, const std::string& initialStatus=HTTP_200)
+//calls the route callback. 'body' is the reader of a streaming route (nullptr if the body is already in 'r.raw')
+static HTMLTemplate callRoute(const Route& route, const Request& r, BodyReader* body)
+{
+  if (!route.streamCallback)
+    return route.callback(r);
+
+  if (body)
+    return route.streamCallback(r, *body);
+
+  //whole request is already received (windows server)
+  BodyReader received(0, nullptr);
+  if (r.raw)
+  {
+    const size_t headEnd = r.raw->find("\r\n\r\n");
+    if (headEnd != std::string::npos)
+      received.push(r.raw->substr(headEnd + 4));
+  }
+  received.finish();
+  return route.streamCallback(r, received);
+}
+
+//returns true if Accept-Encoding of the request allows 'coding'. "q=0" forbids it
+static bool acceptsEncoding(const Request& r, std::string_view coding)
+{
+  std::string_view header = r.getHeader("Accept-Encoding");
+  bool wildcard = false;
+  while (!header.empty())
+  {
+    const size_t comma = header.find(',');
+    std::string_view item = header.substr(0, comma);
+    const size_t semicolon = item.find(';');
+    std::string_view name = item.substr(0, semicolon);
+    while (!name.empty() && (name.front() == ' ' || name.front() == '\t'))
+      name.remove_prefix(1);
+    while (!name.empty() && (name.back() == ' ' || name.back() == '\t'))
+      name.remove_suffix(1);
+
+    //q is zero if it has no other digits than '0'
+    bool allowed = true;
+    const size_t q = semicolon == std::string_view::npos ? std::string_view::npos : item.find("q=", semicolon);
+    if (q != std::string_view::npos)
+    {
+      const std::string_view value = item.substr(q + 2);
+      allowed = value.find_first_of("123456789") != std::string_view::npos;
+    }
+
+    if (equalsIgnoreCase(name, coding))
+      return allowed;
+    if (name == "*")
+      wildcard = allowed;
+    if (comma == std::string_view::npos)
+      break;
+    header.remove_prefix(comma + 1);
+  }
+  return wildcard;
+}
+
+//compresses the body of 'temp' if it is allowed and the client accepts gzip or deflate.
+//Returns header lines to add (Content-Encoding, Vary) or an empty string if the body is kept
+static std::string compressBody(const HTMLTemplate& temp, const Request& r, std::string& body)
+{
+  if (!serverCompression || !temp.compress || temp.getHTML().size() < compressionThreshold || !isCompressible(temp.getContentType()))
+    return std::string{};
+
+  //the responce depends on Accept-Encoding even if it is not compressed
+  const std::string vary = "Vary: Accept-Encoding\r\n";
+  ContentCoding coding;
+  if (acceptsEncoding(r, "gzip"))
+    coding = ContentCoding::GZIP;
+  else if (acceptsEncoding(r, "deflate"))
+    coding = ContentCoding::DEFLATE;
+  else
+    return vary;
+
+  if (!compress(temp.getHTML(), coding, compressionLevel, body) || body.size() >= temp.getHTML().size())
+  {
+    body.clear();
+    return vary;
+  }
+  return std::string("Content-Encoding: ") + (coding == ContentCoding::GZIP ? "gzip" : "deflate") + "\r\n" + vary;
+}
+
+//sends the template given to streamJSON through the writer of 'stream' with chunked transfer coding.
+//returns false if nothing is sent (the template can't be rendered, it answers HTTP_500 then)
+static bool streamTemplate(HTMLTemplate& temp, Request& r, ResponceStream& stream)
+{
+  //headers go with the first part
+  std::string part = temp.getStatusResponce() + "Content-Type: " + temp.getContentType() + "\r\nTransfer-Encoding: chunked\r\n"
+    "Connection: " + (r.keepAlive ? "keep-alive" : "close") + "\r\n"
+    "Keep-Alive: timeout=" + std::to_string(serverTimeout) + ", max=" + std::to_string(maxKeepAliveRequests) + "\r\n" +
+    temp.getAllCookieHeaders() + "\r\n";
+  std::shared_ptr<ResponceWriter> writer;
+
+  const bool rendered = temp.renderStream([&](const std::string& data)
+  {
+    if (!writer)
+      writer = stream.open();
+
+    char size[24];
+    const int n = snprintf(size, sizeof(size), "%zx\r\n", data.size());
+    part.append(size, n);
+    part += data;
+    part += "\r\n";
+    const bool ok = writer->write(part);
+    part.clear();
+    return ok;
+  });
+
+  if (!rendered && !writer)
+    return false;
+
+  if (rendered)
+  {
+    if (!writer)
+      writer = stream.open(); // empty page
+    part += "0\r\n\r\n";
+    writer->write(part);
+  } else {
+    //missing last chunk tells the client the responce is incomplete
+    r.keepAlive = false;
+  }
+
+  if (getLogLevel() <= INFO)
+  {
+    std::cout << "[RESPONCE] " << r.method << " -- " << colorize(rendered ? NC : RED) << r.path << colorize(NC) << " -- " <<
+      temp.getStatusResponce().substr(9, temp.getStatusResponce().size()-11) << " -- Streamed " << writer->getBytesWritten() << " bytes";
+  }
+  return true;
+}
+
+//'stream' is set if the responce can be sent while it is produced (see HTMLTemplate::streamJSON)
+static const std::string handleRequest(const Route& route, Request& r, const std::string& initialStatus=HTTP_200, BodyReader* body=nullptr,
+  ResponceStream* stream=nullptr)
 {
   HTMLTemplate temp; 
 
@@ -602,22 +1216,30 @@ static const std::string handleRequest(const HTTPCallback callback, Request& r,
         if (it2 != sessions.end())
         {
           //session is valid -> can continue
-          temp = callback(r);
+          temp = callRoute(route, r, body);
         } else {
-          temp = redirect(r.path, HTTP_303); //redirect
+          temp = redirect(getTarget(r), HTTP_303); //redirect
           temp.setCookie("sessionID", std::to_string(getEmptySessionID()), 0, true); //re-create session
         }
       } catch (std::invalid_argument& e)
       {
-        temp = redirect(r.path, HTTP_303); //redirect
+        temp = redirect(getTarget(r), HTTP_303); //redirect
         temp.setCookie("sessionID", std::to_string(getEmptySessionID()), 0, true); //re-create session
       }
     } else {
-      temp = redirect(r.path, HTTP_303); //redirect
+      temp = redirect(getTarget(r), HTTP_303); //redirect
       temp.setCookie("sessionID", std::to_string(getEmptySessionID()), 0, true); //re-create session
     }
   }
 
+  //streamed templates are rendered while they are sent. Errors are rendered here to reach the error handlers
+  if (temp.isStreamed())
+  {
+    if (stream && temp.getStatusResponce()[9] == '2' && streamTemplate(temp, r, *stream))
+      return std::string{}; // whole responce is written
+    temp.renderStream();
+  }
+
   const std::string code = temp.getStatusResponce().substr(9, 3);
   std::string res = "";
   if (code[0] == '3' && !Debug::disableKeepAliveFix)
@@ -626,9 +1248,12 @@ static const std::string handleRequest(const HTTPCallback callback, Request& r,
     r.keepAlive = false;
   }
 
+  std::string compressed;
   if (!temp.getHTML().empty())
   {
-    res = temp.getStatusResponce() + "Content-Type: " + temp.getContentType() + "\r\nContent-Length: " + std::to_string(temp.getHTML().size()) + "\r\n";
+    const std::string encoding = compressBody(temp, r, compressed);
+    const size_t length = compressed.empty() ? temp.getHTML().size() : compressed.size();
+    res = temp.getStatusResponce() + "Content-Type: " + temp.getContentType() + "\r\n" + encoding + "Content-Length: " + std::to_string(length) + "\r\n";
   } else {
     res = temp.getStatusResponce();
   }
@@ -639,7 +1264,7 @@ static const std::string handleRequest(const HTTPCallback callback, Request& r,
   else
     res += "Connection: close\r\n";
 
-  res += "Keep-Alive: timeout=" + std::to_string(serverSocket->timeout) + ", max=" + std::to_string(maxKeepAliveRequests) + "\r\n";
+  res += "Keep-Alive: timeout=" + std::to_string(serverTimeout) + ", max=" + std::to_string(maxKeepAliveRequests) + "\r\n";
 
   res += temp.getAllCookieHeaders(); // \r\n included
 
@@ -650,16 +1275,18 @@ static const std::string handleRequest(const HTTPCallback callback, Request& r,
 
   //---BODY---
   res += "\r\n";
-  res += temp.getHTML();
+  res += compressed.empty() ? temp.getHTML() : compressed;
 
   if (code[0] != '1' && code[0] != '2' && code[0] != '3')
   {
     if (!temp.ignoreHandlers)
     {
-      auto it = errorHandlers.find(std::stoi(code));
-      if (it != errorHandlers.end())
+      const std::shared_ptr<const Registry> snapshot = getRegistry();
+      const auto& handlers = snapshot->errorHandlers;
+      auto it = handlers.find(std::stoi(code));
+      if (it != handlers.end())
       {
-        return handleRequest(it->second, r, temp.getStatusResponce());
+        return handleRequest(Route{it->second}, r, temp.getStatusResponce());
       }
     }
 
@@ -692,136 +1319,419 @@ static const std::string handleRequest(const HTTPCallback callback, Request& r,
   return res;
 }
 
-static void handleClient(Request r, const SOCKFD newsockfd)
+//answers HTTP_405 (through the error handler if it is set). 'allowed' is the value of the Allow header
+static std::string methodNotAllowed(Request& r, const std::string& allowed)
+{
+  std::string res;
+  const std::shared_ptr<const Registry> snapshot = getRegistry();
+  const auto& handlers = snapshot->errorHandlers;
+  auto it = handlers.find(405);
+  if (it != handlers.end())
+  {
+    res = handleRequest(Route{it->second}, r, HTTP_405);
+  } else {
+    res = HTTP_405 + "Content-Length: 0\r\nConnection: " + (r.keepAlive ? "keep-alive" : "close") + "\r\n"
+      "Keep-Alive: timeout=" + std::to_string(serverTimeout) + ", max=" + std::to_string(maxKeepAliveRequests) + "\r\n\r\n";
+    if (getLogLevel() <= INFO)
+      std::cout << "[RESPONCE] " << r.method << " -- " << colorize(RED) << r.path << colorize(NC) << " -- " << HTTP_405.substr(9, HTTP_405.size()-11);
+  }
+
+  //Allow is required in 405 responces
+  res.insert(res.find("\r\n") + 2, "Allow: " + allowed + "\r\n");
+  return res;
+}
+
+//calls the callback added for the request method. OPTIONS without a callback is answered with the Allow header
+static std::string handleRoute(const RouteMethods& methods, Request& r, BodyReader* body, ResponceStream* stream)
+{
+  const Route* route = methods.get(r.method);
+  if (route)
+    return handleRequest(*route, r, HTTP_200, body, stream);
+
+  if (r.method != "OPTIONS")
+    return methodNotAllowed(r, methods.getAllowed());
+
+  if (getLogLevel() <= INFO)
+    std::cout << "[RESPONCE] " << r.method << " -- " << colorize(NC) << r.path << colorize(NC) << " -- " << HTTP_204.substr(9, HTTP_204.size()-11);
+  return HTTP_204 + "Allow: " + methods.getAllowed() + "\r\nConnection: " + (r.keepAlive ? "keep-alive" : "close") + "\r\n"
+    "Keep-Alive: timeout=" + std::to_string(serverTimeout) + ", max=" + std::to_string(maxKeepAliveRequests) + "\r\n\r\n";
+}
+
+//returns path of a file in the resource directory. Keys of resourceCache have the same form as the paths
+//reported by the file watcher (no double '/' between the directory and 'path')
+static std::string getResourceFile(const std::string& path)
+{
+  std::string res = resourcePath;
+  if (!res.empty() && res.back() == '/')
+    res.pop_back();
+  if (path.empty() || path[0] != '/')
+    res += '/';
+  return res + path;
+}
+
+//called by the file watcher thread when a file in the resource directory changes
+static void onFileChanged(const std::string& path, const bool isDirectory)
+{
+  if (getDebugState() && getLogLevel() <= INFO)
+    std::cout << "[RWEB] File changed: " << path << "\n";
+
+  if (isDirectory) // files inside it are not reported one by one
+    resourceCache.clear();
+  else
+    resourceCache.invalidate(path);
+  clearTemplateCache(); // a changed file may be inlined into other templates with "loadblock"
+}
+
+//returns true if the client has the same version of the file (If-None-Match is preferred over If-Modified-Since)
+static bool isNotModified(const CachedResource& file, const Request& r)
+{
+  std::string_view match = r.getHeader("If-None-Match");
+  if (!match.empty())
+  {
+    //list of ETags. Weak comparison: "W/" prefixes are ignored
+    while (!match.empty())
+    {
+      const size_t comma = match.find(',');
+      std::string_view tag = match.substr(0, comma);
+      while (!tag.empty() && (tag.front() == ' ' || tag.front() == '\t'))
+        tag.remove_prefix(1);
+      while (!tag.empty() && (tag.back() == ' ' || tag.back() == '\t'))
+        tag.remove_suffix(1);
+      if (tag.substr(0, 2) == "W/")
+        tag.remove_prefix(2);
+      if (tag == "*" || tag == file.etag)
+        return true;
+      if (comma == std::string_view::npos)
+        break;
+      match.remove_prefix(comma + 1);
+    }
+    return false;
+  }
+
+  const std::string_view since = r.getHeader("If-Modified-Since");
+  int64_t time;
+  return !since.empty() && parseHTTPDate(since, time) && file.modified <= time;
+}
+
+//byte range of a resource, 'last' is included
+struct ByteRange
+{
+  size_t first;
+  size_t last;
+};
+
+#define MAX_RANGES 16
+
+//parses "bytes=first-last, -suffix, first-" for a file of 'size' bytes. Returns false if the header can't be used
+//(the whole file is sent then). 'ranges' is sorted and merged, it is empty if no range is satisfiable
+static bool parseRanges(std::string_view header, size_t size, std::vector<ByteRange>& ranges)
+{
+  if (header.substr(0, 6) != "bytes=")
+    return false;
+  header.remove_prefix(6);
+
+  //overflowing values make the header unusable as well
+  auto number = [](std::string_view text, size_t& value){
+    auto res = std::from_chars(text.data(), text.data() + text.size(), value);
+    return res.ec == std::errc() && res.ptr == text.data() + text.size();
+  };
+
+  size_t count = 0;
+  while (true)
+  {
+    const size_t comma = header.find(',');
+    std::string_view spec = header.substr(0, comma);
+    while (!spec.empty() && (spec.front() == ' ' || spec.front() == '\t'))
+      spec.remove_prefix(1);
+    while (!spec.empty() && (spec.back() == ' ' || spec.back() == '\t'))
+      spec.remove_suffix(1);
+
+    const size_t dash = spec.find('-');
+    if (dash == std::string_view::npos || ++count > MAX_RANGES)
+      return false;
+    const std::string_view firstText = spec.substr(0, dash), lastText = spec.substr(dash + 1);
+    size_t first = 0, last = 0;
+    if ((!firstText.empty() && !number(firstText, first)) || (!lastText.empty() && !number(lastText, last)))
+      return false;
+
+    if (firstText.empty()) // suffix: last 'last' bytes
+    {
+      if (lastText.empty())
+        return false;
+      if (last > 0 && size > 0)
+        ranges.push_back(ByteRange{size > last ? size - last : 0, size - 1});
+    } else {
+      if (!lastText.empty() && last < first)
+        return false;
+      if (first < size)
+        ranges.push_back(ByteRange{first, lastText.empty() || last >= size ? size - 1 : last});
+    }
+
+    if (comma == std::string_view::npos)
+      break;
+    header.remove_prefix(comma + 1);
+  }
+
+  //overlapping ranges are sent once
+  std::sort(ranges.begin(), ranges.end(), [](const ByteRange& a, const ByteRange& b){return a.first < b.first;});
+  size_t merged = 0;
+  for (size_t i=1;i<ranges.size();++i)
+  {
+    if (ranges[i].first <= ranges[merged].last + 1)
+      ranges[merged].last = std::max(ranges[merged].last, ranges[i].last);
+    else
+      ranges[++merged] = ranges[i];
+  }
+  if (!ranges.empty())
+    ranges.resize(merged + 1);
+  return true;
+}
+
+//returns false if If-Range doesn't match the file (the whole file is sent then)
+static bool rangeApplies(const CachedResource& file, const Request& r)
+{
+  const std::string_view condition = r.getHeader("If-Range");
+  if (condition.empty())
+    return true;
+  if (condition.front() == '"' || condition.substr(0, 2) == "W/")
+    return condition == file.etag; // strong comparison
+  int64_t time;
+  return parseHTTPDate(condition, time) && file.modified == time;
+}
+
+static void logResourceResponce(const Request& r, const std::string& status)
+{
+  if (getLogLevel() <= INFO)
+    std::cout << "[RESPONCE] " << r.method << " -- " << colorize(CYAN) << r.path << colorize(NC) << " -- " << status.substr(9, status.size()-11);
+}
+
+//returns 206 responce with 'ranges' of the file. Several ranges are sent as multipart/byteranges
+static std::string rangeResponce(const CachedResource& file, const Request& r, const std::vector<ByteRange>& ranges, const std::string& connection, std::vector<OutputSegment>* tail)
+{
+  logResourceResponce(r, HTTP_206);
+  const std::string total = "/" + std::to_string(file.size);
+  std::string res = HTTP_206 + file.validators + "Accept-Ranges: bytes\r\n";
+
+  //bytes after a file segment are added to 'tail' too to keep the order
+  bool inTail = false;
+  auto appendData = [&](const std::string& data)
+  {
+    if (!inTail)
+      res += data;
+    else if (tail->back().file)
+      tail->push_back(OutputSegment{data, nullptr, 0, 0});
+    else
+      tail->back().data += data;
+  };
+  auto appendRange = [&](const ByteRange& range)
+  {
+    if (file.file)
+    {
+      tail->push_back(OutputSegment{std::string{}, file.file, range.first, range.last - range.first + 1});
+      inTail = true;
+    } else {
+      appendData(file.data.substr(range.first, range.last - range.first + 1));
+    }
+  };
+
+  if (ranges.size() == 1)
+  {
+    const ByteRange& range = ranges[0];
+    res += "Content-Type: " + file.contentType + "\r\nContent-Range: bytes " + std::to_string(range.first) + "-" + std::to_string(range.last) + total +
+      "\r\nContent-Length: " + std::to_string(range.last - range.first + 1) + "\r\n" + connection;
+    appendRange(range);
+    return res;
+  }
+
+  static thread_local std::mt19937_64 random(std::random_device{}());
+  char boundary[24];
+  snprintf(boundary, sizeof(boundary), "rweb-%016llx", (unsigned long long)random());
+
+  std::vector<std::string> partHeads;
+  partHeads.reserve(ranges.size());
+  size_t length = 0;
+  for (const ByteRange& range : ranges)
+  {
+    partHeads.push_back(std::string("\r\n--") + boundary + "\r\nContent-Type: " + file.contentType + "\r\nContent-Range: bytes " +
+      std::to_string(range.first) + "-" + std::to_string(range.last) + total + "\r\n\r\n");
+    length += partHeads.back().size() + range.last - range.first + 1;
+  }
+  const std::string end = std::string("\r\n--") + boundary + "--\r\n";
+  length += end.size();
+
+  res += std::string("Content-Type: multipart/byteranges; boundary=") + boundary + "\r\nContent-Length: " + std::to_string(length) + "\r\n" + connection;
+  for (size_t i=0;i<ranges.size();++i)
+  {
+    appendData(partHeads[i]);
+    appendRange(ranges[i]);
+  }
+  appendData(end);
+  return res;
+}
+
+//returns the precompressed sibling of the file if the client accepts it. Brotli is preferred
+static const CachedResource& selectEncoding(const CachedResource& file, const Request& r)
+{
+  if (file.brotli && acceptsEncoding(r, "br"))
+    return *file.brotli;
+  if (file.gzip && acceptsEncoding(r, "gzip"))
+    return *file.gzip;
+  return file;
+}
+
+//returns responce with the resource file. The body is not copied for HEAD requests.
+//files which are not in memory are added to 'tail' and sent by the kernel
+static std::string resourceResponce(const CachedResource& file, const Request& r, std::vector<OutputSegment>* tail)
+{
+  const std::string connection = std::string("Connection: ") + (r.keepAlive ? "keep-alive" : "close") + "\r\n" +
+    "Keep-Alive: timeout=" + std::to_string(serverTimeout) + ", max=" + std::to_string(maxKeepAliveRequests) + "\r\n\r\n";
+  const bool head = r.method == "HEAD";
+
+  if (isNotModified(file, r))
+  {
+    logResourceResponce(r, HTTP_304);
+    return HTTP_304 + file.validators + connection;
+  }
+
+  //ranges are used only for GET, other requests get the whole file
+  const std::string_view range = r.getHeader("Range");
+  std::vector<ByteRange> ranges;
+  if (r.method == "GET" && !range.empty() && rangeApplies(file, r) && parseRanges(range, file.size, ranges))
+  {
+    if (ranges.empty())
+    {
+      logResourceResponce(r, HTTP_416);
+      return HTTP_416 + "Content-Range: bytes */" + std::to_string(file.size) + "\r\nContent-Length: 0\r\n" + connection;
+    }
+    return rangeResponce(file, r, ranges, connection, tail);
+  }
+
+  logResourceResponce(r, HTTP_200);
+  std::string res;
+  res.reserve(HTTP_200.size() + file.headers.size() + connection.size() + 64 + (head ? 0 : file.data.size()));
+  res += HTTP_200;
+  res += file.headers;
+  res += "Accept-Ranges: bytes\r\n";
+  res += connection;
+  if (!head && file.file)
+    tail->push_back(OutputSegment{std::string{}, file.file, 0, file.size});
+  else if (!head)
+    res += file.data;
+  return res;
+}
+
+//returns full responce for the request. Updates 'r.keepAlive' if the connection must be closed.
+//'body' is set for streaming routes
+//'tail' - parts sent after the returned responce (see OutputSegment). Files are read into the responce if it is not set.
+//'stream' sends responces of streamed templates (see HTMLTemplate::streamJSON). They are rendered whole without it
+static std::string handleClient(Request& r, BodyReader* body=nullptr, std::vector<OutputSegment>* tail=nullptr, ResponceStream* stream=nullptr)
 {
   const auto startTime = std::chrono::high_resolution_clock::now(); //for profiling
   std::cout << colorize(NC);
   std::string res;
-  int n = 0;
 
   if (!r.isValid)
   {
     //handle 400
-    auto it = errorHandlers.find(400);
-    if (it != errorHandlers.end())
+    const std::shared_ptr<const Registry> snapshot = getRegistry();
+    const auto& handlers = snapshot->errorHandlers;
+    auto it = handlers.find(400);
+    if (it != handlers.end())
     {
-      res = handleRequest(it->second, r, HTTP_400); 
+      res = handleRequest(Route{it->second}, r, HTTP_400); 
     } else {
       res = HTTP_400 + "Connection: " + (r.keepAlive ? "keep-alive" : "close") + "\r\n" + // use default value of r.keepAlive
-        "Keep-Alive: timeout=" + std::to_string(serverSocket->timeout) + ", max=" + std::to_string(maxKeepAliveRequests) + "\r\n\r\n";
+        "Keep-Alive: timeout=" + std::to_string(serverTimeout) + ", max=" + std::to_string(maxKeepAliveRequests) + "\r\n\r\n";
       std::cout << "[RESPONCE] " << r.method << " -- " << colorize(RED) << r.path << colorize(NC) << " -- " << HTTP_400.substr(9, HTTP_400.size()-11);
     }
   } else {
-    //process request
-    auto it = serverPaths.find(r.path);
-    if (it == serverPaths.end())
+    //process request. Routes found below belong to the snapshot, it is kept until the responce is ready
+    const std::shared_ptr<const Registry> snapshot = getRegistry();
+    const Registry& reg = *snapshot;
+    Router::Match match;
+    const StaticRoute* staticRoute = nullptr;
+    size_t staticCount = 0;
+    const bool isStatic = reg.staticRoutes.find(r.path, staticRoute, staticCount);
+    const RouteTarget* target = !isStatic && reg.router.find(r.path, match) ? &reg.targets[match.value] : nullptr;
+    const bool readOnly = r.method == "GET" || r.method == "HEAD"; // resources can only be read
+    if (isStatic)
     {
-      auto it2 = serverResources.find(r.path);
-      if (it2 != serverResources.end())
+      RouteMethods methods;
+      for (size_t i=0;i<staticCount;++i)
       {
-        std::string file = getFileString(it2->second.first);
-        if (file.empty())
-        {
-          res = HTTP_404 + "Connection: " + (r.keepAlive ? "keep-alive" : "close") + "\r\n\r\n";
-        }
-        res = HTTP_200 + "Content-Type: " + it2->second.second + 
-          "\r\nContent-Length: " + std::to_string(file.size()) + "\r\nContent-Encoding: utf-8\r\n" +
-          "Connection: " + (r.keepAlive ? "keep-alive" : "close") + "\r\n" +
-          "Keep-Alive: timeout=" + std::to_string(serverSocket->timeout) + ", max=" + std::to_string(maxKeepAliveRequests) + "\r\n" + 
-          "\r\n" + file;
+        const StaticRoute& route = staticRoute[i];
+        (route.methodIndex < 0 ? methods.any : methods.methods[route.methodIndex]).callback = route.callback;
+      }
+      res = handleRoute(methods, r, body, stream);
+    } else if (target && match.argCount == 0 && target->route)
+    {
+      res = handleRoute(*target->route, r, body, stream);
+    } else if (target && match.argCount == 0 && target->resource && !readOnly)
+    {
+      res = methodNotAllowed(r, "GET, HEAD");
+    } else if (target && match.argCount == 0 && target->resource)
+    {
+      const auto& resource = *target->resource;
+      auto file = resourceCache.get(getResourceFile(resource.first), resource.second, tail != nullptr);
+      if (!file)
+      {
+        res = HTTP_404 + "Content-Length: 0\r\nConnection: " + (r.keepAlive ? "keep-alive" : "close") + "\r\n\r\n";
         if (getLogLevel() <= INFO)
-          std::cout << "[RESPONCE] " << r.method << " -- " << colorize(CYAN) << r.path << colorize(NC) << " -- " << HTTP_200.substr(9, HTTP_200.size()-11);
-      } else { 
-
-        std::string path = r.path;
-        if (path.back() == '/')
-          path = path.substr(0, path.size()-1);
-        std::string currPrefix = "";
-        std::string postfix = "";
-        bool found = false;
-
-        std::size_t pos = path.rfind("/");
-        if (pos == std::string::npos)
-        {
-          found = false;
-        } else {
-          currPrefix = path.substr(0, pos);
-          postfix = path.substr(pos+1, path.size()-pos-1);
-
-          auto it3 = serverDynamicResources.find(currPrefix+"/");
-          if (it3 != serverDynamicResources.end())
-          {
-            std::string filePath = it3->second.first + postfix; // '/' included
-            std::string data = getFileString(filePath);
-            if (data.empty())
-            {
-              found = false;
-            } else {
-              res = HTTP_200 + "Content-Type: " + it3->second.second + "\r\nContent-Length: " + std::to_string(data.size()) + "\r\nContent-Encoding: utf-8\r\n" +
-                "Connection: " + (r.keepAlive ? "keep-alive" : "close") + "\r\n" + 
-                "Keep-Alive: timeout=" + std::to_string(serverSocket->timeout) + ", max=" + std::to_string(maxKeepAliveRequests) + "\r\n" +
-                "\r\n" + data;
-              if (getLogLevel() <= INFO)
-                std::cout << "[RESPONCE] " << r.method << " -- " << colorize(NC) << r.path << colorize(NC) << " -- " << HTTP_200.substr(9, HTTP_200.size()-11);
-              found = true;
-            }
-          }
-        } 
+          std::cout << "[RESPONCE] " << r.method << " -- " << colorize(RED) << r.path << colorize(NC) << " -- " << HTTP_404.substr(9, HTTP_404.size()-11);
+      } else {
+        res = resourceResponce(selectEncoding(*file, r), r, tail);
+      }
+    } else { 
+      bool found = false;
 
-        if (!found)
+      //dynamic resources are checked before routes with args
+      size_t prefixValue;
+      std::string_view postfix;
+      if (readOnly && reg.router.findPrefix(r.path, prefixValue, postfix))
+      {
+        const auto& resource = *reg.targets[prefixValue].resource;
+        auto file = resourceCache.get(getResourceFile(resource.first + std::string(postfix)), resource.second, tail != nullptr); // '/' included
+        if (file && file->size > 0)
         {
-          bool fnd = true;
-          auto v = split(r.path, "/");
-          for (auto it: serverSpecialPaths)
-          {
-            auto v2 = split(it.first, "/");
-            if (v.size() == v2.size())
-            {
-              for (int i=0;i<v2.size();++i) //check every segment
-              {
-                size_t pos = v2[i].find("<");
-                if (pos != std::string::npos)
-                {
-                  r.args.push_back(v[i]);
-                } else {
-                  if (v[i] != v2[i])
-                  {
-                    fnd = false;
-                  }
-                }
-              }
-              if (fnd)
-              {
-                found = true;
-                res = handleRequest(it.second, r);
-                break;
-              }
-              else
-              r.args.clear();
-            }
-          }
+          res = resourceResponce(selectEncoding(*file, r), r, tail);
+          found = true;
         }
+      }
+
+      if (!found && target && target->route)
+      {
+        found = true;
+        r.args.assign(match.args.begin(), match.args.begin() + match.argCount);
+        r.argValues = match.values;
+        res = handleRoute(*target->route, r, body, stream);
+      }
 
-        if (!found)
+      if (!found)
+      {
+        //handle 404
+        const auto& handlers = reg.errorHandlers;
+        auto it = handlers.find(404);
+        if (it != handlers.end())
         {
-          //handle 404
-          auto it = errorHandlers.find(404);
-          if (it != errorHandlers.end())
-          {
-            res = handleRequest(it->second, r, HTTP_404);
-          } else { 
-            res = HTTP_404 + "Connection: " + (r.keepAlive ? "keep-alive" : "close") + "\r\n"
-              "Keep-Alive: timeout=" + std::to_string(serverSocket->timeout) + ", max=" + std::to_string(maxKeepAliveRequests) + "\r\n\r\n";
-            if (getLogLevel() <= INFO)
-              std::cout << "[RESPONCE] " << r.method << " -- " << colorize(RED) << r.path << colorize(NC) << " -- " << HTTP_404.substr(9, HTTP_404.size()-11);
-          }
+          res = handleRequest(Route{it->second}, r, HTTP_404);
+        } else { 
+          res = HTTP_404 + "Connection: " + (r.keepAlive ? "keep-alive" : "close") + "\r\n"
+            "Keep-Alive: timeout=" + std::to_string(serverTimeout) + ", max=" + std::to_string(maxKeepAliveRequests) + "\r\n\r\n";
+          if (getLogLevel() <= INFO)
+            std::cout << "[RESPONCE] " << r.method << " -- " << colorize(RED) << r.path << colorize(NC) << " -- " << HTTP_404.substr(9, HTTP_404.size()-11);
         }
       }
-    } else {
-      res = handleRequest(it->second, r); 
     }
   }
 
+  if (r.method == "HEAD")
+  {
+    //same headers as for GET, without the body
+    const size_t headEnd = res.find("\r\n\r\n");
+    if (headEnd != std::string::npos)
+      res.resize(headEnd + 4);
+  }
+
   if (getDebugState() && getProfilingMode() && getLogLevel() <= INFO)
   {
     const double timeDelta = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
@@ -831,15 +1741,36 @@ static void handleClient(Request r, const SOCKFD newsockfd)
       std::cout << "\n";
   }
 
+  return res;
+}
+
+#ifdef __linux__
+
+//called by worker threads for every complete request
+static bool processRequest(const std::shared_ptr<const std::string>& request, const RequestParser& head,
+  const std::shared_ptr<BodyReader>& body, ResponceStream& stream, std::vector<OutputSegment>& responce)
+{
+  Request r = parseRequest(request, head, body != nullptr);
+  responce.emplace_back(); // filled after the tail
+  //HEAD is answered with the headers only, its template is rendered whole to know the length
+  std::string res = handleClient(r, body.get(), &responce, r.method == "HEAD" ? nullptr : &stream);
+  responce[0].data = std::move(res);
+  return r.keepAlive && !getShouldClose();
+}
+
+#elif _WIN32
+
+static void serveClient(Request r, const SOCKFD newsockfd)
+{
+  std::string res = handleClient(r);
+
   //send result
-  //std::cout << "sending responce " << res.size() << " bytes\n";
   if (!serverSocket->sendMessage(newsockfd, res))
   {
     if (getLogLevel() <= ERROR)
       std::cout << "[ERROR] Failed to send the responce!\n";
     r.keepAlive = false; // do not try to keep this connection alive
   }
-  //std::cout << replace(res, "\r\n", "\\r\\n\n") << "\n";
 
   if (!r.keepAlive)
   {
@@ -854,7 +1785,6 @@ static void handleClient(Request r, const SOCKFD newsockfd)
       return;
     }
     std::string request = trim(serverSocket->getMessage(newsockfd));
-    //std::string request = "";
     if (request.empty())
     {
       // Socket automatically closes on timeout or an error
@@ -863,16 +1793,108 @@ static void handleClient(Request r, const SOCKFD newsockfd)
 
     Request req = parseRequest(request);
 
-    std::thread th(handleClient, req, newsockfd);
+    std::thread th(serveClient, req, newsockfd);
     th.detach();
     return;
   }
 }
 
+#endif
+
 //returns false on an error
 bool startServer(const int clientQueue, const int timeoutSeconds)
 {
+  serverTimeout = timeoutSeconds;
+  {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    registryLive = true;
+    publishRegistry(); // later changes are published as new snapshots
+  }
+
+#ifdef __linux__
+  //drops the snapshot after the workers and the reactors are destroyed. Routes are cleared if closeServer was called
+  struct ServerCleanup
+  {
+    ~ServerCleanup()
+    {
+      releaseRegistries();
+      serverSocket = nullptr;
+      if (getShouldClose())
+        clearServerState();
+    }
+  } serverCleanup;
+
+  //cached files are dropped when they change on the disk
+  FileWatcher watcher(&onFileChanged);
+  if (serverWatchFiles && !watcher.start(resourcePath) && getLogLevel() <= WARNING)
+    std::cout << colorize(YELLOW) << "[RWEB] Warning! Resource directory is not watched. Cached files are not updated when they change!" << colorize(NC) << "\n";
+
+  //connections are multiplexed by reactor threads, callbacks run on the workers
+  ThreadPool workers(workerThreads, workerQueueDepth);
+  EventLoop loop(&processRequest, workers, timeoutSeconds);
+
+  //closeServer may reset serverSocket at any moment -> keep own references
+  std::vector<std::shared_ptr<Socket>> listeners;
+  if (serverReusePort)
+  {
+    //every reactor accepts from its own socket, the kernel spreads connections between them
+    for (size_t i=0;i<loop.getReactorCount();++i)
+    {
+      listeners.push_back(std::make_shared<Socket>(clientQueue, timeoutSeconds, true));
+      if (getShouldClose()) // socket failed
+        return false;
+    }
+    loop.setListeners(listeners);
+  } else {
+    listeners.push_back(std::make_shared<Socket>(clientQueue, timeoutSeconds));
+  }
+  serverSocket = listeners[0];
+
+  if (!loop.start())
+  {
+    if (getLogLevel() <= ERROR)
+      std::cerr << colorize(RED) << "[ERROR] Failed to start event loop!" << colorize(NC) << "\n";
+    return false;
+  }
+
+  std::shared_ptr<Socket> listener = listeners[0];
+  while (!getShouldClose() && serverReusePort)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  }
+
+  //single acceptor mode. This thread only accepts
+  while (!getShouldClose())
+  {
+    if (!listener->waitForClient(500))
+      continue;
+
+    //accept everything which is queued. Sockets are non-blocking, reading is done by the reactors
+    while (!getShouldClose())
+    {
+      std::optional<SOCKFD> newSockOpt = listener->acceptClient();
+      if (!newSockOpt)
+      {
+        if (errno == EMFILE || errno == ENFILE)
+        {
+          if (getLogLevel() <= ERROR)
+            std::cerr << colorize(RED) << "[ERROR] accept failed: too many open files" << colorize(NC) << "\n";
+          std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != ECONNABORTED)
+        {
+          if (getLogLevel() <= ERROR)
+            std::cerr << colorize(RED) << "[ERROR] accept failed: " << describeError() << colorize(NC) << "\n";
+        }
+        break;
+      }
+
+      loop.dispatch(*newSockOpt);
+    }
+  }
 
+  loop.stop(); // closes the readers and writers workers may wait on -> stop it first
+  workers.stop();
+#elif _WIN32
   serverSocket = std::make_shared<Socket>(clientQueue, timeoutSeconds);
 
   while (!getShouldClose())
@@ -892,8 +1914,10 @@ bool startServer(const int clientQueue, const int timeoutSeconds)
 
     if (getShouldClose())
     {
+      Socket::closeSocket(newSock);
       break;
     }
+
     std::string request = trim(serverSocket->getMessage(newSock));
     if (request.empty())
     {
@@ -902,10 +1926,15 @@ bool startServer(const int clientQueue, const int timeoutSeconds)
 
     Request req = parseRequest(request);
 
-    std::thread th(handleClient, req, newSock);
+    std::thread th(serveClient, req, newSock);
     th.detach();
   }
 
+  //detached threads keep the snapshots they use
+  std::lock_guard<std::mutex> lock(registryMutex);
+  registryLive = false;
+#endif
+
   return true;
 }
 
@@ -914,18 +1943,14 @@ bool startServer(const int clientQueue, const int timeoutSeconds)
 #ifdef __linux__
 void closeServer(int arg)
 {
-  //linux handler
-  std::cout << "\n";
-  setShouldClose(true); 
-  serverSocket = nullptr;
-  std::cout << colorize(NC);
-
-  //cleanup
-  serverPaths.clear();
-  serverResources.clear();
-  errorHandlers.clear();
-  serverDynamicResources.clear();
-  sessions.clear();
+  //linux handler. Only async-signal-safe calls here: the interrupted thread may hold any lock.
+  //startServer does the cleanup when it sees the flag
+  if (arg != 0)
+  {
+    const ssize_t written = write(STDOUT_FILENO, "\n", 1);
+    (void)written;
+  }
+  setShouldClose(true);
 }
 #elif _WIN32
 
@@ -938,15 +1963,9 @@ BOOL WINAPI closeServer(DWORD signal)
     setShouldClose(true);
     serverSocket = nullptr;
   }
-  std::cout << colorize(NC);
-
-  //cleanup
-  serverPaths.clear();
-  serverResources.clear();
-  errorHandlers.clear();
-  serverDynamicResources.clear();
-  sessions.clear();
 
+  //the handler runs on its own thread, so it can clean up itself
+  clearServerState();
   return TRUE;
 }
 
@@ -968,27 +1987,17 @@ const std::string getFileString(const std::string& filePath)
 
 HTMLTemplate createTemplate(const std::string& templatePath, const std::string& statusResponce)
 {
-  std::string file;
-  std::string resp;
-  if (templatePath != "")
+  HTMLTemplate temp("");
+  temp.responce = statusResponce;
+  if (templatePath != "" && !temp.loadFile(templatePath, serverTemplateCache))
   {
-    file = getFileString(templatePath);
-    resp = statusResponce;
-    if (file.empty())
-    {
-      if (getLogLevel() <= ERROR)
-        std::cerr << "[TEMPLATE] File " << templatePath << " is empty!\n";
-      resp = HTTP_500;
-    }
-  } else {
-    file = "";
-    resp = statusResponce;
+    if (getLogLevel() <= ERROR)
+      std::cerr << "[TEMPLATE] File " << templatePath << " is empty!\n";
+    temp.responce = HTTP_500;
   }
 
-  HTMLTemplate temp(file);
   temp.contentType = templatePath == "" ? "" : MIME::HTML;
   temp.encoding = templatePath == "" ? "" : "utf-8";
-  temp.responce = resp;
   temp.m_templateFileName = templatePath;
   return temp;
 }
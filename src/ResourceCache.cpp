@@ -0,0 +1,215 @@
+#include "../include/ResourceCache.h"
+#include "../include/Utility.h"
+
+#include <cstdio>
+
+namespace rweb
+{
+
+//FNV-1a of the content as a quoted ETag
+static std::string hashETag(const std::string& data)
+{
+  uint64_t hash = 14695981039346656037ull;
+  for (const char c : data)
+  {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+
+  char buf[24];
+  snprintf(buf, sizeof(buf), "\"%016llx\"", (unsigned long long)hash);
+  return buf;
+}
+
+//ETag of a file which is not read. Changes when the file is rewritten, also within the same second
+//(it is a strong validator, If-Range relies on it)
+static std::string metadataETag(const OpenFile& file)
+{
+  char buf[64];
+  snprintf(buf, sizeof(buf), "\"%llx-%llx.%lx\"", (unsigned long long)file.getSize(), (unsigned long long)file.getModifiedTime(),
+    (unsigned long)file.getModifiedNanoseconds());
+  return buf;
+}
+
+//sets the header lines of 'res' after its ETag and siblings are known
+static void setHeaders(CachedResource& res, const std::string& contentType, bool vary)
+{
+  res.contentType = contentType;
+  res.validators = "ETag: " + res.etag + "\r\nLast-Modified: " + formatHTTPDate(res.modified) + "\r\n";
+  if (vary)
+    res.validators += "Vary: Accept-Encoding\r\n";
+  res.headers = "Content-Type: " + contentType + "\r\n";
+  if (!res.encoding.empty())
+    res.headers += "Content-Encoding: " + res.encoding + "\r\n";
+  res.headers += "Content-Length: " + std::to_string(res.size) + "\r\n" + res.validators;
+}
+
+//reads 'file' or keeps it open if 'read' is false
+static std::shared_ptr<CachedResource> load(const std::shared_ptr<const OpenFile>& file, bool read)
+{
+  auto res = std::make_shared<CachedResource>();
+  res->size = file->getSize();
+  res->modified = file->getModifiedTime();
+  if (!read)
+  {
+    res->file = file;
+    res->etag = metadataETag(*file);
+  } else {
+    if (!file->read(res->data))
+      return nullptr;
+    res->etag = hashETag(res->data);
+  }
+  return res;
+}
+
+//returns the precompressed sibling or nullptr if there is none
+static std::shared_ptr<const CachedResource> loadSibling(const std::string& path, const std::string& encoding, const std::string& contentType, bool read)
+{
+  auto file = OpenFile::open(path);
+  auto res = file ? load(file, read) : nullptr;
+  if (!res)
+    return nullptr;
+  res->encoding = encoding;
+  setHeaders(*res, contentType, true);
+  return res;
+}
+
+//bytes of the resource and its siblings kept in memory
+static size_t memorySize(const CachedResource& res)
+{
+  return res.data.size() + (res.gzip ? res.gzip->data.size() : 0) + (res.brotli ? res.brotli->data.size() : 0);
+}
+
+ResourceCache::ResourceCache(size_t capacity)
+  : m_capacity(capacity), m_size(0), m_precompressed(true), m_generation(0)
+{
+}
+
+std::shared_ptr<const CachedResource> ResourceCache::get(const std::string& path, const std::string& contentType, bool keepOpen)
+{
+  bool precompressed;
+  uint64_t generation;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(path);
+    if (it != m_entries.end())
+    {
+      m_uses.splice(m_uses.begin(), m_uses, it->second.use);
+      return it->second.resource;
+    }
+    precompressed = m_precompressed;
+    generation = m_generation;
+  }
+
+  //read without the lock, other files are served meanwhile
+  auto file = OpenFile::open(path);
+  if (!file)
+    return nullptr;
+
+  const bool cached = file->getSize() <= getCapacity() / 4;
+  const bool read = cached || !keepOpen;
+  auto res = load(file, read);
+  if (!res)
+    return nullptr;
+
+  if (precompressed)
+  {
+    res->gzip = loadSibling(path + ".gz", "gzip", contentType, read);
+    res->brotli = loadSibling(path + ".br", "br", contentType, read);
+  }
+  setHeaders(*res, contentType, res->gzip || res->brotli);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  //a file changed while it was read may be read before the change -> it is not kept
+  if (!cached || generation != m_generation)
+    return res;
+
+  auto it = m_entries.find(path);
+  if (it != m_entries.end()) // read by another thread too
+  {
+    m_uses.splice(m_uses.begin(), m_uses, it->second.use);
+    return it->second.resource;
+  }
+
+  m_uses.push_front(path);
+  m_entries.emplace(path, Entry{res, m_uses.begin()});
+  m_size += memorySize(*res);
+  evict();
+  return res;
+}
+
+void ResourceCache::invalidate(const std::string& path)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_generation++;
+  erase(path);
+  if (path.size() > 3 && (path.compare(path.size() - 3, 3, ".gz") == 0 || path.compare(path.size() - 3, 3, ".br") == 0))
+    erase(path.substr(0, path.size() - 3));
+}
+
+void ResourceCache::clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_generation++;
+  m_entries.clear();
+  m_uses.clear();
+  m_size = 0;
+}
+
+void ResourceCache::setCapacity(size_t capacity)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_capacity = capacity;
+  evict();
+}
+
+size_t ResourceCache::getCapacity() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_capacity;
+}
+
+size_t ResourceCache::getSize() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_size;
+}
+
+void ResourceCache::setPrecompressed(bool enabled)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_precompressed = enabled;
+  m_generation++;
+  m_entries.clear();
+  m_uses.clear();
+  m_size = 0;
+}
+
+bool ResourceCache::getPrecompressed() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_precompressed;
+}
+
+void ResourceCache::erase(const std::string& path)
+{
+  auto it = m_entries.find(path);
+  if (it == m_entries.end())
+    return;
+  m_size -= memorySize(*it->second.resource);
+  m_uses.erase(it->second.use);
+  m_entries.erase(it);
+}
+
+void ResourceCache::evict()
+{
+  while (m_size > m_capacity && !m_uses.empty())
+  {
+    auto it = m_entries.find(m_uses.back());
+    m_size -= memorySize(*it->second.resource);
+    m_entries.erase(it);
+    m_uses.pop_back();
+  }
+}
+
+}
@@ -0,0 +1,67 @@
+#include "../include/ResponceWriter.h"
+
+namespace rweb
+{
+
+ResponceWriter::ResponceWriter(size_t capacity, std::function<void()> onData)
+: m_capacity(capacity), m_onData(std::move(onData)), m_bytesWritten(0), m_closed(false)
+{
+}
+
+bool ResponceWriter::write(std::string_view data)
+{
+  bool notify;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this](){ return m_buffer.size() < m_capacity || m_closed; });
+    if (m_closed)
+      return false;
+    if (data.empty())
+      return true;
+
+    //server is told only once until it takes the bytes
+    notify = m_buffer.empty();
+    m_buffer.append(data);
+    m_bytesWritten += data.size();
+  }
+
+  if (notify && m_onData)
+    m_onData();
+  return true;
+}
+
+bool ResponceWriter::isClosed() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_closed;
+}
+
+size_t ResponceWriter::getBytesWritten() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_bytesWritten;
+}
+
+bool ResponceWriter::take(std::string& data)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    data.clear();
+    if (m_buffer.empty())
+      return false;
+    data.swap(m_buffer);
+  }
+  m_cv.notify_one();
+  return true;
+}
+
+void ResponceWriter::close()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_closed = true;
+  }
+  m_cv.notify_all();
+}
+
+}
@@ -0,0 +1,278 @@
+#include "../include/Router.h"
+
+#include <algorithm>
+#include <charconv>
+
+namespace rweb
+{
+
+//reads the next segment of 'path' starting at 'pos'. Returns false at the end of the path
+static bool nextSegment(std::string_view path, size_t& pos, std::string_view& segment)
+{
+  if (pos >= path.size())
+    return false;
+
+  size_t start = pos;
+  while (start < path.size() && path[start] == '/')
+    start++;
+
+  if (start == path.size())
+  {
+    //trailing '/' after a segment. Path of slashes only has no segments
+    const bool trailing = pos > 0;
+    pos = path.size();
+    segment = std::string_view{};
+    return trailing;
+  }
+
+  size_t end = path.find('/', start);
+  if (end == std::string_view::npos)
+    end = path.size();
+  segment = path.substr(start, end - start);
+  pos = end;
+  return true;
+}
+
+static bool isArg(std::string_view segment)
+{
+  return segment.size() >= 2 && segment.front() == '<' && segment.back() == '>';
+}
+
+static int hexValue(const char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+bool Router::getArgType(std::string_view segment, ArgType& type)
+{
+  if (!isArg(segment))
+    return false;
+
+  segment = segment.substr(1, segment.size()-2);
+  const size_t colon = segment.find(':');
+  if (colon == std::string_view::npos)
+  {
+    type = ArgType::STRING;
+    return true;
+  }
+
+  const std::string_view name = segment.substr(0, colon);
+  if (name == "int")
+    type = ArgType::INT;
+  else if (name == "uint")
+    type = ArgType::UINT;
+  else if (name == "uuid")
+    type = ArgType::UUID;
+  else if (name == "string")
+    type = ArgType::STRING;
+  else
+    return false;
+  return true;
+}
+
+bool Router::parseArg(std::string_view segment, ArgType type, ArgValue& value)
+{
+  if (segment.empty())
+    return false;
+
+  value.type = type;
+  const char* end = segment.data() + segment.size();
+  switch (type)
+  {
+    case ArgType::INT:
+    {
+      auto res = std::from_chars(segment.data(), end, value.i);
+      return res.ec == std::errc() && res.ptr == end;
+    }
+    case ArgType::UINT:
+    {
+      auto res = std::from_chars(segment.data(), end, value.u);
+      return res.ec == std::errc() && res.ptr == end;
+    }
+    case ArgType::UUID:
+    {
+      if (segment.size() != 36)
+        return false;
+      size_t byte = 0;
+      for (size_t i=0;i<segment.size();)
+      {
+        if (i == 8 || i == 13 || i == 18 || i == 23)
+        {
+          if (segment[i] != '-')
+            return false;
+          i++;
+          continue;
+        }
+        const int hi = hexValue(segment[i]);
+        const int lo = hexValue(segment[i+1]);
+        if (hi < 0 || lo < 0)
+          return false;
+        value.uuid[byte++] = (hi << 4) | lo;
+        i += 2;
+      }
+      return true;
+    }
+    case ArgType::STRING:
+      return true;
+  }
+  return false;
+}
+
+Router::Router()
+{
+  clear();
+}
+
+void Router::clear()
+{
+  m_nodes.clear();
+  m_nodes.emplace_back();
+}
+
+uint32_t Router::findChild(uint32_t node, std::string_view segment) const
+{
+  const auto& children = m_nodes[node].children;
+  auto it = std::lower_bound(children.begin(), children.end(), segment, [](const std::pair<std::string, uint32_t>& child, std::string_view s){
+    return std::string_view(child.first) < s;
+  });
+  if (it == children.end() || it->first != segment)
+    return NONE;
+  return it->second;
+}
+
+uint32_t Router::insert(std::string_view path, bool withArgs)
+{
+  uint32_t node = 0;
+  size_t pos = 0;
+  std::string_view segment;
+  while (nextSegment(path, pos, segment))
+  {
+    ArgType type;
+    if (withArgs && getArgType(segment, type))
+    {
+      auto& args = m_nodes[node].args;
+      auto it = std::lower_bound(args.begin(), args.end(), type, [](const std::pair<ArgType, uint32_t>& a, ArgType t){
+        return a.first < t;
+      });
+      if (it == args.end() || it->first != type)
+      {
+        it = args.emplace(it, type, m_nodes.size());
+        node = it->second;
+        m_nodes.emplace_back(); // invalidates 'args'
+      } else {
+        node = it->second;
+      }
+      continue;
+    }
+
+    uint32_t child = findChild(node, segment);
+    if (child == NONE)
+    {
+      child = m_nodes.size();
+      auto& children = m_nodes[node].children;
+      auto it = std::lower_bound(children.begin(), children.end(), segment, [](const std::pair<std::string, uint32_t>& c, std::string_view s){
+        return std::string_view(c.first) < s;
+      });
+      children.emplace(it, std::string(segment), child);
+      m_nodes.emplace_back(); // invalidates 'children'
+    }
+    node = child;
+  }
+  return node;
+}
+
+bool Router::add(std::string_view path, size_t value, bool withArgs)
+{
+  const uint32_t node = insert(path, withArgs);
+  if (m_nodes[node].value != NONE)
+    return false;
+  m_nodes[node].value = value;
+  return true;
+}
+
+bool Router::addPrefix(std::string_view prefix, size_t value)
+{
+  if (!prefix.empty() && prefix.back() == '/')
+    prefix.remove_suffix(1);
+
+  const uint32_t node = insert(prefix, false);
+  if (m_nodes[node].prefixValue != NONE)
+    return false;
+  m_nodes[node].prefixValue = value;
+  return true;
+}
+
+bool Router::match(uint32_t node, std::string_view path, size_t pos, Match& m) const
+{
+  std::string_view segment;
+  size_t next = pos;
+  if (!nextSegment(path, next, segment))
+  {
+    if (m_nodes[node].value == NONE)
+      return false;
+    m.value = m_nodes[node].value;
+    return true;
+  }
+
+  const uint32_t child = findChild(node, segment);
+  if (child != NONE && match(child, path, next, m))
+    return true;
+
+  //backtrack to the args when the exact branch does not lead anywhere
+  if (segment.empty() || m.argCount >= MAX_ARGS)
+    return false;
+  for (const auto& arg : m_nodes[node].args)
+  {
+    if (!parseArg(segment, arg.first, m.values[m.argCount]))
+      continue;
+    m.args[m.argCount++] = segment;
+    if (match(arg.second, path, next, m))
+      return true;
+    m.argCount--;
+  }
+  return false;
+}
+
+bool Router::find(std::string_view path, Match& m) const
+{
+  m.argCount = 0;
+  return match(0, path, 0, m);
+}
+
+bool Router::findPrefix(std::string_view path, size_t& value, std::string_view& rest) const
+{
+  if (!path.empty() && path.back() == '/')
+    path.remove_suffix(1);
+
+  const size_t slash = path.rfind('/');
+  if (slash == std::string_view::npos || slash + 1 == path.size())
+    return false;
+
+  //walk the exact segments before the last one
+  const std::string_view prefix = path.substr(0, slash);
+  uint32_t node = 0;
+  size_t pos = 0;
+  std::string_view segment;
+  while (nextSegment(prefix, pos, segment))
+  {
+    if (segment.empty())
+      continue;
+    node = findChild(node, segment);
+    if (node == NONE)
+      return false;
+  }
+
+  if (m_nodes[node].prefixValue == NONE)
+    return false;
+  value = m_nodes[node].prefixValue;
+  rest = path.substr(slash + 1);
+  return true;
+}
+
+}
@@ -0,0 +1,196 @@
+#include "../include/Scanner.h"
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define RWEB_SCANNER_X86
+#include <emmintrin.h>
+#if defined(__GNUC__)
+#define RWEB_SCANNER_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace rweb
+{
+
+typedef size_t (*ScanKernel)(const char* data, size_t size, size_t from, unsigned stops);
+
+static inline bool isStop(const unsigned char c, const unsigned stops)
+{
+  if ((stops & SCAN_NONTOKEN) && (c <= 0x20 || c >= 0x7f))
+    return true;
+  if ((stops & SCAN_COLON) && c == ':')
+    return true;
+  if ((stops & SCAN_CONTROL) && ((c < 0x20 && c != '\t') || c == 0x7f))
+    return true;
+  if ((stops & SCAN_CR) && c == '\r')
+    return true;
+  return false;
+}
+
+static size_t scanScalar(const char* data, size_t size, size_t from, unsigned stops)
+{
+  for (size_t i=from;i<size;++i)
+  {
+    if (isStop((unsigned char)data[i], stops))
+      return i;
+  }
+  return size;
+}
+
+static inline unsigned countTrailingZeros(uint32_t mask)
+{
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return index;
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+
+#ifdef RWEB_SCANNER_X86
+
+//bit per byte of the 16 byte block which is a stop
+static inline uint32_t stopMaskSSE2(const __m128i x, const unsigned stops)
+{
+  __m128i m = _mm_setzero_si128();
+  if (stops & SCAN_NONTOKEN)
+  {
+    //unsigned x <= 0x20 or x >= 0x7f
+    const __m128i low = _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(0x20)), x);
+    const __m128i high = _mm_cmpeq_epi8(_mm_max_epu8(x, _mm_set1_epi8(0x7f)), x);
+    m = _mm_or_si128(m, _mm_or_si128(low, high));
+  }
+  if (stops & SCAN_COLON)
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8(':')));
+  if (stops & SCAN_CONTROL)
+  {
+    const __m128i ctl = _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(0x1f)), x);
+    const __m128i tab = _mm_cmpeq_epi8(x, _mm_set1_epi8('\t'));
+    const __m128i del = _mm_cmpeq_epi8(x, _mm_set1_epi8(0x7f));
+    m = _mm_or_si128(m, _mm_or_si128(_mm_andnot_si128(tab, ctl), del));
+  }
+  if (stops & SCAN_CR)
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8('\r')));
+  return (uint32_t)_mm_movemask_epi8(m);
+}
+
+static size_t scanSSE2(const char* data, size_t size, size_t from, unsigned stops)
+{
+  size_t i = from;
+  for (;i+16<=size;i+=16)
+  {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    const uint32_t mask = stopMaskSSE2(x, stops);
+    if (mask)
+      return i + countTrailingZeros(mask);
+  }
+  return scanScalar(data, size, i, stops);
+}
+
+#endif
+
+#ifdef RWEB_SCANNER_AVX2
+
+__attribute__((target("avx2")))
+static inline uint32_t stopMaskAVX2(const __m256i x, const unsigned stops)
+{
+  __m256i m = _mm256_setzero_si256();
+  if (stops & SCAN_NONTOKEN)
+  {
+    const __m256i low = _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(0x20)), x);
+    const __m256i high = _mm256_cmpeq_epi8(_mm256_max_epu8(x, _mm256_set1_epi8(0x7f)), x);
+    m = _mm256_or_si256(m, _mm256_or_si256(low, high));
+  }
+  if (stops & SCAN_COLON)
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(x, _mm256_set1_epi8(':')));
+  if (stops & SCAN_CONTROL)
+  {
+    const __m256i ctl = _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(0x1f)), x);
+    const __m256i tab = _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\t'));
+    const __m256i del = _mm256_cmpeq_epi8(x, _mm256_set1_epi8(0x7f));
+    m = _mm256_or_si256(m, _mm256_or_si256(_mm256_andnot_si256(tab, ctl), del));
+  }
+  if (stops & SCAN_CR)
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\r')));
+  return (uint32_t)_mm256_movemask_epi8(m);
+}
+
+__attribute__((target("avx2")))
+static size_t scanAVX2(const char* data, size_t size, size_t from, unsigned stops)
+{
+  size_t i = from;
+  for (;i+32<=size;i+=32)
+  {
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    const uint32_t mask = stopMaskAVX2(x, stops);
+    if (mask)
+      return i + countTrailingZeros(mask);
+  }
+  return scanSSE2(data, size, i, stops);
+}
+
+#endif
+
+struct SelectedKernel
+{
+  ScanKernel kernel;
+  const char* name;
+};
+
+static SelectedKernel selectKernel()
+{
+#ifdef RWEB_SCANNER_AVX2
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return {&scanAVX2, "avx2"};
+#endif
+#ifdef RWEB_SCANNER_X86
+  return {&scanSSE2, "sse2"}; // always available on x86-64
+#else
+  return {&scanScalar, "scalar"};
+#endif
+}
+
+static const SelectedKernel& getKernel()
+{
+  static const SelectedKernel kernel = selectKernel();
+  return kernel;
+}
+
+size_t scanFor(std::string_view data, size_t from, unsigned stops)
+{
+  if (from >= data.size())
+    return data.size();
+  //short tails are not worth the vector setup
+  if (data.size() - from < 16)
+    return scanScalar(data.data(), data.size(), from, stops);
+  return getKernel().kernel(data.data(), data.size(), from, stops);
+}
+
+size_t findHeaderEnd(std::string_view data, size_t from)
+{
+  size_t pos = from;
+  while (true)
+  {
+    pos = scanFor(data, pos, SCAN_CR);
+    if (pos + 4 > data.size())
+      return std::string_view::npos;
+    if (data[pos+1] == '\n' && data[pos+2] == '\r' && data[pos+3] == '\n')
+      return pos;
+    pos++;
+  }
+}
+
+const char* getScannerKernel()
+{
+  return getKernel().name;
+}
+
+}
@@ -1,5 +1,6 @@
 #include "../include/Socket.h"
 #include "../include/Utility.h"
+#include "../include/Scanner.h"
 
 #include <iostream>
 
@@ -9,6 +10,7 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <poll.h>
 #elif _WIN32
 #include <ws2tcpip.h>
 #endif
@@ -21,7 +23,7 @@ bool getShouldClose();
 void setShouldClose(bool _shouldClose);
 std::string describeError();
 
-Socket::Socket(int clientQueue, int timeoutSeconds)
+Socket::Socket(int clientQueue, int timeoutSeconds, bool reusePort)
 : m_debug(false), m_connected(false), timeout(timeoutSeconds)
 {
 #ifdef __linux__
@@ -30,7 +32,8 @@ Socket::Socket(int clientQueue, int timeoutSeconds)
 
   m_socket = SOCKFD{ 0 };
 
-  m_socket.sockfd = socket(AF_INET, SOCK_STREAM, 0);
+  //listening socket is non-blocking: accept loop waits in waitForClient and drains the queue
+  m_socket.sockfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
   if (m_socket.sockfd < 0)
   {
     std::cerr << colorize(RED) << "[ERROR] Can't open socket!" << colorize(NC) << "\n";
@@ -48,6 +51,14 @@ Socket::Socket(int clientQueue, int timeoutSeconds)
     return;
   }
 
+  if (reusePort && setsockopt(m_socket.sockfd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(int)) < 0)
+  {
+    std::cerr << colorize(RED) << "[ERROR] setsockopt failed! (SO_REUSEPORT)" << colorize(NC) << "\n";
+    close(m_socket.sockfd);
+    setShouldClose(true);
+    return;
+  }
+
   struct timeval tv;
   tv.tv_sec = timeoutSeconds;
   tv.tv_usec = 0;
@@ -200,7 +211,7 @@ bool Socket::sendMessage(SOCKFD clientSocket, const std::string& message)
 
   do
   {
-    int n = write(clientSocket.sockfd, message.substr(m_count).c_str(), message.size() - m_count);
+    int n = write(clientSocket.sockfd, message.data() + m_count, message.size() - m_count);
     if (n < 0)
     {
       if (getLogLevel() <= ERROR)
@@ -235,7 +246,7 @@ std::string Socket::getMessage(SOCKFD clientSocket)
 
   std::string request(SERVER_BUFLEN, '\0');
   do {
-    int n = read(clientSocket.sockfd, &request[received], SERVER_BUFLEN-1);
+    int n = read(clientSocket.sockfd, &request[received], SERVER_BUFLEN-1-received);
     if (n < 0)
     {
       closeSocket(clientSocket);
@@ -253,11 +264,13 @@ std::string Socket::getMessage(SOCKFD clientSocket)
         std::cerr << colorize(RED) << "[ERROR] Failed to read from client socket: " << describeError() << colorize(NC) << "\n";
       return std::string{};
     }
-    if (n == 0 || request.find("\r\n\r\n") != std::string::npos)
+    //only new bytes (and 3 before them for a split terminator) are scanned
+    const size_t scanFrom = received > 3 ? received - 3 : 0;
+    received += n;
+    if (n == 0 || findHeaderEnd(std::string_view(request.data(), received), scanFrom) != std::string_view::npos)
     {
       break;
     }
-    received += n;
   } while (received < SERVER_BUFLEN-1);
 
   return request;
@@ -275,7 +288,7 @@ std::string Socket::getMessage(SOCKFD clientSocket)
     request += std::string(buffer);
     received += iResult;
 
-    if (iResult == 0 || request.find("\r\n\r\n") != std::string::npos)
+    if (iResult == 0 || findHeaderEnd(request) != std::string_view::npos)
     {
       break;
     } else if (iResult < 0)
@@ -289,6 +302,27 @@ std::string Socket::getMessage(SOCKFD clientSocket)
 #endif
 }
 
+SOCKFD Socket::getSocket() const
+{
+  return m_socket;
+}
+
+bool Socket::waitForClient(int timeoutMs)
+{
+#ifdef __linux__
+
+  pollfd pfd{};
+  pfd.fd = m_socket.sockfd;
+  pfd.events = POLLIN;
+  return poll(&pfd, 1, timeoutMs) > 0 && (pfd.revents & POLLIN);
+
+#elif _WIN32
+
+  return true; // accept is blocking on windows
+
+#endif
+}
+
 std::optional<SOCKFD> Socket::acceptClient()
 {
 #ifdef __linux__
@@ -296,7 +330,8 @@ std::optional<SOCKFD> Socket::acceptClient()
   struct sockaddr_in cli_addr;
 
   socklen_t cli_len = sizeof(cli_addr);
-  int newsockfd = ::accept(m_socket.sockfd, (struct sockaddr*)&cli_addr, &cli_len);
+  //client sockets are handed to the reactors, so they are created non-blocking right away
+  int newsockfd = ::accept4(m_socket.sockfd, (struct sockaddr*)&cli_addr, &cli_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
   if (newsockfd < 0)
   {
     return std::nullopt;
@@ -0,0 +1,81 @@
+#include "../include/ThreadPool.h"
+#include "../include/Utility.h"
+
+#include <iostream>
+
+namespace rweb
+{
+
+ThreadPool::ThreadPool(unsigned int threads, size_t queueDepth)
+: m_queueDepth(queueDepth == 0 ? 1 : queueDepth), m_stopping(false)
+{
+  if (threads == 0)
+    threads = std::thread::hardware_concurrency();
+  if (threads == 0)
+    threads = 1;
+
+  for (unsigned int i=0;i<threads;++i)
+    m_threads.emplace_back(&ThreadPool::run, this);
+
+  if (getLogLevel() <= INFO)
+    std::cout << "[SERVER] Started " << threads << " worker thread(s), queue depth " << m_queueDepth << "\n";
+}
+
+ThreadPool::~ThreadPool()
+{
+  stop();
+}
+
+bool ThreadPool::trySubmit(std::function<void()> task)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_stopping || m_tasks.size() >= m_queueDepth)
+      return false;
+    m_tasks.push_back(std::move(task));
+  }
+  m_cv.notify_one();
+  return true;
+}
+
+void ThreadPool::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+    m_tasks.clear();
+  }
+  m_cv.notify_all();
+
+  for (auto& th : m_threads)
+  {
+    if (th.joinable())
+      th.join();
+  }
+  m_threads.clear();
+}
+
+size_t ThreadPool::getThreadCount() const
+{
+  return m_threads.size();
+}
+
+void ThreadPool::run()
+{
+  while (true)
+  {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv.wait(lock, [this](){ return m_stopping || !m_tasks.empty(); });
+      if (m_stopping)
+        return;
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+
+    task();
+  }
+}
+
+}
@@ -6,6 +6,7 @@
 #include <cmath>
 #include <string>
 #include <algorithm>
+#include <cstdio>
 
 namespace rweb
 {
@@ -368,22 +369,24 @@ double calculate(const std::string& expression, bool* is_ok)
   return calculate(tokens, is_ok);
 }
 
-std::string urlDecode(const std::string& str) {
+static int hexDigit(const char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  return (c | 0x20) - 'a' + 10; // isxdigit is checked by the caller
+}
+
+std::string urlDecode(std::string_view str) {
   std::string ret;
-  char ch;
-  size_t i, ii, len = str.length();
+  ret.reserve(str.size());
 
-  for (i = 0; i < len; i++) {
-    if (str[i] != '%') {
-      if (str[i] == '+')
-        ret += ' ';
-      else
-        ret += str[i];
-    } else {
-      sscanf(str.substr(i + 1, 2).c_str(), "%x", (unsigned int* )&ii);
-      ch = static_cast<char>(ii);
-      ret += ch;
+  for (size_t i = 0; i < str.size(); i++) {
+    if (str[i] == '+') {
+      ret += ' ';
+    } else if (str[i] == '%' && i + 2 < str.size() && isxdigit((unsigned char)str[i+1]) && isxdigit((unsigned char)str[i+2])) {
+      ret += static_cast<char>(hexDigit(str[i+1]) * 16 + hexDigit(str[i+2]));
       i = i + 2;
+    } else {
+      ret += str[i]; // malformed escapes are kept as is
     }
   }
   return ret;
@@ -419,6 +422,86 @@ std::string toLower(const std::string& s)
   return data;
 }
 
+bool equalsIgnoreCase(std::string_view a, std::string_view b)
+{
+  if (a.size() != b.size())
+    return false;
+  for (size_t i=0;i<a.size();++i)
+  {
+    if (std::tolower((unsigned char)a[i]) != std::tolower((unsigned char)b[i]))
+      return false;
+  }
+  return true;
+}
+
+static const char* const weekDays[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+static const char* const months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+//days since 1970-01-01 of the date (proleptic Gregorian calendar)
+static int64_t daysFromCivil(int64_t y, const int m, const int d)
+{
+  y -= m <= 2;
+  const int64_t era = (y >= 0 ? y : y - 399) / 400;
+  const int64_t yoe = y - era * 400;
+  const int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+std::string formatHTTPDate(const int64_t time)
+{
+  //inverse of daysFromCivil
+  const int64_t days = time >= 0 ? time / 86400 : (time - 86399) / 86400;
+  const int64_t secs = time - days * 86400;
+  const int64_t z = days + 719468;
+  const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+  const int64_t doe = z - era * 146097;
+  const int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const int64_t mp = (5 * doy + 2) / 153;
+  const int d = doy - (153 * mp + 2) / 5 + 1;
+  const int m = mp < 10 ? mp + 3 : mp - 9;
+  const int64_t y = yoe + era * 400 + (m <= 2);
+
+  char buf[96]; // room for any int and long long the format may get, 29 bytes are used for real dates
+  snprintf(buf, sizeof(buf), "%s, %02d %s %04lld %02d:%02d:%02d GMT", weekDays[((days % 7) + 11) % 7], d, months[m-1],
+    (long long)y, int(secs / 3600), int(secs / 60 % 60), int(secs % 60));
+  return buf;
+}
+
+bool parseHTTPDate(std::string_view date, int64_t& time)
+{
+  //"Sun, 06 Nov 1994 08:49:37 GMT"
+  if (date.size() != 29 || date[3] != ',' || date.substr(25) != " GMT")
+    return false;
+
+  auto number = [&](size_t pos, size_t len, int& value){
+    value = 0;
+    for (size_t i=pos;i<pos+len;++i)
+    {
+      if (date[i] < '0' || date[i] > '9')
+        return false;
+      value = value * 10 + (date[i] - '0');
+    }
+    return true;
+  };
+
+  int month = -1;
+  for (int i=0;i<12;++i)
+  {
+    if (date.substr(8, 3) == months[i])
+      month = i + 1;
+  }
+
+  int d, y, h, min, sec;
+  if (month < 0 || !number(5, 2, d) || !number(12, 4, y) || !number(17, 2, h) || !number(20, 2, min) || !number(23, 2, sec)
+    || date[16] != ' ' || date[19] != ':' || date[22] != ':' || d < 1 || d > 31 || h > 23 || min > 59 || sec > 60)
+    return false;
+
+  time = daysFromCivil(y, month, d) * 86400 + h * 3600 + min * 60 + sec;
+  return true;
+}
+
 std::string toUpper(const std::string& s)
 {
   std::string data = s;
@@ -0,0 +1,53 @@
+#pragma once
+
+//raw HTTP client shared by the server tests. Requests are sent as they are, so framing and pipelining can be tested
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+//sends 'parts' on one connection with a pause between them and reads the responces until the server closes it.
+//'halfClose' shuts down the sending side after the last part
+inline std::string exchange(const int port, const std::vector<std::string>& parts, const bool halfClose=false)
+{
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+  if (fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0)
+  {
+    if (fd >= 0)
+      close(fd);
+    return std::string{};
+  }
+
+  for (size_t i=0;i<parts.size();++i)
+  {
+    if (i > 0)
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    send(fd, parts[i].data(), parts[i].size(), MSG_NOSIGNAL);
+  }
+  if (halfClose)
+    shutdown(fd, SHUT_WR);
+
+  std::string res;
+  char buf[1024];
+  ssize_t n;
+  while ((n = recv(fd, buf, sizeof(buf), 0)) > 0)
+    res.append(buf, n);
+  close(fd);
+  return res;
+}
+
+//sends one request (or pipelined requests) and reads the responces until the server closes the connection
+inline std::string exchange(const int port, const std::string& request)
+{
+  return ::exchange(port, std::vector<std::string>{request}); // std::exchange would be found by ADL
+}
@@ -0,0 +1,65 @@
+#include <RWEB.h>
+#include <Compression.h>
+
+#include <iostream>
+
+#include <zlib.h>
+
+static bool fail(const std::string& message)
+{
+  std::cout << rweb::colorize(rweb::RED) << "TEST FAILED: " << message << rweb::colorize(rweb::NC) << "\n";
+  return false;
+}
+
+//decompresses gzip or zlib data (detected by zlib)
+static std::string inflateAll(const std::string& data)
+{
+  z_stream stream{};
+  if (inflateInit2(&stream, 15 + 32) != Z_OK)
+    return std::string{};
+
+  std::string out;
+  char buf[4096];
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = data.size();
+  int result;
+  do
+  {
+    stream.next_out = reinterpret_cast<Bytef*>(buf);
+    stream.avail_out = sizeof(buf);
+    result = inflate(&stream, Z_NO_FLUSH);
+    out.append(buf, sizeof(buf) - stream.avail_out);
+  } while (result == Z_OK);
+  inflateEnd(&stream);
+  return result == Z_STREAM_END ? out : std::string{};
+}
+
+int main()
+{
+  rweb::init(false);
+  bool ok = true;
+
+  std::string text;
+  for (int i=0;i<2000;++i)
+    text += "{\"id\": " + std::to_string(i) + ", \"name\": \"item\"},";
+
+  std::string gzip, deflate;
+  if (!rweb::compress(text, rweb::ContentCoding::GZIP, 6, gzip) || gzip.size() >= text.size() / 4
+    || gzip.compare(0, 2, "\x1f\x8b") != 0 || inflateAll(gzip) != text)
+    ok = fail("gzip is wrong");
+  if (ok && (!rweb::compress(text, rweb::ContentCoding::DEFLATE, 1, deflate) || deflate[0] != 0x78 || inflateAll(deflate) != text))
+    ok = fail("deflate is wrong");
+  if (ok && (!rweb::compress("", rweb::ContentCoding::GZIP, 9, gzip) || !inflateAll(gzip).empty()))
+    ok = fail("empty body is wrong");
+
+  if (ok && (!rweb::isCompressible("text/html") || !rweb::isCompressible("application/json; charset=utf-8")
+    || !rweb::isCompressible("image/svg+xml") || !rweb::isCompressible("application/ld+json")
+    || rweb::isCompressible("image/png") || rweb::isCompressible("application/zip")))
+    ok = fail("compressible types are wrong");
+
+  if (!ok)
+    return -1;
+
+  std::cout << rweb::colorize(rweb::GREEN) << "----COMPRESSION_SUCCESS----" << rweb::colorize(rweb::NC) << "\n";
+  return 0;
+}
@@ -0,0 +1,112 @@
+#include <RWEB.h>
+
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <atomic>
+
+#include "../common/Client.h"
+
+#define TEST_PORT 4226
+
+static bool fail(const std::string& message)
+{
+  std::cout << rweb::colorize(rweb::RED) << "TEST FAILED: " << message << rweb::colorize(rweb::NC) << "\n";
+  return false;
+}
+
+static std::string sessionCookie;
+static std::atomic<bool> released{false};
+
+static std::string request(const std::string& path, const bool keepAlive)
+{
+  return "GET " + path + " HTTP/1.1\r\nConnection: " + (keepAlive ? "keep-alive" : "close") + "\r\nCookie: " + sessionCookie + "\r\n\r\n";
+}
+
+static size_t countResponces(const std::string& res)
+{
+  size_t count = 0;
+  for (size_t pos = res.find("HTTP/1.1 "); pos != std::string::npos; pos = res.find("HTTP/1.1 ", pos + 1))
+    count++;
+  return count;
+}
+
+int main()
+{
+  if (!rweb::init(false, 1))
+  {
+    std::cout << "Failed to initialize RWEB!\n";
+    return -1;
+  }
+  rweb::setLogLevel(rweb::ERROR);
+  rweb::setPort(TEST_PORT);
+
+  //one worker and one queued request: a third request is refused
+  rweb::setWorkerThreads(1);
+  rweb::setQueueDepth(1);
+
+  rweb::addRoute("GET", "/small", [](const rweb::Request){return (rweb::HTMLTemplate)"small";});
+  rweb::addRoute("GET", "/big", [](const rweb::Request){return (rweb::HTMLTemplate)std::string(4000, 'b');});
+  rweb::addRoute("GET", "/block", [](const rweb::Request){
+    for (int i=0;i<500 && !released;++i)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    return (rweb::HTMLTemplate)"block";
+  });
+
+  std::thread th([](){
+    rweb::startServer(1);
+  });
+  th.detach();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  bool ok = true;
+  std::string res = exchange(TEST_PORT, "GET /small HTTP/1.1\r\nConnection: close\r\n\r\n");
+  const size_t cookie = res.find("sessionID=");
+  if (cookie == std::string::npos)
+    ok = fail("no session cookie");
+  else
+    sessionCookie = res.substr(cookie, res.find(';', cookie) - cookie);
+
+  //responces are not compressed unless setCompression(true) is called
+  res = ok ? exchange(TEST_PORT, "GET /big HTTP/1.1\r\nConnection: close\r\nAccept-Encoding: gzip\r\nCookie: " + sessionCookie + "\r\n\r\n") : "";
+  if (ok && (res.compare(0, 12, "HTTP/1.1 200") != 0 || res.find("Content-Encoding") != std::string::npos))
+    ok = fail("responce is compressed by default");
+
+  //requests received before a half-close are answered
+  res = ok ? exchange(TEST_PORT, {request("/small", true) + request("/small", true)}, true) : "";
+  if (countResponces(res) != 2)
+    ok = fail("pipelined requests before a half-close are not answered: " + res);
+
+  //but nothing after a responce which closes the connection
+  res = ok ? exchange(TEST_PORT, {request("/small", false) + request("/small", true)}, true) : "";
+  if (ok && (countResponces(res) != 1 || res.find("Connection: close\r\n") == std::string::npos))
+    ok = fail("request after Connection: close is answered: " + res);
+
+  //full worker queue is answered with 503 and the connection is closed
+  if (ok)
+  {
+    std::string running, queued;
+    std::thread first([&running](){ running = exchange(TEST_PORT, request("/block", false)); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::thread second([&queued](){ queued = exchange(TEST_PORT, request("/block", false)); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    res = exchange(TEST_PORT, request("/small", true)); // returns once the server closes the connection
+    released = true;
+    first.join();
+    second.join();
+
+    if (res.compare(0, 12, "HTTP/1.1 503") != 0 || res.find("Retry-After: 1\r\n") == std::string::npos
+      || res.find("Connection: close\r\n") == std::string::npos || countResponces(res) != 1)
+      ok = fail("request over the queue depth is not refused: " + res);
+    if (ok && (running.find("block") == std::string::npos || queued.find("block") == std::string::npos))
+      ok = fail("running and queued requests are not answered");
+  }
+
+  rweb::closeServer();
+  if (!ok)
+    return -1;
+
+  std::cout << rweb::colorize(rweb::GREEN) << "----CONNECTION_SUCCESS----" << rweb::colorize(rweb::NC) << "\n";
+  return 0;
+}
@@ -0,0 +1,81 @@
+#include <RWEB.h>
+#include <FileWatcher.h>
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <chrono>
+
+static std::mutex changesMutex;
+static std::set<std::pair<std::string, bool>> changes;
+
+static bool fail(const std::string& message)
+{
+  std::cout << rweb::colorize(rweb::RED) << "TEST FAILED: " << message << rweb::colorize(rweb::NC) << "\n";
+  return false;
+}
+
+//waits up to a second for the change to be reported
+static bool expectChange(const std::string& path, bool isDirectory)
+{
+  for (int i=0;i<100;++i)
+  {
+    {
+      std::lock_guard<std::mutex> lock(changesMutex);
+      if (changes.count({path, isDirectory}))
+        return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return fail("change of '" + path + "' is not reported");
+}
+
+static void writeFile(const std::string& path, const std::string& data)
+{
+  std::ofstream f(path, std::ios::out | std::ios::binary | std::ios::trunc);
+  f << data;
+}
+
+int main()
+{
+  rweb::init(false);
+
+  const std::string dir = (std::filesystem::temp_directory_path() / "rwebFileWatcherTest").string();
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir + "/css");
+  writeFile(dir + "/css/a.css", "a");
+
+  rweb::FileWatcher watcher([](const std::string& path, bool isDirectory){
+    std::lock_guard<std::mutex> lock(changesMutex);
+    changes.emplace(path, isDirectory);
+  });
+  if (!watcher.start(dir + "/"))
+  {
+    fail("watcher is not started");
+    return -1;
+  }
+
+  writeFile(dir + "/css/a.css", "changed");
+  bool ok = expectChange(dir + "/css/a.css", false);
+
+  //new directories are watched too
+  std::filesystem::create_directories(dir + "/js");
+  ok = ok && expectChange(dir + "/js", true);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  writeFile(dir + "/js/b.js", "b");
+  ok = ok && expectChange(dir + "/js/b.js", false);
+
+  std::filesystem::rename(dir + "/css/a.css", dir + "/a.css");
+  ok = ok && expectChange(dir + "/css/a.css", false) && expectChange(dir + "/a.css", false);
+
+  watcher.stop();
+  std::filesystem::remove_all(dir);
+  if (!ok)
+    return -1;
+
+  std::cout << rweb::colorize(rweb::GREEN) << "----FILE_WATCHER_SUCCESS----" << rweb::colorize(rweb::NC) << "\n";
+  return 0;
+}
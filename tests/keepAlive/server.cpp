@@ -50,7 +50,7 @@ int main()
   th.detach();
 
   {
-    System::Socket s(true);
+    System::Socket s;
     std::string request;
     std::string res;
     size_t pos;
@@ -0,0 +1,160 @@
+#include <RWEB.h>
+#include <RouteTable.h>
+
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <stdexcept>
+
+#include "../common/Client.h"
+
+#define TEST_PORT 4223
+
+static bool fail(const std::string& message)
+{
+  std::cout << rweb::colorize(rweb::RED) << "TEST FAILED: " << message << rweb::colorize(rweb::NC) << "\n";
+  return false;
+}
+
+static constexpr auto table = rweb::makeRouteTable({
+  {"GET", "/static", [](const rweb::Request){return (rweb::HTMLTemplate)"static get";}},
+  {"DELETE", "/static", [](const rweb::Request){return (rweb::HTMLTemplate)"static delete";}},
+});
+
+static std::string sessionCookie;
+
+static std::string send(const std::string& method, const std::string& path, const std::string& body="")
+{
+  std::string request = method + " " + path + " HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n";
+  if (!sessionCookie.empty())
+    request += "Cookie: " + sessionCookie + "\r\n";
+  if (!body.empty())
+    request += "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: " + std::to_string(body.size()) + "\r\n";
+  return exchange(TEST_PORT, request + "\r\n" + body);
+}
+
+//expects the responce to start with 'status' and contain 'part'
+static bool expect(const std::string& method, const std::string& path, const std::string& status, const std::string& part, const std::string& body="")
+{
+  const std::string res = send(method, path, body);
+  if (res.compare(0, status.size(), status) != 0)
+    return fail(method + " " + path + " returned '" + res.substr(0, res.find("\r\n")) + "'");
+  if (res.find(part) == std::string::npos)
+    return fail(method + " " + path + " does not contain '" + part + "'");
+  return true;
+}
+
+int main()
+{
+  if (!rweb::init(false, 1))
+  {
+    std::cout << "Failed to initialize RWEB!\n";
+    return -1;
+  }
+  rweb::setLogLevel(rweb::ERROR);
+  rweb::setPort(TEST_PORT);
+  rweb::setCompression(true);
+
+  rweb::addRoute("GET", "/item/<id>", [](const rweb::Request r){return (rweb::HTMLTemplate)("get " + r.args[0]);});
+  rweb::addRoute("PUT", "/item/<id>", [](const rweb::Request r){return (rweb::HTMLTemplate)("put " + r.args[0] + "=" + r.body.at("v"));});
+  rweb::addRoute("DELETE", "/item/<id>", [](const rweb::Request r){return (rweb::HTMLTemplate)("delete " + r.args[0]);});
+  rweb::addRoute("GET", "/num/<int:n>", [](const rweb::Request r){return (rweb::HTMLTemplate)("num " + std::to_string(r.getIntArg(0) * 2));});
+  rweb::setRouteTable(table);
+  //paths of the route table win over streaming routes, their bodies are not streamed
+  rweb::addRoute("PUT", "/static", [](const rweb::Request, rweb::BodyReader&){return (rweb::HTMLTemplate)"stream put";});
+  rweb::addRoute("/any", [](const rweb::Request r){return (rweb::HTMLTemplate)("any " + r.method);});
+  rweb::addRoute("GET", "/big", [](const rweb::Request){return (rweb::HTMLTemplate)std::string(4000, 'b');});
+  rweb::addRoute("GET", "/big/raw", [](const rweb::Request){
+    rweb::HTMLTemplate temp = std::string(4000, 'b');
+    temp.compress = false;
+    return temp;
+  });
+
+  std::thread th([](){
+    rweb::startServer(4);
+  });
+  th.detach();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  //the first request creates the session
+  const std::string first = send("GET", "/any");
+  const size_t cookie = first.find("sessionID=");
+  if (cookie == std::string::npos)
+  {
+    fail("no session cookie");
+    rweb::closeServer();
+    return -1;
+  }
+  sessionCookie = first.substr(cookie, first.find(';', cookie) - cookie);
+
+  bool ok = expect("GET", "/item/5", "HTTP/1.1 200", "get 5")
+    && expect("PUT", "/item/5", "HTTP/1.1 200", "put 5=7", "v=7")
+    && expect("DELETE", "/item/5", "HTTP/1.1 200", "delete 5")
+    && expect("POST", "/item/5", "HTTP/1.1 405", "Allow: GET, HEAD, PUT, DELETE, OPTIONS\r\n", "v=7")
+    && expect("OPTIONS", "/item/5", "HTTP/1.1 204", "Allow: GET, HEAD, PUT, DELETE, OPTIONS\r\n")
+    && expect("PATCH", "/any", "HTTP/1.1 200", "any PATCH", "v=7")
+    && expect("GET", "/nothing", "HTTP/1.1 404", "")
+    && expect("GET", "/num/-21", "HTTP/1.1 200", "num -42")
+    && expect("GET", "/num/abc", "HTTP/1.1 404", "")
+    && expect("GET", "/static", "HTTP/1.1 200", "static get")
+    && expect("DELETE", "/static", "HTTP/1.1 200", "static delete")
+    && expect("PUT", "/static", "HTTP/1.1 405", "Allow: GET, HEAD, DELETE, OPTIONS\r\n", "v=7");
+  //body of the table path is read whole, the connection is kept for the next request
+  const std::string pipelined = ok ? exchange(TEST_PORT, {"PUT /static HTTP/1.1\r\nCookie: " + sessionCookie + "\r\nContent-Type: application/x-www-form-urlencoded\r\n"
+    "Content-Length: 3\r\n\r\n", "v=7GET /static HTTP/1.1\r\nConnection: close\r\nCookie: " + sessionCookie + "\r\n\r\n"}) : "";
+  if (ok && (pipelined.compare(0, 12, "HTTP/1.1 405") != 0 || pipelined.find("static get") == std::string::npos))
+    ok = fail("table path is streamed");
+
+  if (!ok)
+  {
+    rweb::closeServer();
+    return -1;
+  }
+
+  //routes can be changed while the server is running
+  rweb::updateRoutes([](){
+    rweb::addRoute("GET", "/late", [](const rweb::Request){return (rweb::HTMLTemplate)"late";});
+    rweb::setErrorHandler(404, [](const rweb::Request){return (rweb::HTMLTemplate)"custom 404";});
+  });
+  //an update which throws does not hold back later changes
+  try
+  {
+    rweb::updateRoutes([](){ throw std::runtime_error("update failed"); });
+  } catch (const std::runtime_error&) {}
+  rweb::addRoute("GET", "/after", [](const rweb::Request){return (rweb::HTMLTemplate)"after";});
+  if (!expect("GET", "/late", "HTTP/1.1 200", "late") || !expect("GET", "/nothing", "HTTP/1.1 200", "custom 404")
+    || !expect("GET", "/item/5", "HTTP/1.1 200", "get 5") || !expect("GET", "/after", "HTTP/1.1 200", "after"))
+  {
+    rweb::closeServer();
+    return -1;
+  }
+
+  //HEAD has the headers of GET without the body
+  const std::string head = send("HEAD", "/item/5");
+  if (head.compare(0, 12, "HTTP/1.1 200") != 0 || head.find("Content-Length: 5\r\n") == std::string::npos
+    || head.size() != head.find("\r\n\r\n") + 4)
+  {
+    fail("HEAD responce is wrong");
+    rweb::closeServer();
+    return -1;
+  }
+
+  //bodies are compressed if the client accepts it, unless the route opts out
+  const std::string compressed = exchange(TEST_PORT, "GET /big HTTP/1.1\r\nConnection: close\r\nAccept-Encoding: br, gzip\r\nCookie: " + sessionCookie + "\r\n\r\n");
+  const std::string raw = exchange(TEST_PORT, "GET /big/raw HTTP/1.1\r\nConnection: close\r\nAccept-Encoding: gzip\r\nCookie: " + sessionCookie + "\r\n\r\n");
+  const std::string plain = send("GET", "/big");
+  if (compressed.find("Content-Encoding: gzip\r\n") == std::string::npos || compressed.find("Vary: Accept-Encoding\r\n") == std::string::npos
+    || compressed.size() - compressed.find("\r\n\r\n") > 200 || raw.find("Content-Encoding") != std::string::npos
+    || raw.find("Content-Length: 4000\r\n") == std::string::npos || plain.find("Content-Encoding") != std::string::npos
+    || plain.find("Vary: Accept-Encoding\r\n") == std::string::npos || send("GET", "/item/5").find("Vary") != std::string::npos)
+  {
+    fail("compression is wrong");
+    rweb::closeServer();
+    return -1;
+  }
+
+  rweb::closeServer();
+  std::cout << rweb::colorize(rweb::GREEN) << "----METHODS_SUCCESS----" << rweb::colorize(rweb::NC) << "\n";
+  return 0;
+}
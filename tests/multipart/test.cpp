@@ -0,0 +1,160 @@
+#include <RWEB.h>
+#include <Multipart.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+static bool fail(const std::string& message)
+{
+  std::cout << rweb::colorize(rweb::RED) << "TEST FAILED: " << message << rweb::colorize(rweb::NC) << "\n";
+  return false;
+}
+
+static const std::string boundary = "----RWEBBoundary7MA4YWxkTrZu0gW";
+
+static std::string makeBody(const std::string& file)
+{
+  return "preamble is ignored\r\n"
+    "--" + boundary + "\r\n"
+    "Content-Disposition: form-data; name=\"title\"\r\n\r\n"
+    "hello\r\n--not the boundary\r\n"
+    "--" + boundary + "\r\n"
+    "Content-Disposition: form-data; name=\"upload\"; filename=\"a b.bin\"\r\n"
+    "Content-Type: application/octet-stream\r\n\r\n" +
+    file + "\r\n"
+    "--" + boundary + "\r\n"
+    "Content-Disposition: form-data; name=\"empty\"\r\n\r\n"
+    "\r\n"
+    "--" + boundary + "--\r\nepilogue";
+}
+
+//collects everything the parser reports
+class Recorder : public rweb::MultipartParser::Handler
+{
+public:
+  bool onPartBegin(std::string_view headers) override
+  {
+    log += "[begin " + std::string(headers) + "]";
+    return true;
+  }
+
+  bool onPartData(std::string_view data) override
+  {
+    log += data;
+    return true;
+  }
+
+  bool onPartEnd() override
+  {
+    log += "[end]";
+    return true;
+  }
+
+  std::string log;
+};
+
+//every split of the body must give the same result as the whole body
+static bool testSplits(const std::string& body)
+{
+  std::string expected;
+  {
+    rweb::MultipartParser parser(boundary);
+    Recorder r;
+    if (parser.feed(body, r) != rweb::MultipartParser::COMPLETE)
+      return fail("body is not complete");
+    expected = r.log;
+  }
+
+  for (size_t step : {1, 2, 3, 5, 17, 31, 32, 33, 64, 100})
+  {
+    rweb::MultipartParser parser(boundary);
+    Recorder r;
+    rweb::MultipartParser::Result res = rweb::MultipartParser::INCOMPLETE;
+    for (size_t i=0;i<body.size() && res == rweb::MultipartParser::INCOMPLETE;i+=step)
+      res = parser.feed(std::string(body.substr(i, step)), r); // copy: views must not outlive the piece
+    if (res != rweb::MultipartParser::COMPLETE || r.log != expected)
+      return fail("split body mismatch (step " + std::to_string(step) + ")");
+  }
+  return true;
+}
+
+static bool testParse(const std::string& body, const std::string& file)
+{
+  std::vector<rweb::FormPart> parts;
+  if (!rweb::parseMultipart(body, boundary, parts))
+    return fail("parseMultipart failed");
+
+  if (parts.size() != 3)
+    return fail("wrong part count");
+  if (parts[0].name != "title" || parts[0].data != "hello\r\n--not the boundary" || !parts[0].filename.empty())
+    return fail("wrong field part");
+  if (parts[1].name != "upload" || parts[1].filename != "a b.bin" || parts[1].contentType != "application/octet-stream" || parts[1].data != file)
+    return fail("wrong file part");
+  if (parts[2].name != "empty" || !parts[2].data.empty())
+    return fail("wrong empty part");
+
+  //zero-copy: data points into the body
+  if (parts[1].data.data() < body.data() || parts[1].data.data() >= body.data() + body.size())
+    return fail("part data is copied");
+
+  std::vector<rweb::FormPart> bad;
+  if (rweb::parseMultipart(body.substr(0, body.size() - 20), boundary, bad))
+    return fail("truncated body is accepted");
+  return true;
+}
+
+static bool testSpill(const std::string& body, const std::string& file)
+{
+  rweb::BodyReader reader(1 << 20, nullptr);
+  for (size_t i=0;i<body.size();i+=4096)
+    reader.push(body.substr(i, 4096));
+  reader.finish();
+
+  std::vector<rweb::FormPart> parts;
+  if (!rweb::readMultipart(reader, boundary, parts, 1000))
+    return fail("readMultipart failed");
+  if (parts.size() != 3 || parts[0].data != "hello\r\n--not the boundary")
+    return fail("wrong streamed field");
+
+  const rweb::FormPart& upload = parts[1];
+  if (!upload.file || !upload.data.empty() || upload.size != file.size() || upload.filename != "a b.bin")
+    return fail("file part is not spilled");
+
+  const std::string path = upload.file->getPath();
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  if (ss.str() != file)
+    return fail("spilled file content mismatch");
+
+  parts.clear();
+  if (std::ifstream(path).good())
+    return fail("temp file is not removed");
+  return true;
+}
+
+int main()
+{
+  rweb::init(false);
+
+  std::string file;
+  for (int i=0;i<50000;++i)
+    file += (char)(i * 7 % 256);
+  file += "\r\n--" + boundary.substr(0, 10); // almost a delimiter
+
+  const std::string body = makeBody(file);
+
+  if (rweb::getBoundary("multipart/form-data; boundary=\"" + boundary + "\"") != boundary)
+  {
+    fail("quoted boundary is not found");
+    return -1;
+  }
+
+  if (!testSplits(body) || !testParse(body, file) || !testSpill(body, file))
+    return -1;
+
+  std::cout << rweb::colorize(rweb::GREEN) << "----MULTIPART_SUCCESS----" << rweb::colorize(rweb::NC) << "\n";
+  return 0;
+}
@@ -0,0 +1,192 @@
+#include <RWEB.h>
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <thread>
+#include <chrono>
+
+#include "../common/Client.h"
+
+#define TEST_PORT 4224
+
+static bool fail(const std::string& message)
+{
+  std::cout << rweb::colorize(rweb::RED) << "TEST FAILED: " << message << rweb::colorize(rweb::NC) << "\n";
+  return false;
+}
+
+static std::string get(const std::string& path, const std::string& headers="")
+{
+  return exchange(TEST_PORT, "GET " + path + " HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n" + headers + "\r\n");
+}
+
+static std::string body(const std::string& res)
+{
+  const size_t end = res.find("\r\n\r\n");
+  return end == std::string::npos ? std::string{} : res.substr(end + 4);
+}
+
+//value of the header 'name' in the responce 'res'
+static std::string header(const std::string& res, const std::string& name)
+{
+  const size_t start = res.find("\r\n" + name + ": ");
+  if (start == std::string::npos)
+    return std::string{};
+  const size_t value = start + name.size() + 4;
+  return res.substr(value, res.find("\r\n", value) - value);
+}
+
+//checks conditional requests of one file. 'data' is the content of the file
+static bool checkConditional(const std::string& path, const std::string& data)
+{
+  std::string res = get(path);
+  const std::string etag = header(res, "ETag"), modified = header(res, "Last-Modified");
+  if (res.compare(0, 12, "HTTP/1.1 200") != 0 || etag.empty() || modified.empty())
+    return fail(path + ": validators are not sent");
+
+  //304 has no body but the same validators
+  res = get(path, "If-None-Match: \"other\", W/" + etag + "\r\n");
+  if (res.compare(0, 12, "HTTP/1.1 304") != 0 || !body(res).empty() || header(res, "ETag") != etag || header(res, "Last-Modified") != modified)
+    return fail(path + ": weak ETag in a list is not matched");
+  res = get(path, "If-None-Match: *\r\n");
+  if (res.compare(0, 12, "HTTP/1.1 304") != 0)
+    return fail(path + ": * is not matched");
+
+  res = get(path, "If-Modified-Since: " + modified + "\r\n");
+  if (res.compare(0, 12, "HTTP/1.1 304") != 0 || header(res, "ETag") != etag)
+    return fail(path + ": If-Modified-Since is ignored");
+  res = get(path, "If-Modified-Since: Sun, 06 Nov 1994 08:49:37 GMT\r\n");
+  if (res.compare(0, 12, "HTTP/1.1 200") != 0 || body(res) != data)
+    return fail(path + ": modified file is not sent");
+
+  //If-Modified-Since is not used when If-None-Match is present
+  res = get(path, "If-None-Match: \"other\"\r\nIf-Modified-Since: " + modified + "\r\n");
+  if (res.compare(0, 12, "HTTP/1.1 200") != 0 || body(res) != data)
+    return fail(path + ": If-Modified-Since wins over If-None-Match");
+  return true;
+}
+
+//checks ranges of one file. 'data' is the content of the file
+static bool checkRanges(const std::string& path, const std::string& data)
+{
+  std::string res = get(path, "Range: bytes=10-19\r\n");
+  if (res.compare(0, 12, "HTTP/1.1 206") != 0 || body(res) != data.substr(10, 10)
+    || res.find("Content-Range: bytes 10-19/" + std::to_string(data.size()) + "\r\n") == std::string::npos)
+    return fail(path + ": single range is wrong");
+
+  res = get(path, "Range: bytes=-5\r\n");
+  if (res.compare(0, 12, "HTTP/1.1 206") != 0 || body(res) != data.substr(data.size() - 5))
+    return fail(path + ": suffix range is wrong");
+
+  res = get(path, "Range: bytes=" + std::to_string(data.size() - 3) + "-\r\n");
+  if (res.compare(0, 12, "HTTP/1.1 206") != 0 || body(res) != data.substr(data.size() - 3))
+    return fail(path + ": open range is wrong");
+
+  //overlapping ranges are merged
+  res = get(path, "Range: bytes=50-59, 0-4,2-6\r\n");
+  const size_t boundary = res.find("boundary=");
+  if (res.compare(0, 12, "HTTP/1.1 206") != 0 || boundary == std::string::npos)
+    return fail(path + ": multiple ranges are not multipart");
+  const std::string separator = "\r\n--" + res.substr(boundary + 9, res.find("\r\n", boundary) - boundary - 9);
+  const std::string expected = separator + "\r\nContent-Type: text/plain\r\nContent-Range: bytes 0-6/" + std::to_string(data.size()) + "\r\n\r\n" + data.substr(0, 7)
+    + separator + "\r\nContent-Type: text/plain\r\nContent-Range: bytes 50-59/" + std::to_string(data.size()) + "\r\n\r\n" + data.substr(50, 10)
+    + separator + "--\r\n";
+  if (body(res) != expected || res.find("Content-Length: " + std::to_string(expected.size()) + "\r\n") == std::string::npos)
+    return fail(path + ": multipart body is wrong");
+
+  res = get(path, "Range: bytes=" + std::to_string(data.size()) + "-\r\n");
+  if (res.compare(0, 12, "HTTP/1.1 416") != 0 || res.find("Content-Range: bytes */" + std::to_string(data.size()) + "\r\n") == std::string::npos)
+    return fail(path + ": unsatisfiable range is not 416");
+
+  //invalid ranges and outdated If-Range get the whole file
+  res = get(path, "Range: bytes=9-2\r\n");
+  if (res.compare(0, 12, "HTTP/1.1 200") != 0 || body(res) != data)
+    return fail(path + ": invalid range is not ignored");
+  res = get(path, "Range: bytes=99999999999999999999999-\r\n");
+  if (res.compare(0, 12, "HTTP/1.1 200") != 0 || body(res) != data)
+    return fail(path + ": overflowing range is not ignored");
+  res = get(path, "Range: bytes=0-0\r\nIf-Range: \"old\"\r\n");
+  if (res.compare(0, 12, "HTTP/1.1 200") != 0 || body(res) != data || res.find("Accept-Ranges: bytes\r\n") == std::string::npos)
+    return fail(path + ": outdated If-Range is not ignored");
+
+  res = get(path, "Range: bytes=0-0\r\nIf-Range: " + header(res, "ETag") + "\r\n");
+  if (res.compare(0, 12, "HTTP/1.1 206") != 0 || body(res) != data.substr(0, 1))
+    return fail(path + ": matching If-Range is ignored");
+  return true;
+}
+
+//precompressed siblings are sent if the client accepts them
+static bool checkEncodings()
+{
+  std::string res = get("/small.txt", "Accept-Encoding: gzip, deflate, br;q=0\r\n");
+  if (res.compare(0, 12, "HTTP/1.1 200") != 0 || body(res) != "gzip body" || res.find("Content-Encoding: gzip\r\n") == std::string::npos
+    || res.find("Vary: Accept-Encoding\r\n") == std::string::npos)
+    return fail("gzip sibling is not sent");
+
+  res = get("/small.txt", "Accept-Encoding: gzip;q=0.5, BR\r\n");
+  if (body(res) != "br body" || res.find("Content-Encoding: br\r\n") == std::string::npos)
+    return fail("brotli sibling is not sent");
+
+  res = get("/small.txt", "Accept-Encoding: *;q=0.1, gzip;q=0\r\n");
+  if (body(res) != "br body")
+    return fail("wildcard encoding is ignored");
+
+  res = get("/small.txt", "Accept-Encoding: identity\r\n");
+  if (res.find("Content-Encoding") != std::string::npos || res.find("Vary: Accept-Encoding\r\n") == std::string::npos)
+    return fail("identity responce is wrong");
+
+  //304 of a file with siblings varies too
+  res = get("/small.txt", "Accept-Encoding: identity\r\nIf-None-Match: " + header(res, "ETag") + "\r\n");
+  if (res.compare(0, 12, "HTTP/1.1 304") != 0 || res.find("Vary: Accept-Encoding\r\n") == std::string::npos)
+    return fail("304 of a file with siblings has no Vary");
+  return true;
+}
+
+int main()
+{
+  if (!rweb::init(false, 1))
+  {
+    std::cout << "Failed to initialize RWEB!\n";
+    return -1;
+  }
+  rweb::setLogLevel(rweb::ERROR);
+  rweb::setPort(TEST_PORT);
+
+  const std::string dir = (std::filesystem::temp_directory_path() / "rwebRangesTest").string();
+  std::filesystem::create_directories(dir);
+  std::string small, big;
+  for (int i=0;i<100;++i)
+    small += (char)('a' + i % 26);
+  for (int i=0;i<1000;++i)
+    big += (char)('0' + i % 10);
+  std::ofstream(dir + "/small.txt", std::ios::binary) << small;
+  std::ofstream(dir + "/big.txt", std::ios::binary) << big;
+
+  //the big file is not cached, it is sent with sendfile
+  rweb::setResourceCacheSize(400);
+  rweb::setResourcePath(dir);
+  rweb::addResource("/small.txt", "small.txt", "text/plain");
+  rweb::addResource("/big.txt", "big.txt", "text/plain");
+
+  std::thread th([](){
+    rweb::startServer(4);
+  });
+  th.detach();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  bool ok = checkRanges("/small.txt", small) && checkRanges("/big.txt", big)
+    && checkConditional("/small.txt", small) && checkConditional("/big.txt", big);
+
+  std::ofstream(dir + "/small.txt.gz", std::ios::binary) << "gzip body";
+  std::ofstream(dir + "/small.txt.br", std::ios::binary) << "br body";
+  std::this_thread::sleep_for(std::chrono::milliseconds(100)); // file watcher drops the cached file
+  ok = ok && checkEncodings();
+  rweb::closeServer();
+  std::filesystem::remove_all(dir);
+  if (!ok)
+    return -1;
+
+  std::cout << rweb::colorize(rweb::GREEN) << "----RANGES_SUCCESS----" << rweb::colorize(rweb::NC) << "\n";
+  return 0;
+}
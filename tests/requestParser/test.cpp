@@ -0,0 +1,296 @@
+#include <RWEB.h>
+#include <HTTPParser.h>
+#include <Scanner.h>
+#include <BodyReader.h>
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+
+static bool fail(const std::string& message)
+{
+  std::cout << rweb::colorize(rweb::RED) << "TEST FAILED: " << message << rweb::colorize(rweb::NC) << "\n";
+  return false;
+}
+
+//feeds 'request' to the parser 'step' bytes at a time
+static bool testIncremental(const std::string& request, size_t step)
+{
+  rweb::RequestParser parser;
+  rweb::RequestParser::Result res = rweb::RequestParser::INCOMPLETE;
+  std::string buffer;
+  for (size_t i=0;i<request.size();i+=step)
+  {
+    buffer += request.substr(i, step);
+    res = parser.parse(buffer);
+    if (res != rweb::RequestParser::INCOMPLETE && buffer.size() < request.size() - 5)
+      return fail("parser finished too early (step " + std::to_string(step) + ")");
+  }
+
+  if (res != rweb::RequestParser::COMPLETE)
+    return fail("request is not complete (step " + std::to_string(step) + ")");
+
+  if (parser.method.in(buffer) != "POST" || parser.target.in(buffer) != "/form?a=1" || parser.protocol.in(buffer) != "HTTP/1.1")
+    return fail("bad request line");
+
+  if (parser.headers.size() != 4)
+    return fail("expected 4 headers, got " + std::to_string(parser.headers.size()));
+
+  if (parser.getHeader(buffer, "host") != "localhost:4221")
+    return fail("bad Host header");
+
+  if (parser.getHeader(buffer, "X-Padded") != "value with\tinner space")
+    return fail("header value is not trimmed: '" + std::string(parser.getHeader(buffer, "X-Padded")) + "'");
+
+  if (!parser.getHeader(buffer, "X-Empty").empty())
+    return fail("empty header has a value");
+
+  if (buffer.substr(parser.getHeadSize()) != "a=1")
+    return fail("body does not start after the head");
+
+  return true;
+}
+
+static bool testChunked()
+{
+  const std::string head = "POST /up HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n";
+  const std::string request = head + "5;name=value\r\nhello\r\n1A\r\nabcdefghijklmnopqrstuvwxyz\r\n0\r\nX-Trailer: 1\r\n\r\nGET / HTTP/1.1";
+
+  //feed byte by byte: decoding must resume anywhere
+  std::string buffer;
+  rweb::RequestParser parser;
+  rweb::BodyDecoder decoder;
+  bool started = false;
+  rweb::BodyDecoder::Result res = rweb::BodyDecoder::INCOMPLETE;
+  for (size_t i=0;i<request.size() && res == rweb::BodyDecoder::INCOMPLETE;++i)
+  {
+    buffer += request[i];
+    if (!started)
+    {
+      if (parser.parse(buffer) != rweb::RequestParser::COMPLETE)
+        continue;
+      if (decoder.start(buffer, parser, 1024) != rweb::BodyDecoder::INCOMPLETE || !decoder.isChunked())
+        return fail("chunked framing is not detected");
+      started = true;
+    }
+    res = decoder.decode(buffer);
+  }
+
+  if (res != rweb::BodyDecoder::COMPLETE)
+    return fail("chunked body is not complete");
+
+  if (buffer.substr(0, decoder.getDecodedEnd()) != head + "helloabcdefghijklmnopqrstuvwxyz")
+    return fail("bad decoded body: " + buffer.substr(head.size(), decoder.getDecodedEnd() - head.size()));
+
+  if (decoder.getConsumedEnd() != buffer.size())
+    return fail("decoder consumed bytes of the next request");
+
+  {
+    rweb::RequestParser p;
+    std::string tooLarge = head + "401\r\n";
+    p.parse(tooLarge);
+    rweb::BodyDecoder d;
+    d.start(tooLarge, p, 1024);
+    if (d.decode(tooLarge) != rweb::BodyDecoder::TOO_LARGE)
+      return fail("chunk over the body limit is accepted");
+  }
+
+  {
+    rweb::RequestParser p;
+    std::string noLength = "POST / HTTP/1.1\r\nHost: x\r\n\r\n";
+    p.parse(noLength);
+    rweb::BodyDecoder d;
+    if (d.start(noLength, p, 1024) != rweb::BodyDecoder::LENGTH_REQUIRED)
+      return fail("POST without length is accepted");
+  }
+
+  //ignored framing bytes are limited even without a body limit
+  const std::string endless[] = {head + "1;" + std::string(70000, 'x'), head + "0\r\nX-Trailer: " + std::string(70000, 'x')};
+  for (const std::string& framing : endless)
+  {
+    rweb::RequestParser p;
+    std::string request = framing;
+    p.parse(request);
+    rweb::BodyDecoder d;
+    d.start(request, p, 0);
+    if (d.decode(request) != rweb::BodyDecoder::TOO_LARGE)
+      return fail("endless chunk extension or trailer is accepted");
+  }
+
+  //only bare chunked is decoded, and never together with Content-Length
+  const std::pair<std::string, rweb::BodyDecoder::Result> framings[] = {
+    {"Transfer-Encoding: gzip, chunked\r\n", rweb::BodyDecoder::NOT_IMPLEMENTED},
+    {"Transfer-Encoding: gzip\r\nTransfer-Encoding: chunked\r\n", rweb::BodyDecoder::NOT_IMPLEMENTED},
+    {"Transfer-Encoding: chunked\r\nContent-Length: 5\r\n", rweb::BodyDecoder::INVALID},
+    {"Content-Length: 5\r\nTransfer-Encoding: Chunked \r\n", rweb::BodyDecoder::INVALID},
+  };
+  for (const auto& framing : framings)
+  {
+    rweb::RequestParser p;
+    std::string request = "POST / HTTP/1.1\r\nHost: x\r\n" + framing.first + "\r\n";
+    p.parse(request);
+    rweb::BodyDecoder d;
+    if (d.start(request, p, 1024) != framing.second)
+      return fail("wrong framing is accepted: " + framing.first);
+  }
+
+  return true;
+}
+
+//decodes a chunked body part by part like a streaming route and reads it on another thread
+static bool testStream()
+{
+  const std::string head = "POST /up HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n";
+  std::string encoded;
+  std::string expected;
+  for (int i=0;i<200;++i)
+  {
+    const std::string part(100 + i, (char)('a' + i % 26));
+    char size[16];
+    snprintf(size, sizeof(size), "%x\r\n", (unsigned)part.size());
+    encoded += size + part + "\r\n";
+    expected += part;
+  }
+  encoded += "0\r\n\r\n";
+
+  std::string buffer = head;
+  rweb::RequestParser p;
+  p.parse(buffer);
+  rweb::BodyDecoder d;
+  d.start(buffer, p, 0);
+
+  std::atomic<int> resumed{0};
+  rweb::BodyReader reader(1000, [&resumed](){ resumed++; });
+  std::string received;
+  std::thread consumer([&](){
+    char part[333];
+    size_t n;
+    while ((n = reader.read(part, sizeof(part))) > 0)
+      received.append(part, n);
+  });
+
+  rweb::BodyDecoder::Result res = rweb::BodyDecoder::INCOMPLETE;
+  for (size_t i=0;i<encoded.size() && res == rweb::BodyDecoder::INCOMPLETE;i+=997)
+  {
+    while (reader.isFull())
+      std::this_thread::yield();
+    buffer += encoded.substr(i, 997);
+    res = d.decode(buffer);
+    reader.push(d.takeBody(buffer));
+  }
+  reader.finish();
+  consumer.join();
+
+  if (res != rweb::BodyDecoder::COMPLETE)
+    return fail("streamed body is not complete");
+  if (!buffer.empty())
+    return fail("consumed bytes are left in the buffer");
+  if (received != expected || !reader.isComplete() || reader.getBytesRead() != expected.size())
+    return fail("streamed body mismatch");
+  return true;
+}
+
+static bool testQuery()
+{
+  rweb::Request r;
+  r.query = "a=1&name=J%C3%B6rg+M&flag&a%20b=%2F&&last=";
+  if (r.getQueryParam("a") != "1" || r.getQueryParam("name") != "J\xC3\xB6rg M")
+    return fail("wrong query value");
+  if (r.getQueryParam("flag") != "" || r.getQueryParam("last") != "" || r.getQueryParam("a b") != "/")
+    return fail("wrong special query value");
+  if (r.getQueryParam("missing") || r.getQueryParams().size() != 5)
+    return fail("wrong query parameters");
+  if (rweb::urlDecode("100%+%zz%4") != "100% %zz%4")
+    return fail("malformed escapes are not kept");
+  return true;
+}
+
+static bool testScanner()
+{
+  //every stop class must give the same result as a plain loop, on every alignment
+  std::string data;
+  for (int i=0;i<300;++i)
+    data += (char)('a' + i % 26);
+
+  const char specials[] = {' ', ':', '\r', '\n', '\t', (char)0x7f, (char)0x01, (char)0xC3};
+  for (char special : specials)
+  {
+    for (size_t pos=0;pos<100;++pos)
+    {
+      std::string s = data;
+      s[pos + 70] = special;
+      const unsigned char c = special;
+      const size_t expectedNonToken = (c <= 0x20 || c >= 0x7f) ? pos + 70 : s.size();
+      const size_t expectedControl = ((c < 0x20 && c != '\t') || c == 0x7f) ? pos + 70 : s.size();
+
+      if (rweb::scanFor(s, pos, rweb::SCAN_NONTOKEN) != expectedNonToken)
+        return fail("SCAN_NONTOKEN mismatch");
+      if (rweb::scanFor(s, pos, rweb::SCAN_CONTROL) != expectedControl)
+        return fail("SCAN_CONTROL mismatch");
+      if (rweb::scanFor(s, pos, rweb::SCAN_COLON) != (special == ':' ? pos + 70 : s.size()))
+        return fail("SCAN_COLON mismatch");
+    }
+  }
+
+  for (size_t pos=0;pos<100;++pos)
+  {
+    std::string s = data;
+    s.replace(pos + 40, 4, "\r\n\r\n");
+    s[pos + 10] = '\r'; // lone CR must be skipped
+    if (rweb::findHeaderEnd(s) != pos + 40)
+      return fail("findHeaderEnd mismatch");
+  }
+
+  if (rweb::findHeaderEnd(data) != std::string_view::npos)
+    return fail("findHeaderEnd found a terminator in plain data");
+
+  std::cout << "[SCANNER] kernel: " << rweb::getScannerKernel() << "\n";
+  return true;
+}
+
+int main()
+{
+  rweb::init(false);
+
+  const std::string request = "\r\nPOST /form?a=1 HTTP/1.1\r\nHost: localhost:4221\r\nX-Padded:   value with\tinner space  \t\r\n"
+    "X-Empty:\r\nContent-Type: application/x-www-form-urlencoded\r\n\r\na=1";
+
+  for (size_t step : {1, 2, 3, 7, 16, 1000})
+  {
+    if (!testIncremental(request, step))
+      return -1;
+  }
+
+  {
+    rweb::RequestParser parser;
+    if (parser.parse("GET / HTTP/1.1\r\nBad Header: x\r\n\r\n") != rweb::RequestParser::INVALID)
+    {
+      fail("whitespace in header name is accepted");
+      return -1;
+    }
+  }
+
+  {
+    rweb::RequestParser parser(64);
+    if (parser.parse("GET / HTTP/1.1\r\nX-Long: " + std::string(100, 'a') + "\r\n\r\n") != rweb::RequestParser::TOO_LARGE)
+    {
+      fail("head over the limit is accepted");
+      return -1;
+    }
+  }
+
+  if (!testChunked())
+    return -1;
+
+  if (!testStream())
+    return -1;
+
+  if (!testQuery())
+    return -1;
+
+  if (!testScanner())
+    return -1;
+
+  std::cout << rweb::colorize(rweb::GREEN) << "----PARSER_SUCCESS----" << rweb::colorize(rweb::NC) << "\n";
+  return 0;
+}
@@ -0,0 +1,117 @@
+#include <RWEB.h>
+#include <ResourceCache.h>
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <chrono>
+
+static bool fail(const std::string& message)
+{
+  std::cout << rweb::colorize(rweb::RED) << "TEST FAILED: " << message << rweb::colorize(rweb::NC) << "\n";
+  return false;
+}
+
+static void writeFile(const std::string& path, const std::string& data)
+{
+  std::ofstream f(path, std::ios::out | std::ios::binary | std::ios::trunc);
+  f << data;
+}
+
+int main()
+{
+  rweb::init(false);
+
+  const std::string dir = (std::filesystem::temp_directory_path() / "rwebResourceCacheTest").string();
+  std::filesystem::create_directories(dir);
+  const std::string a = dir + "/a.css", b = dir + "/b.css", c = dir + "/c.css", big = dir + "/big.bin";
+  writeFile(a, std::string(100, 'a'));
+  writeFile(b, std::string(100, 'b'));
+  writeFile(c, std::string(100, 'c'));
+  writeFile(big, std::string(300, 'x'));
+
+  rweb::ResourceCache cache(1000);
+  bool ok = true;
+
+  auto file = cache.get(a, "text/css");
+  if (!file || file->data != std::string(100, 'a') || file->headers != "Content-Type: text/css\r\nContent-Length: 100\r\n" + file->validators)
+    ok = fail("file is read wrong");
+  if (ok && (file->etag.size() != 18 || file->validators.find("ETag: " + file->etag + "\r\nLast-Modified: ") != 0))
+    ok = fail("validators are wrong");
+  const std::string etag = ok ? file->etag : "";
+
+  //cached files are not read again
+  writeFile(a, "changed");
+  if (ok && cache.get(a, "text/css")->data != std::string(100, 'a'))
+    ok = fail("cached file is read again");
+
+  cache.invalidate(a);
+  if (ok && cache.get(a, "text/css")->data != "changed")
+    ok = fail("invalidated file is not read again");
+  if (ok && cache.get(a, "text/css")->etag == etag)
+    ok = fail("ETag is not changed with the content");
+
+  auto open = cache.get(big, "application/octet-stream", true);
+  if (ok && (!open || !open->file || !open->data.empty() || open->size != 300 || open->etag.empty()))
+    ok = fail("large file is not returned open");
+
+  //same size, modified again within the same second
+  {
+    const auto second = std::chrono::floor<std::chrono::seconds>(std::filesystem::last_write_time(big));
+    std::filesystem::last_write_time(big, second + std::chrono::milliseconds(100));
+    const auto before = cache.get(big, "application/octet-stream", true);
+    std::filesystem::last_write_time(big, second + std::chrono::milliseconds(200));
+    const auto after = cache.get(big, "application/octet-stream", true);
+    if (ok && (!before || !after || before->etag == after->etag))
+      ok = fail("ETag of an open file misses a change within the same second");
+  }
+
+  if (ok && (!cache.get(big, "application/octet-stream") || cache.getSize() != 7))
+    ok = fail("file larger than a quarter of the cache is kept");
+
+  if (ok && (cache.get(dir + "/missing", "text/css") || cache.getSize() != 7))
+    ok = fail("missing file is returned");
+
+  //'a' is used last -> 'b' is evicted first
+  cache.get(b, "text/css");
+  cache.get(c, "text/css");
+  cache.get(a, "text/css");
+  writeFile(a, "a2");
+  writeFile(b, "b2");
+  writeFile(c, "c2");
+  cache.setCapacity(150);
+  if (ok && (cache.getSize() != 107 || cache.get(b, "text/css")->data != "b2"))
+    ok = fail("least recently used file is not evicted");
+
+  //precompressed siblings are loaded with the file and counted in the size
+  cache.clear();
+  writeFile(a + ".gz", "gz");
+  auto compressed = cache.get(a, "text/css");
+  if (ok && (!compressed->gzip || compressed->brotli || compressed->gzip->data != "gz" || cache.getSize() != 4
+    || compressed->gzip->headers.find("Content-Encoding: gzip\r\nContent-Length: 2\r\n") == std::string::npos
+    || compressed->validators.find("Vary: Accept-Encoding\r\n") == std::string::npos || compressed->gzip->etag == compressed->etag))
+    ok = fail("precompressed sibling is not loaded");
+
+  //changed sibling drops its file
+  writeFile(a + ".gz", "gz2");
+  cache.invalidate(a + ".gz");
+  if (ok && (cache.getSize() != 0 || cache.get(a, "text/css")->gzip->data != "gz2"))
+    ok = fail("changed sibling is not read again");
+
+  cache.setPrecompressed(false);
+  if (ok && (cache.get(a, "text/css")->gzip || cache.get(a, "text/css")->validators.find("Vary") != std::string::npos))
+    ok = fail("sibling is loaded when disabled");
+
+  int64_t time = 0;
+  if (ok && (rweb::formatHTTPDate(784111777) != "Sun, 06 Nov 1994 08:49:37 GMT" || rweb::formatHTTPDate(0) != "Thu, 01 Jan 1970 00:00:00 GMT"
+    || !rweb::parseHTTPDate("Sun, 06 Nov 1994 08:49:37 GMT", time) || time != 784111777
+    || rweb::parseHTTPDate("Sunday, 06-Nov-94 08:49:37 GMT", time)))
+    ok = fail("HTTP dates are wrong");
+
+  std::filesystem::remove_all(dir);
+  if (!ok)
+    return -1;
+
+  std::cout << rweb::colorize(rweb::GREEN) << "----RESOURCE_CACHE_SUCCESS----" << rweb::colorize(rweb::NC) << "\n";
+  return 0;
+}
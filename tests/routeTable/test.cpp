@@ -0,0 +1,74 @@
+#include <RWEB.h>
+#include <RouteTable.h>
+
+#include <iostream>
+
+static rweb::HTMLTemplate home(const rweb::Request)
+{
+  return "home";
+}
+
+static rweb::HTMLTemplate api(const rweb::Request)
+{
+  return "api";
+}
+
+static constexpr auto table = rweb::makeRouteTable({
+  {"GET", "/", home},
+  {"POST", "/", api},
+  {"/api", api},
+  {"DELETE", "/api/items", api},
+  {"GET", "/api/items", home},
+});
+
+static_assert(rweb::getRouteMethodIndex("PATCH") == 5, "method index");
+static_assert(rweb::getRouteMethodIndex("get") == -1, "methods are case-sensitive");
+static_assert(rweb::routeHash("/") != rweb::routeHash("/api"), "hash");
+
+static bool fail(const std::string& message)
+{
+  std::cout << rweb::colorize(rweb::RED) << "TEST FAILED: " << message << rweb::colorize(rweb::NC) << "\n";
+  return false;
+}
+
+//expects 'path' to have routes with these methods ("" - any method)
+static bool expect(const rweb::RouteTableView& view, const std::string& path, const std::vector<std::string>& methods)
+{
+  const rweb::StaticRoute* routes;
+  size_t count;
+  if (!view.find(path, routes, count))
+    return fail("'" + path + "' is not found");
+  if (count != methods.size())
+    return fail("'" + path + "' has " + std::to_string(count) + " routes");
+  for (size_t i=0;i<count;++i)
+  {
+    if (routes[i].path != path)
+      return fail("'" + path + "' has a route of another path");
+    bool found = false;
+    for (auto& m : methods)
+      found = found || routes[i].method == m;
+    if (!found)
+      return fail("'" + path + "' has unexpected method '" + std::string(routes[i].method) + "'");
+  }
+  return true;
+}
+
+int main()
+{
+  rweb::init(false);
+
+  const rweb::RouteTableView view = table.view();
+  const rweb::StaticRoute* routes;
+  size_t count;
+  const bool ok = expect(view, "/", {"GET", "POST"})
+    && expect(view, "/api", {""})
+    && expect(view, "/api/items", {"GET", "DELETE"})
+    && (!view.find("/api/", routes, count) || fail("'/api/' is found"))
+    && (!view.find("/nothing", routes, count) || fail("'/nothing' is found"))
+    && (!rweb::RouteTableView{}.find("/", routes, count) || fail("empty table finds a path"));
+  if (!ok)
+    return -1;
+
+  std::cout << rweb::colorize(rweb::GREEN) << "----ROUTE_TABLE_SUCCESS----" << rweb::colorize(rweb::NC) << "\n";
+  return 0;
+}
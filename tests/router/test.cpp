@@ -0,0 +1,137 @@
+#include <RWEB.h>
+#include <Router.h>
+
+#include <iostream>
+
+static bool fail(const std::string& message)
+{
+  std::cout << rweb::colorize(rweb::RED) << "TEST FAILED: " << message << rweb::colorize(rweb::NC) << "\n";
+  return false;
+}
+
+//expects 'path' to be routed to 'value' with 'args'
+static bool expect(const rweb::Router& router, const std::string& path, size_t value, const std::vector<std::string>& args={})
+{
+  rweb::Router::Match m;
+  if (!router.find(path, m))
+    return fail("'" + path + "' is not found");
+  if (m.value != value)
+    return fail("'" + path + "' is routed to " + std::to_string(m.value));
+  if (m.argCount != args.size())
+    return fail("'" + path + "' has wrong arg count");
+  for (size_t i=0;i<args.size();++i)
+  {
+    if (m.args[i] != args[i])
+      return fail("'" + path + "' has wrong arg " + std::to_string(i));
+  }
+  return true;
+}
+
+static bool expectMissing(const rweb::Router& router, const std::string& path)
+{
+  rweb::Router::Match m;
+  if (router.find(path, m))
+    return fail("'" + path + "' should not be found");
+  return true;
+}
+
+int main()
+{
+  rweb::init(false);
+
+  rweb::Router router;
+  router.add("/", 0);
+  router.add("/user/me", 1);
+  router.add("/user/<id>", 2);
+  router.add("/user/<id>/posts/<post>", 3);
+  router.add("/user/me/settings", 4);
+  router.add("/a/<x>/c", 5);
+  router.add("/a/b/d", 6);
+  router.add("/literal/<x>", 7, false);
+  router.addPrefix("/static/", 8);
+  router.addPrefix("/", 9);
+  if (router.add("/user/<name>", 10))
+  {
+    fail("duplicate path is added");
+    return -1;
+  }
+
+  router.add("/item/<int:id>", 11);
+  router.add("/item/<uuid:key>", 12);
+  router.add("/item/<name>", 13);
+  router.add("/count/<uint:n>/x", 14);
+  router.add("/count/<n>/y", 15);
+
+  for (int i=0;i<400;++i)
+    router.add("/api/v1/items" + std::to_string(i) + "/<id>", 100 + i);
+
+  bool ok = expect(router, "/", 0)
+    && expect(router, "/user/me", 1)
+    && expect(router, "/user/42", 2, {"42"})
+    && expect(router, "//user//42", 2, {"42"})
+    && expect(router, "/user/42/posts/7", 3, {"42", "7"})
+    && expect(router, "/user/me/posts/7", 3, {"me", "7"}) // exact 'me' branch has no posts -> backtrack
+    && expect(router, "/user/me/settings", 4)
+    && expect(router, "/a/b/c", 5, {"b"})
+    && expect(router, "/a/b/d", 6)
+    && expect(router, "/literal/<x>", 7)
+    && expect(router, "/api/v1/items399/abc", 499, {"abc"})
+    && expectMissing(router, "/user/42/")
+    && expectMissing(router, "/user/")
+    && expectMissing(router, "/literal/y")
+    && expectMissing(router, "/nothing")
+    && expect(router, "/item/-42", 11, {"-42"})
+    && expect(router, "/item/123e4567-E89B-12d3-a456-426614174000", 12, {"123e4567-E89B-12d3-a456-426614174000"})
+    && expect(router, "/item/42x", 13, {"42x"})
+    && expect(router, "/item/123e4567-e89b-12d3-a456-42661417400g", 13, {"123e4567-e89b-12d3-a456-42661417400g"})
+    && expect(router, "/item/99999999999999999999", 13, {"99999999999999999999"})
+    && expect(router, "/count/7/x", 14, {"7"})
+    && expect(router, "/count/7/y", 15, {"7"})
+    && expectMissing(router, "/count/-7/x");
+  if (!ok)
+    return -1;
+
+  rweb::Router::Match m;
+  if (!router.find("/item/-42", m) || m.values[0].type != rweb::ArgType::INT || m.values[0].i != -42)
+  {
+    fail("int arg is not converted");
+    return -1;
+  }
+  if (!router.find("/item/123e4567-E89B-12d3-a456-426614174000", m) || m.values[0].uuid[0] != 0x12 || m.values[0].uuid[6] != 0x12 || m.values[0].uuid[15] != 0x00 || m.values[0].uuid[5] != 0x9b)
+  {
+    fail("uuid arg is not converted");
+    return -1;
+  }
+  if (!router.find("/count/18446744073709551615/x", m) || m.values[0].u != UINT64_MAX)
+  {
+    fail("uint arg is not converted");
+    return -1;
+  }
+  rweb::ArgType type;
+  if (rweb::Router::getArgType("<float:x>", type) || !rweb::Router::getArgType("<string:x>", type) || type != rweb::ArgType::STRING)
+  {
+    fail("arg types are not recognized");
+    return -1;
+  }
+
+  size_t value;
+  std::string_view rest;
+  if (!router.findPrefix("/static/main.css", value, rest) || value != 8 || rest != "main.css")
+  {
+    fail("prefix is not found");
+    return -1;
+  }
+  if (!router.findPrefix("/favicon.ico/", value, rest) || value != 9 || rest != "favicon.ico")
+  {
+    fail("root prefix is not found");
+    return -1;
+  }
+  if (router.findPrefix("/static/css/main.css", value, rest))
+  {
+    fail("prefix matches more than one segment");
+    return -1;
+  }
+
+  std::cout << rweb::colorize(rweb::GREEN) << "----ROUTER_SUCCESS----" << rweb::colorize(rweb::NC) << "\n";
+  return 0;
+}
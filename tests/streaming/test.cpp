@@ -0,0 +1,141 @@
+#include <RWEB.h>
+
+#include <iostream>
+#include <thread>
+#include <chrono>
+
+#include "../common/Client.h"
+
+#define TEST_PORT 4225
+
+static bool fail(const std::string& message)
+{
+  std::cout << rweb::colorize(rweb::RED) << "TEST FAILED: " << message << rweb::colorize(rweb::NC) << "\n";
+  return false;
+}
+
+static std::string sessionCookie;
+
+static std::string request(const std::string& method, const std::string& path, const bool keepAlive=false)
+{
+  return method + " " + path + " HTTP/1.1\r\nHost: localhost\r\nConnection: " + (keepAlive ? "keep-alive" : "close") +
+    "\r\nCookie: " + sessionCookie + "\r\n\r\n";
+}
+
+//decodes chunked body starting at 'pos'. Moves 'pos' after it. 'complete' is set if the last chunk is found
+static std::string decodeChunked(const std::string& res, size_t& pos, bool& complete, size_t& chunks)
+{
+  std::string body;
+  complete = false;
+  chunks = 0;
+  while (pos < res.size())
+  {
+    const size_t lineEnd = res.find("\r\n", pos);
+    if (lineEnd == std::string::npos)
+      break;
+    const size_t size = std::stoul(res.substr(pos, lineEnd - pos), nullptr, 16);
+    pos = lineEnd + 2;
+    if (size == 0)
+    {
+      complete = res.compare(pos, 2, "\r\n") == 0;
+      pos += 2;
+      break;
+    }
+    if (pos + size + 2 > res.size())
+      break;
+    body += res.substr(pos, size);
+    pos += size + 2;
+    chunks++;
+  }
+  return body;
+}
+
+static const std::string page = "<ul>{% for item in items %}<li>{{ item.name }}</li>{% endfor %}</ul>";
+
+int main()
+{
+  if (!rweb::init(false, 1))
+  {
+    std::cout << "Failed to initialize RWEB!\n";
+    return -1;
+  }
+  rweb::setLogLevel(rweb::ERROR);
+  rweb::setPort(TEST_PORT);
+
+  static nlohmann::json json;
+  for (int i=0;i<2000;++i)
+    json["items"].push_back({{"name", "item " + std::to_string(i)}});
+  static nlohmann::json broken = json;
+  broken["items"][1500].erase("name");
+
+  rweb::addRoute("GET", "/page", [](const rweb::Request){
+    rweb::HTMLTemplate temp(page);
+    temp.streamJSON(json, 1024);
+    return temp;
+  });
+  rweb::addRoute("GET", "/broken", [](const rweb::Request){
+    rweb::HTMLTemplate temp(page);
+    temp.streamJSON(broken, 1024);
+    return temp;
+  });
+  rweb::addRoute("GET", "/invalid", [](const rweb::Request){
+    rweb::HTMLTemplate temp("{% unknown %}");
+    temp.streamJSON(json);
+    return temp;
+  });
+  rweb::addRoute("GET", "/small", [](const rweb::Request){return (rweb::HTMLTemplate)"small";});
+
+  std::thread th([](){
+    rweb::startServer(4);
+  });
+  th.detach();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  bool ok = true;
+  const std::string first = exchange(TEST_PORT, "GET /small HTTP/1.1\r\nConnection: close\r\n\r\n");
+  const size_t cookie = first.find("sessionID=");
+  if (cookie == std::string::npos)
+    ok = fail("no session cookie");
+  else
+    sessionCookie = first.substr(cookie, first.find(';', cookie) - cookie);
+
+  rweb::HTMLTemplate expected(page);
+  expected.renderJSON(json);
+
+  //streamed page is followed by the next responce on the same connection
+  std::string res = ok ? exchange(TEST_PORT, request("GET", "/page", true) + request("GET", "/small")) : "";
+  size_t pos = res.find("\r\n\r\n") + 4;
+  bool complete;
+  size_t chunks;
+  if (ok && (res.compare(0, 12, "HTTP/1.1 200") != 0 || res.find("Transfer-Encoding: chunked\r\n") == std::string::npos
+    || res.substr(0, pos).find("Content-Length") != std::string::npos))
+    ok = fail("streamed responce has wrong headers");
+  const std::string body = ok ? decodeChunked(res, pos, complete, chunks) : "";
+  if (ok && (body != expected.getHTML() || !complete || chunks < 10))
+    ok = fail("streamed body is wrong (" + std::to_string(chunks) + " chunks)");
+  if (ok && (res.compare(pos, 12, "HTTP/1.1 200") != 0 || res.substr(res.size() - 5) != "small"))
+    ok = fail("next responce is wrong");
+
+  //HEAD is not streamed, it has the length of the page
+  res = ok ? exchange(TEST_PORT, request("HEAD", "/page")) : "";
+  if (ok && res.find("Content-Length: " + std::to_string(expected.getHTML().size()) + "\r\n") == std::string::npos)
+    ok = fail("HEAD responce is wrong");
+
+  //error after the first part cuts the responce
+  res = ok ? exchange(TEST_PORT, request("GET", "/broken", true) + request("GET", "/small")) : "";
+  pos = res.find("\r\n\r\n") + 4;
+  if (ok && (res.compare(0, 12, "HTTP/1.1 200") != 0 || (decodeChunked(res, pos, complete, chunks), complete) || chunks == 0
+    || res.find("small") != std::string::npos))
+    ok = fail("broken stream is not cut");
+
+  //template which can't be compiled is not streamed at all
+  if (ok && exchange(TEST_PORT, request("GET", "/invalid")).compare(0, 12, "HTTP/1.1 500") != 0)
+    ok = fail("invalid template is not 500");
+
+  rweb::closeServer();
+  if (!ok)
+    return -1;
+
+  std::cout << rweb::colorize(rweb::GREEN) << "----STREAMING_SUCCESS----" << rweb::colorize(rweb::NC) << "\n";
+  return 0;
+}
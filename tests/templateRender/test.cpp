@@ -0,0 +1,98 @@
+#include <RWEB.h>
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+
+static bool fail(const std::string& message)
+{
+  std::cout << rweb::colorize(rweb::RED) << "TEST FAILED: " << message << rweb::colorize(rweb::NC) << "\n";
+  return false;
+}
+
+//renders 'html' and compares the result ignoring newlines
+static bool check(const std::string& html, const nlohmann::json& json, const std::string& expected)
+{
+  rweb::HTMLTemplate temp(html);
+  temp.renderJSON(json);
+  const std::string result = rweb::replace(temp.getHTML(), "\n", "");
+  if (temp.getStatusResponce() == rweb::HTTP_500 || result != expected)
+    return fail("\"" + html + "\" is rendered as \"" + result + "\", expected \"" + expected + "\"");
+  return true;
+}
+
+static std::string render(const std::string& path, const nlohmann::json& json)
+{
+  rweb::HTMLTemplate temp = rweb::createTemplate(path);
+  temp.renderJSON(json);
+  return temp.getStatusResponce() == rweb::HTTP_500 ? "ERROR" : rweb::replace(temp.getHTML(), "\n", "");
+}
+
+//template files are compiled once, "loadblock" files with them
+static bool checkCache(const nlohmann::json& json)
+{
+  const std::string dir = (std::filesystem::temp_directory_path() / "rwebTemplateRenderTest").string();
+  std::filesystem::create_directories(dir);
+  std::ofstream(dir + "/index.html") << "<{{ name }}>{% loadblock(\"blocks.html\", b) %}";
+  std::ofstream(dir + "/blocks.html") << "{% block b %}[{{ name }}]{% endblock %}";
+  rweb::setResourcePath(dir);
+
+  bool ok = true;
+  rweb::HTMLTemplate unrendered = rweb::createTemplate("index.html");
+  if (unrendered.getHTML() != "<{{ name }}>{% loadblock(\"blocks.html\", b) %}" || render("index.html", json) != "<outer>[outer]")
+    ok = fail("template file is rendered wrong");
+
+  std::ofstream(dir + "/blocks.html") << "{% block b %}({{ name }}){% endblock %}";
+  if (ok && render("index.html", json) != "<outer>[outer]")
+    ok = fail("cached template is read again");
+
+  rweb::clearTemplateCache();
+  if (ok && render("index.html", json) != "<outer>(outer)")
+    ok = fail("cleared template is not read again");
+
+  rweb::setTemplateCache(false);
+  std::ofstream(dir + "/index.html") << "{{ name }}";
+  if (ok && render("index.html", json) != "outer")
+    ok = fail("template is cached when disabled");
+  rweb::setTemplateCache(true);
+
+  if (ok && (rweb::createTemplate("missing.html").getStatusResponce() != rweb::HTTP_500 || render("missing.html", json) != "ERROR"))
+    ok = fail("missing template is not an error");
+
+  std::filesystem::remove_all(dir);
+  return ok;
+}
+
+int main()
+{
+  rweb::init(false);
+  rweb::setLogLevel(rweb::ERROR);
+
+  nlohmann::json json;
+  json["items"] = {{{"name", "a"}, {"count", 1}}, {{"name", "b"}, {"count", 0}}, {{"name", "c"}, {"count", 3}}};
+  json["name"] = "outer";
+  json["inject"] = "{{ name }}{% if 1 %}x{% endif %}";
+
+  bool ok = check("{% for item in items %}<{{ item.name }}>{% endfor %}", json, "<a><b><c>")
+    && check("{% for i, item in enumerate(items) %} {{ i }}={{ item.name|str }} {% endfor %}", json, "0=a1=b2=c")
+    && check("{% for item in items %}{% if item.count %}{{ item.name }}{% else %}-{% endif %}{% endfor %}", json, "a-c")
+    && check("{% for name in items %}{% endfor %}{{ name }}", json, "outer")
+    && check("{% for x in items %}{% for y in items %}{{ y.count }}{% endfor %};{% endfor %}", json, "103;103;103;")
+    && check("{% raw %}{{ name }}{% endraw %}", json, "{{ name }}")
+    && check("{{ 2 * 3 }} {{ name }", json, "6 {{ name }");
+
+  //substituted values are not parsed again
+  ok = ok && check("{{ inject|str }}", json, "{{ name }}{% if 1 %}x{% endif %}");
+
+  rweb::HTMLTemplate broken("{% for item in missing %}{% endfor %}");
+  broken.renderJSON(json);
+  if (ok && (broken.getStatusResponce() != rweb::HTTP_500 || broken.getHTML() != "{% for item in missing %}{% endfor %}"))
+    ok = fail("failed render is not reported");
+
+  ok = ok && checkCache(json);
+  if (!ok)
+    return -1;
+
+  std::cout << rweb::colorize(rweb::GREEN) << "----TEMPLATE_RENDER_SUCCESS----" << rweb::colorize(rweb::NC) << "\n";
+  return 0;
+}